@@ -0,0 +1,258 @@
+/**
+ * @file bootcamp_types.h
+ * @brief The classes from the tutorial files in src/, for the benchmarks.
+ */
+
+// Every file in src/ is its own program with its own main(), so the
+// benchmarks can't include them. Instead, this header has copies of the
+// classes they benchmark, with the print statements taken out (printing
+// would take far longer than the code we want to measure). Everything else
+// is the same as in the tutorial file named above each class, so if you
+// change one of those classes, change it here too.
+
+#pragma once
+
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::string.
+#include <string>
+// Includes std::is_nothrow_move_constructible.
+#include <type_traits>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+/* ======================================================================
+   === The doubly linked list from iterator.cpp =========================
+   ====================================================================== */
+
+struct Node {
+  Node(int val) : next_(nullptr), prev_(nullptr), value_(val) {}
+
+  Node *next_;
+  Node *prev_;
+  int value_;
+};
+
+class DLLIterator {
+ public:
+  DLLIterator(Node *head) : curr_(head) {}
+
+  DLLIterator &operator++() {
+    curr_ = curr_->next_;
+    return *this;
+  }
+
+  DLLIterator operator++(int) {
+    DLLIterator temp = *this;
+    ++*this;
+    return temp;
+  }
+
+  bool operator==(const DLLIterator &itr) const { return itr.curr_ == this->curr_; }
+  bool operator!=(const DLLIterator &itr) const { return itr.curr_ != this->curr_; }
+  int operator*() { return curr_->value_; }
+
+ private:
+  Node *curr_;
+};
+
+class DLL {
+ public:
+  DLL() : head_(nullptr), size_(0) {}
+
+  ~DLL() {
+    Node *current = head_;
+    while (current != nullptr) {
+      Node *next = current->next_;
+      delete current;
+      current = next;
+    }
+    head_ = nullptr;
+  }
+
+  void InsertAtHead(int val) {
+    Node *new_node = new Node(val);
+    new_node->next_ = head_;
+    if (head_ != nullptr) {
+      head_->prev_ = new_node;
+    }
+    head_ = new_node;
+    size_ += 1;
+  }
+
+  DLLIterator Begin() { return DLLIterator(head_); }
+  DLLIterator End() { return DLLIterator(nullptr); }
+
+  Node *head_{nullptr};
+  size_t size_;
+};
+
+/* ======================================================================
+   === IntPtrManager from wrapper_class.cpp =============================
+   ====================================================================== */
+
+class IntPtrManager {
+ public:
+  IntPtrManager() {
+    ptr_ = new int;
+    *ptr_ = 0;
+  }
+
+  IntPtrManager(int val) {
+    ptr_ = new int;
+    *ptr_ = val;
+  }
+
+  ~IntPtrManager() {
+    if (ptr_) {
+      delete ptr_;
+    }
+  }
+
+  IntPtrManager(IntPtrManager &&other) noexcept {
+    ptr_ = other.ptr_;
+    other.ptr_ = nullptr;
+  }
+
+  IntPtrManager &operator=(IntPtrManager &&other) noexcept {
+    if (ptr_ == other.ptr_) {
+      return *this;
+    }
+    if (ptr_) {
+      delete ptr_;
+    }
+    ptr_ = other.ptr_;
+    other.ptr_ = nullptr;
+    return *this;
+  }
+
+  IntPtrManager(const IntPtrManager &) = delete;
+  IntPtrManager &operator=(const IntPtrManager &) = delete;
+
+  void SetVal(int val) { *ptr_ = val; }
+  int GetVal() const { return *ptr_; }
+
+ private:
+  int *ptr_;
+};
+
+/* ======================================================================
+   === Pointer<T> from spring2024/s24_my_ptr.cpp ========================
+   ====================================================================== */
+
+template <typename T>
+class Pointer {
+ public:
+  Pointer() {
+    ptr_ = new T;
+    *ptr_ = 0;
+  }
+  Pointer(T val) {
+    ptr_ = new T;
+    *ptr_ = val;
+  }
+  ~Pointer() {
+    if (ptr_) {
+      delete ptr_;
+    }
+  }
+
+  Pointer(const Pointer<T> &) = delete;
+  Pointer<T> &operator=(const Pointer<T> &) = delete;
+
+  Pointer(Pointer<T> &&another) noexcept : ptr_(another.ptr_) { another.ptr_ = nullptr; }
+  Pointer<T> &operator=(Pointer<T> &&another) noexcept {
+    if (ptr_ == another.ptr_) {
+      return *this;
+    }
+    if (ptr_) {
+      delete ptr_;
+    }
+    ptr_ = another.ptr_;
+    another.ptr_ = nullptr;
+    return *this;
+  }
+
+  T &operator*() { return *ptr_; }
+  T get_val() { return *ptr_; }
+  void set_val(T val) { *ptr_ = val; }
+
+ private:
+  T *ptr_;
+};
+
+/* ======================================================================
+   === Point from vectors.cpp / shared_ptr.cpp ==========================
+   ====================================================================== */
+
+class Point {
+ public:
+  Point() : x_(0), y_(0) {}
+  Point(int x, int y) : x_(x), y_(y) {}
+  inline int GetX() const { return x_; }
+  inline int GetY() const { return y_; }
+  inline void SetX(int x) { x_ = x; }
+  inline void SetY(int y) { y_ = y; }
+
+ private:
+  int x_;
+  int y_;
+};
+
+/* ======================================================================
+   === Person from move_constructors.cpp ================================
+   ====================================================================== */
+
+class Person {
+ public:
+  Person() : age_(0), nicknames_({}), valid_(true) {}
+
+  Person(uint32_t age, std::vector<std::string> &&nicknames)
+      : age_(age), nicknames_(std::move(nicknames)), valid_(true) {}
+
+  Person(Person &&person) noexcept : age_(person.age_), nicknames_(std::move(person.nicknames_)), valid_(true) {
+    person.valid_ = false;
+  }
+
+  Person &operator=(Person &&other) noexcept {
+    age_ = other.age_;
+    nicknames_ = std::move(other.nicknames_);
+    valid_ = true;
+    other.valid_ = false;
+    return *this;
+  }
+
+  Person(const Person &) = delete;
+  Person &operator=(const Person &) = delete;
+
+  uint32_t GetAge() { return age_; }
+  std::string &GetNicknameAtI(size_t i) { return nicknames_[i]; }
+
+ private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  bool valid_;
+};
+
+/* ======================================================================
+   === Checks ===========================================================
+   ====================================================================== */
+
+// Every class above that owns a resource must be movable without throwing,
+// or std::vector moves it the slow way when it grows (see
+// BM_VectorRelocate in memory_bench.cpp). Every benchmark file includes
+// this header, so the benchmarks don't compile if one of them regresses.
+template <typename T>
+constexpr bool IsNothrowMovable() {
+  return std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>;
+}
+
+static_assert(IsNothrowMovable<IntPtrManager>());
+static_assert(IsNothrowMovable<Pointer<int>>());
+static_assert(IsNothrowMovable<Pointer<double>>());
+static_assert(IsNothrowMovable<Person>());
+static_assert(IsNothrowMovable<Point>());
@@ -0,0 +1,246 @@
+/**
+ * @file containers_bench.cpp
+ * @brief Benchmarks for the containers from vectors.cpp, sets.cpp,
+ * unordered_maps.cpp and iterator.cpp.
+ */
+
+// Every benchmark is run for several container sizes (the /N at the end of
+// its name), so you can see how the cost grows as the container gets
+// bigger and falls out of the CPU caches.
+
+// Includes std::remove_if.
+#include <algorithm>
+// Includes std::list, the STL counterpart of the DLL.
+#include <list>
+// Includes std::mt19937.
+#include <random>
+// Includes std::set.
+#include <set>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes the vector container.
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bootcamp_types.h"
+
+// Shuffled keys 0..n-1, so the ordered containers see a random insert order.
+static std::vector<int> ShuffledKeys(int64_t n) {
+  std::vector<int> keys(n);
+  for (int64_t i = 0; i < n; ++i) {
+    keys[i] = static_cast<int>(i);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  return keys;
+}
+
+/* ======================================================================
+   === std::vector ======================================================
+   ====================================================================== */
+
+static void BM_VectorPushBack(benchmark::State &state) {
+  for (auto _ : state) {
+    std::vector<int> int_vector;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      int_vector.push_back(static_cast<int>(i));
+    }
+    benchmark::DoNotOptimize(int_vector.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorPushBack)->Range(8, 1 << 16);
+
+static void BM_VectorPushBackReserved(benchmark::State &state) {
+  for (auto _ : state) {
+    std::vector<int> int_vector;
+    int_vector.reserve(state.range(0));
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      int_vector.push_back(static_cast<int>(i));
+    }
+    benchmark::DoNotOptimize(int_vector.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorPushBackReserved)->Range(8, 1 << 16);
+
+static void BM_VectorEmplaceBackPoint(benchmark::State &state) {
+  for (auto _ : state) {
+    std::vector<Point> point_vector;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      point_vector.emplace_back(static_cast<int>(i), static_cast<int>(i));
+    }
+    benchmark::DoNotOptimize(point_vector.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorEmplaceBackPoint)->Range(8, 1 << 16);
+
+static void BM_VectorIterate(benchmark::State &state) {
+  std::vector<int> int_vector(state.range(0), 1);
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const int &elem : int_vector) {
+      sum += elem;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorIterate)->Range(8, 1 << 20);
+
+// The filter from vectors.cpp: erase every point with x == 37.
+static void BM_VectorEraseRemoveIf(benchmark::State &state) {
+  std::vector<Point> source;
+  std::mt19937 gen(15445);
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    source.emplace_back(static_cast<int>(gen() % 100), 0);
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<Point> point_vector = source;
+    state.ResumeTiming();
+    point_vector.erase(std::remove_if(point_vector.begin(), point_vector.end(),
+                                      [](const Point &point) { return point.GetX() == 37; }),
+                       point_vector.end());
+    benchmark::DoNotOptimize(point_vector.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorEraseRemoveIf)->Range(1 << 10, 1 << 20);
+
+/* ======================================================================
+   === std::set =========================================================
+   ====================================================================== */
+
+static void BM_SetInsert(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    std::set<int> int_set;
+    for (int key : keys) {
+      int_set.insert(key);
+    }
+    benchmark::DoNotOptimize(int_set.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetInsert)->Range(8, 1 << 16);
+
+static void BM_SetFind(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  std::set<int> int_set(keys.begin(), keys.end());
+  for (auto _ : state) {
+    for (int key : keys) {
+      benchmark::DoNotOptimize(int_set.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetFind)->Range(8, 1 << 20);
+
+static void BM_SetCount(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  std::set<int> int_set(keys.begin(), keys.end());
+  for (auto _ : state) {
+    for (int key : keys) {
+      benchmark::DoNotOptimize(int_set.count(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetCount)->Range(8, 1 << 20);
+
+/* ======================================================================
+   === std::unordered_map ===============================================
+   ====================================================================== */
+
+static void BM_UnorderedMapInsert(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    std::unordered_map<int, int> map;
+    for (int key : keys) {
+      map.insert({key, key});
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UnorderedMapInsert)->Range(8, 1 << 16);
+
+static void BM_UnorderedMapInsertReserved(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  for (auto _ : state) {
+    std::unordered_map<int, int> map;
+    map.reserve(keys.size());
+    for (int key : keys) {
+      map.insert({key, key});
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UnorderedMapInsertReserved)->Range(8, 1 << 16);
+
+static void BM_UnorderedMapFind(benchmark::State &state) {
+  std::vector<int> keys = ShuffledKeys(state.range(0));
+  std::unordered_map<int, int> map;
+  for (int key : keys) {
+    map.insert({key, key});
+  }
+  for (auto _ : state) {
+    for (int key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UnorderedMapFind)->Range(8, 1 << 20);
+
+/* ======================================================================
+   === The DLL from iterator.cpp ========================================
+   ====================================================================== */
+
+static void BM_DLLInsertAtHead(benchmark::State &state) {
+  for (auto _ : state) {
+    DLL dll;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      dll.InsertAtHead(static_cast<int>(i));
+    }
+    benchmark::DoNotOptimize(dll.head_);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DLLInsertAtHead)->Range(8, 1 << 16);
+
+static void BM_DLLIterate(benchmark::State &state) {
+  DLL dll;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    dll.InsertAtHead(static_cast<int>(i));
+  }
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (DLLIterator iter = dll.Begin(); iter != dll.End(); ++iter) {
+      sum += *iter;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DLLIterate)->Range(8, 1 << 20);
+
+// The same walk over a std::list, to compare against the DLL.
+static void BM_StdListIterate(benchmark::State &state) {
+  std::list<int> list;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    list.push_front(static_cast<int>(i));
+  }
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (int value : list) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdListIterate)->Range(8, 1 << 20);
@@ -0,0 +1,268 @@
+/**
+ * @file memory_bench.cpp
+ * @brief Benchmarks for the smart pointers and wrapper classes from
+ * unique_ptr.cpp, shared_ptr.cpp, wrapper_class.cpp and s24_my_ptr.cpp.
+ */
+
+// Includes uint32_t.
+#include <cstdint>
+// Includes std::unique_ptr, std::shared_ptr.
+#include <memory>
+// Includes std::string.
+#include <string>
+// Includes std::is_same, std::is_constructible.
+#include <type_traits>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bootcamp_types.h"
+
+/* ======================================================================
+   === Pointer<T> and IntPtrManager =====================================
+   ====================================================================== */
+
+// Creating one is a heap allocation, and destroying it is a free.
+static void BM_PointerCreate(benchmark::State &state) {
+  for (auto _ : state) {
+    Pointer<int> p(4);
+    benchmark::DoNotOptimize(*p);
+  }
+}
+BENCHMARK(BM_PointerCreate);
+
+// Moving one only copies a pointer and sets the old one to nullptr.
+static void BM_PointerMove(benchmark::State &state) {
+  Pointer<int> p1(4);
+  for (auto _ : state) {
+    Pointer<int> p2 = std::move(p1);
+    p1 = std::move(p2);
+    benchmark::DoNotOptimize(p1.get_val());
+  }
+}
+BENCHMARK(BM_PointerMove);
+
+static void BM_IntPtrManagerCreate(benchmark::State &state) {
+  for (auto _ : state) {
+    IntPtrManager a(445);
+    benchmark::DoNotOptimize(a.GetVal());
+  }
+}
+BENCHMARK(BM_IntPtrManagerCreate);
+
+static void BM_IntPtrManagerMove(benchmark::State &state) {
+  IntPtrManager a(445);
+  for (auto _ : state) {
+    IntPtrManager b(std::move(a));
+    a = std::move(b);
+    benchmark::DoNotOptimize(a.GetVal());
+  }
+}
+BENCHMARK(BM_IntPtrManagerMove);
+
+template <typename Wrapper>
+static Wrapper MakeWrapper(int val) {
+  if constexpr (std::is_same_v<Wrapper, std::unique_ptr<int>>) {
+    return std::make_unique<int>(val);
+  } else {
+    return Wrapper(val);
+  }
+}
+
+// Growing a vector of move-only wrappers. How the vector moves its elements
+// to the new buffer depends on whether their move constructor is noexcept.
+template <typename Wrapper>
+static void BM_VectorOfWrappersGrow(benchmark::State &state) {
+  for (auto _ : state) {
+    std::vector<Wrapper> wrappers;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      wrappers.push_back(MakeWrapper<Wrapper>(static_cast<int>(i)));
+    }
+    benchmark::DoNotOptimize(wrappers.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_VectorOfWrappersGrow, Pointer<int>)->Range(8, 1 << 16);
+BENCHMARK_TEMPLATE(BM_VectorOfWrappersGrow, IntPtrManager)->Range(8, 1 << 16);
+BENCHMARK_TEMPLATE(BM_VectorOfWrappersGrow, std::unique_ptr<int>)->Range(8, 1 << 16);
+
+/* ======================================================================
+   === Relocating a vector and noexcept moves ===========================
+   ====================================================================== */
+
+// When a std::vector outgrows its buffer, it allocates a bigger one and
+// moves every element over. It has to keep the strong exception guarantee
+// (if a move throws halfway, the vector is left as it was), so it uses
+// std::move_if_noexcept:
+// - If the move constructor is noexcept, it moves each element and
+//   destroys the old one right after, in one pass over the buffer.
+// - If the move constructor may throw and the type can be copied, it
+//   copies every element instead, so the old buffer stays intact.
+// - If it may throw and the type can't be copied (like Person, Pointer<T>
+//   and IntPtrManager), it moves anyway, gives up the guarantee, and
+//   destroys the old elements in a second pass.
+
+// The same class with move operations that may throw, like the classes in
+// src/ had before their moves were marked noexcept.
+template <typename T>
+class MayThrowOnMove : public T {
+ public:
+  using T::T;
+  MayThrowOnMove(const MayThrowOnMove &) = default;
+  MayThrowOnMove &operator=(const MayThrowOnMove &) = default;
+  MayThrowOnMove(MayThrowOnMove &&other) : T(std::move(other)) {}
+  MayThrowOnMove &operator=(MayThrowOnMove &&other) {
+    T::operator=(std::move(other));
+    return *this;
+  }
+};
+
+// Person, but copyable, to show the copy fallback.
+class CopyablePerson {
+ public:
+  CopyablePerson(uint32_t age, std::vector<std::string> &&nicknames) : age_(age), nicknames_(std::move(nicknames)) {}
+  CopyablePerson(const CopyablePerson &) = default;
+  CopyablePerson &operator=(const CopyablePerson &) = default;
+  CopyablePerson(CopyablePerson &&) noexcept = default;
+  CopyablePerson &operator=(CopyablePerson &&) noexcept = default;
+
+ private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+};
+
+template <typename T>
+static T MakeElement(int64_t i) {
+  if constexpr (std::is_constructible_v<T, int>) {
+    return T(static_cast<int>(i));
+  } else {
+    return T(static_cast<uint32_t>(i), std::vector<std::string>{"andy", "pavlo"});
+  }
+}
+
+// Times exactly one reallocation of a full vector of range(0) elements.
+// Building the vector and destroying the previous one isn't timed.
+template <typename T>
+static void BM_VectorRelocate(benchmark::State &state) {
+  std::vector<T> elems;
+  for (auto _ : state) {
+    state.PauseTiming();
+    elems = std::vector<T>();
+    elems.reserve(state.range(0));
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      elems.push_back(MakeElement<T>(i));
+    }
+    state.ResumeTiming();
+    elems.reserve(2 * state.range(0));
+    benchmark::DoNotOptimize(elems.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_VectorRelocate, Pointer<int>)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, MayThrowOnMove<Pointer<int>>)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, IntPtrManager)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, MayThrowOnMove<IntPtrManager>)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, Person)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, MayThrowOnMove<Person>)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, CopyablePerson)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+BENCHMARK_TEMPLATE(BM_VectorRelocate, MayThrowOnMove<CopyablePerson>)->RangeMultiplier(8)->Range(1 << 10, 1 << 19);
+
+/* ======================================================================
+   === Passing smart pointers to functions ==============================
+   ====================================================================== */
+
+// The functions are noinline, so the call really happens, like it would
+// for a function in another file.
+
+__attribute__((noinline)) int UseUniqueByRef(std::unique_ptr<Point> &point) { return point->GetX(); }
+__attribute__((noinline)) int UseRaw(Point *point) { return point->GetX(); }
+__attribute__((noinline)) std::unique_ptr<Point> TakeAndGiveBack(std::unique_ptr<Point> point) { return point; }
+
+__attribute__((noinline)) int UseSharedByValue(std::shared_ptr<Point> point) { return point->GetX(); }
+__attribute__((noinline)) int UseSharedByRef(std::shared_ptr<Point> &point) { return point->GetX(); }
+__attribute__((noinline)) int UseSharedByConstRef(const std::shared_ptr<Point> &point) { return point->GetX(); }
+
+// unique_ptr.cpp passes a std::unique_ptr<Point>& to SetXTo445.
+static void BM_PassUniquePtrByRef(benchmark::State &state) {
+  std::unique_ptr<Point> point = std::make_unique<Point>(1, 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UseUniqueByRef(point));
+  }
+}
+BENCHMARK(BM_PassUniquePtrByRef);
+
+// s24_my_ptr.cpp's not_take_ownership(up.get()).
+static void BM_PassUniquePtrGet(benchmark::State &state) {
+  std::unique_ptr<Point> point = std::make_unique<Point>(1, 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UseRaw(point.get()));
+  }
+}
+BENCHMARK(BM_PassUniquePtrGet);
+
+// s24_my_ptr.cpp's take_ownership(std::move(up)), handing ownership back so
+// we can do it again.
+static void BM_PassUniquePtrByMove(benchmark::State &state) {
+  std::unique_ptr<Point> point = std::make_unique<Point>(1, 2);
+  for (auto _ : state) {
+    point = TakeAndGiveBack(std::move(point));
+    benchmark::DoNotOptimize(point.get());
+  }
+}
+BENCHMARK(BM_PassUniquePtrByMove);
+
+// shared_ptr.cpp's copy_shared_ptr_in_function: every call increments and
+// decrements the (atomic) reference count.
+static void BM_PassSharedPtrByValue(benchmark::State &state) {
+  std::shared_ptr<Point> point = std::make_shared<Point>(2, 3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UseSharedByValue(point));
+  }
+}
+BENCHMARK(BM_PassSharedPtrByValue);
+
+static void BM_PassSharedPtrByRef(benchmark::State &state) {
+  std::shared_ptr<Point> point = std::make_shared<Point>(2, 3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UseSharedByRef(point));
+  }
+}
+BENCHMARK(BM_PassSharedPtrByRef);
+
+static void BM_PassSharedPtrByConstRef(benchmark::State &state) {
+  std::shared_ptr<Point> point = std::make_shared<Point>(2, 3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UseSharedByConstRef(point));
+  }
+}
+BENCHMARK(BM_PassSharedPtrByConstRef);
+
+// Copying a shared_ptr from many threads at once. They all update the same
+// reference count, so its cache line bounces between the cores.
+static void BM_SharedPtrCopyContended(benchmark::State &state) {
+  static std::shared_ptr<Point> shared = std::make_shared<Point>(2, 3);
+  for (auto _ : state) {
+    std::shared_ptr<Point> copy = shared;
+    benchmark::DoNotOptimize(copy.get());
+  }
+}
+BENCHMARK(BM_SharedPtrCopyContended)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_MakeUnique(benchmark::State &state) {
+  for (auto _ : state) {
+    std::unique_ptr<Point> point = std::make_unique<Point>(1, 2);
+    benchmark::DoNotOptimize(point.get());
+  }
+}
+BENCHMARK(BM_MakeUnique);
+
+static void BM_MakeShared(benchmark::State &state) {
+  for (auto _ : state) {
+    std::shared_ptr<Point> point = std::make_shared<Point>(1, 2);
+    benchmark::DoNotOptimize(point.get());
+  }
+}
+BENCHMARK(BM_MakeShared);
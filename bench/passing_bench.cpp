@@ -0,0 +1,165 @@
+/**
+ * @file passing_bench.cpp
+ * @brief Benchmarks for the cost of passing arguments by value, by reference
+ * and by move, for payloads from 8 bytes to 1 MB.
+ */
+
+// There are two kinds of payload:
+// - InlinePayload<N> keeps its N bytes inside the object, like Point does.
+//   Passing it by value copies all N bytes (on the stack or in registers).
+// - A std::vector<char> of N bytes keeps them on the heap, like the
+//   std::vector<int> in move_semantics.cpp. Passing it by value allocates
+//   and copies N bytes, but moving it only copies three pointers.
+// And two kinds of function:
+// - An "observer" only looks at the argument (like print_int_vector in
+//   vectors.cpp).
+// - A "sink" keeps the argument (like Person's constructor in
+//   move_constructors.cpp keeps its nicknames).
+
+// Includes std::array.
+#include <array>
+// Includes std::size_t.
+#include <cstddef>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+template <size_t N>
+struct InlinePayload {
+  std::array<char, N> bytes_{};
+};
+
+/* ======================================================================
+   === Observers ========================================================
+   ====================================================================== */
+
+// noinline, so that the call (and the argument passing) really happens. The
+// DoNotOptimize tells the compiler that the whole payload is used, or it may
+// notice that only the last byte is and pass just that one.
+template <size_t N>
+__attribute__((noinline)) char ObserveByValue(InlinePayload<N> payload) {
+  benchmark::DoNotOptimize(payload);
+  return payload.bytes_[N - 1];
+}
+
+template <size_t N>
+__attribute__((noinline)) char ObserveByConstRef(const InlinePayload<N> &payload) {
+  benchmark::DoNotOptimize(payload);
+  return payload.bytes_[N - 1];
+}
+
+__attribute__((noinline)) char ObserveVectorByValue(std::vector<char> payload) { return payload.back(); }
+__attribute__((noinline)) char ObserveVectorByConstRef(const std::vector<char> &payload) { return payload.back(); }
+
+template <size_t N>
+static void BM_InlineObserveByValue(benchmark::State &state) {
+  InlinePayload<N> payload;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ObserveByValue(payload));
+  }
+  state.SetBytesProcessed(state.iterations() * N);
+}
+
+template <size_t N>
+static void BM_InlineObserveByConstRef(benchmark::State &state) {
+  InlinePayload<N> payload;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ObserveByConstRef(payload));
+  }
+  state.SetBytesProcessed(state.iterations() * N);
+}
+
+// Inline payloads stop at 64 KB. Past that, passing by value would need a
+// very large stack frame, which is a bad idea even before you measure it.
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 8);
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 16);
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 64);
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 512);
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 4096);
+BENCHMARK_TEMPLATE(BM_InlineObserveByValue, 65536);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 8);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 16);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 64);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 512);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 4096);
+BENCHMARK_TEMPLATE(BM_InlineObserveByConstRef, 65536);
+
+static void BM_VectorObserveByValue(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ObserveVectorByValue(payload));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorObserveByValue)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_VectorObserveByConstRef(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ObserveVectorByConstRef(payload));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorObserveByConstRef)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+/* ======================================================================
+   === Sinks ============================================================
+   ====================================================================== */
+
+// A sink that takes a const reference has to copy to keep the argument.
+__attribute__((noinline)) std::vector<char> SinkByConstRef(const std::vector<char> &payload) { return payload; }
+
+// A sink that takes an rvalue reference can only be called with something
+// the caller gives up, and steals it.
+__attribute__((noinline)) std::vector<char> SinkByRvalueRef(std::vector<char> &&payload) {
+  return std::move(payload);
+}
+
+// A sink that takes its argument by value lets the caller decide: pass an
+// lvalue and it's copied into the parameter, std::move it and it's moved.
+__attribute__((noinline)) std::vector<char> SinkByValue(std::vector<char> payload) { return payload; }
+
+// Every sink hands the vector back, so that the next iteration has one
+// again, and only the passing convention differs between the benchmarks.
+static void BM_VectorSinkByConstRef(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    std::vector<char> kept = SinkByConstRef(payload);
+    benchmark::DoNotOptimize(kept.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSinkByConstRef)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_VectorSinkByRvalueRef(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    payload = SinkByRvalueRef(std::move(payload));
+    benchmark::DoNotOptimize(payload.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSinkByRvalueRef)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_VectorSinkByValueMoved(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    payload = SinkByValue(std::move(payload));
+    benchmark::DoNotOptimize(payload.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSinkByValueMoved)->RangeMultiplier(8)->Range(8, 1 << 20);
+
+static void BM_VectorSinkByValueCopied(benchmark::State &state) {
+  std::vector<char> payload(state.range(0), 1);
+  for (auto _ : state) {
+    std::vector<char> kept = SinkByValue(payload);
+    benchmark::DoNotOptimize(kept.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VectorSinkByValueCopied)->RangeMultiplier(8)->Range(8, 1 << 20);
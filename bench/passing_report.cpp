@@ -0,0 +1,262 @@
+/**
+ * @file passing_report.cpp
+ * @brief A compile-time report on how the types and functions in src/ should
+ * be passed, built from the <type_traits> library.
+ */
+
+// Whether a parameter should be passed by value, by (const) reference or by
+// rvalue reference depends on two things:
+// 1. What the function does with it. It can only look at it ("observe"),
+//    change the caller's object ("modify"), keep it ("sink"), or only use
+//    the object that a smart pointer points to ("use pointee").
+// 2. What the type is like. Is it cheap to copy (trivially copyable and at
+//    most two registers big)? Can it be copied at all? Can it be moved
+//    without throwing?
+// The answers to 2. are all available at compile time from <type_traits>,
+// so this program computes its recommendations with constexpr functions,
+// and the static_asserts at the bottom check a few of them while compiling.
+
+// The rules follow the C++ Core Guidelines (F.16 to F.18 and R.30):
+// - Observe: pass cheap-to-copy types by value, everything else by const&.
+// - Modify: pass by (non-const) lvalue reference.
+// - Sink: pass by value (the caller picks copy or move) or by &&, which
+//   is the same for move-only types.
+// - Use pointee: pass a reference or pointer to the object, not the smart
+//   pointer, so the function doesn't care how the object is owned.
+
+// Includes std::printf.
+#include <cstdio>
+// Includes std::unique_ptr, std::shared_ptr.
+#include <memory>
+// Includes std::string.
+#include <string>
+// Includes the type traits.
+#include <type_traits>
+// Includes the vector container.
+#include <vector>
+
+#include "bootcamp_types.h"
+
+enum class Intent { OBSERVE, MODIFY, SINK, USE_POINTEE };
+enum class Convention { BY_VALUE, LVALUE_REF, CONST_REF, RVALUE_REF };
+
+constexpr const char *IntentName(Intent intent) {
+  switch (intent) {
+    case Intent::OBSERVE:
+      return "observe";
+    case Intent::MODIFY:
+      return "modify";
+    case Intent::SINK:
+      return "sink";
+    case Intent::USE_POINTEE:
+      return "use pointee";
+  }
+  return "";
+}
+
+constexpr const char *ConventionName(Convention convention) {
+  switch (convention) {
+    case Convention::BY_VALUE:
+      return "T";
+    case Convention::LVALUE_REF:
+      return "T&";
+    case Convention::CONST_REF:
+      return "const T&";
+    case Convention::RVALUE_REF:
+      return "T&&";
+  }
+  return "";
+}
+
+// Cheap to copy: no copy constructor to run, and it fits in two registers.
+template <typename T>
+constexpr bool IsCheapToCopy() {
+  return std::is_trivially_copyable_v<T> && sizeof(T) <= 2 * sizeof(void *);
+}
+
+template <typename T>
+struct IsSmartPointer : std::false_type {};
+template <typename T>
+struct IsSmartPointer<std::unique_ptr<T>> : std::true_type {};
+template <typename T>
+struct IsSmartPointer<std::shared_ptr<T>> : std::true_type {};
+
+// Reads the convention off a declared parameter type.
+template <typename Param>
+constexpr Convention ConventionOf() {
+  if constexpr (std::is_rvalue_reference_v<Param>) {
+    return Convention::RVALUE_REF;
+  } else if constexpr (std::is_lvalue_reference_v<Param>) {
+    return std::is_const_v<std::remove_reference_t<Param>> ? Convention::CONST_REF : Convention::LVALUE_REF;
+  } else {
+    return Convention::BY_VALUE;
+  }
+}
+
+template <typename T>
+constexpr Convention Recommended(Intent intent) {
+  switch (intent) {
+    case Intent::OBSERVE:
+      return IsCheapToCopy<T>() ? Convention::BY_VALUE : Convention::CONST_REF;
+    case Intent::MODIFY:
+      return Convention::LVALUE_REF;
+    case Intent::SINK:
+      return Convention::BY_VALUE;
+    case Intent::USE_POINTEE:
+      return Convention::LVALUE_REF;
+  }
+  return Convention::BY_VALUE;
+}
+
+enum class Verdict { OK, NEEDLESS_COPY, SHOULD_BE_CONST, RVALUE_REF_WITHOUT_SINK, PASS_THE_POINTEE, CONST_REF_SINK };
+
+constexpr const char *VerdictMessage(Verdict verdict) {
+  switch (verdict) {
+    case Verdict::OK:
+      return "ok";
+    case Verdict::NEEDLESS_COPY:
+      return "copies the argument only to look at it; take it by const&";
+    case Verdict::SHOULD_BE_CONST:
+      return "never changes the argument; take it by const&";
+    case Verdict::RVALUE_REF_WITHOUT_SINK:
+      return "takes && but doesn't keep the argument, so callers must std::move an object they still use";
+    case Verdict::PASS_THE_POINTEE:
+      return "only uses the pointee; take a reference to it instead of the smart pointer";
+    case Verdict::CONST_REF_SINK:
+      return "keeps the argument, so it always copies; take it by value and std::move it in";
+  }
+  return "";
+}
+
+// Checks a declared parameter type against what the function does with it.
+template <typename Param>
+constexpr Verdict Check(Intent intent) {
+  using T = std::remove_cv_t<std::remove_reference_t<Param>>;
+  constexpr Convention declared = ConventionOf<Param>();
+  switch (intent) {
+    case Intent::OBSERVE:
+      if (declared == Convention::BY_VALUE && !IsCheapToCopy<T>()) {
+        return Verdict::NEEDLESS_COPY;
+      }
+      if (declared == Convention::LVALUE_REF) {
+        return Verdict::SHOULD_BE_CONST;
+      }
+      if (declared == Convention::RVALUE_REF) {
+        return Verdict::RVALUE_REF_WITHOUT_SINK;
+      }
+      return Verdict::OK;
+    case Intent::MODIFY:
+      return declared == Convention::RVALUE_REF ? Verdict::RVALUE_REF_WITHOUT_SINK : Verdict::OK;
+    case Intent::SINK:
+      if (declared == Convention::CONST_REF && std::is_nothrow_move_constructible_v<T>) {
+        return Verdict::CONST_REF_SINK;
+      }
+      return Verdict::OK;
+    case Intent::USE_POINTEE:
+      return IsSmartPointer<T>::value ? Verdict::PASS_THE_POINTEE : Verdict::OK;
+  }
+  return Verdict::OK;
+}
+
+/* ======================================================================
+   === Part 1: the types ================================================
+   ====================================================================== */
+
+template <typename T>
+void ReportType(const char *name) {
+  std::printf("%-26s %8zu  %-9s %-9s %-9s %-9s %-9s %-9s\n", name, sizeof(T),
+              std::is_trivially_copyable_v<T> ? "yes" : "no", std::is_copy_constructible_v<T> ? "yes" : "no",
+              std::is_nothrow_move_constructible_v<T> ? "yes" : "no", ConventionName(Recommended<T>(Intent::OBSERVE)),
+              ConventionName(Recommended<T>(Intent::MODIFY)), ConventionName(Recommended<T>(Intent::SINK)));
+}
+
+/* ======================================================================
+   === Part 2: the call sites ===========================================
+   ====================================================================== */
+
+// The first parameter type of a function type like void(std::vector<int> &&).
+template <typename Fn>
+struct FirstParam;
+template <typename R, typename P, typename... Rest>
+struct FirstParam<R(P, Rest...)> {
+  using type = P;
+};
+
+// One row per function parameter in the tutorial files. The signatures are
+// copied from the files, since each of them is its own program.
+struct CallSite {
+  const char *file_;
+  const char *function_;
+  Intent intent_;
+  Verdict verdict_;
+};
+
+#define CALL_SITE(file, function, signature, intent) \
+  CallSite { file, function, intent, Check<FirstParam<signature>::type>(intent) }
+
+constexpr CallSite CALL_SITES[] = {
+    CALL_SITE("references.cpp", "add_three(int &a)", void(int &), Intent::MODIFY),
+    CALL_SITE("vectors.cpp", "print_int_vector(const std::vector<int> &vec)", void(const std::vector<int> &),
+              Intent::OBSERVE),
+    CALL_SITE("move_semantics.cpp", "move_add_three_and_print(std::vector<int> &&vec)", void(std::vector<int> &&),
+              Intent::SINK),
+    CALL_SITE("move_semantics.cpp", "add_three_and_print(std::vector<int> &&vec)", void(std::vector<int> &&),
+              Intent::MODIFY),
+    CALL_SITE("move_constructors.cpp", "Person(uint32_t age, std::vector<std::string> &&nicknames)",
+              void(std::vector<std::string> &&), Intent::SINK),
+    CALL_SITE("unique_ptr.cpp", "SetXTo445(std::unique_ptr<Point> &ptr)", void(std::unique_ptr<Point> &),
+              Intent::USE_POINTEE),
+    CALL_SITE("shared_ptr.cpp", "modify_ptr_via_ref(std::shared_ptr<Point> &point)", void(std::shared_ptr<Point> &),
+              Intent::USE_POINTEE),
+    CALL_SITE("shared_ptr.cpp", "modify_ptr_via_rvalue_ref(std::shared_ptr<Point> &&point)",
+              void(std::shared_ptr<Point> &&), Intent::USE_POINTEE),
+    CALL_SITE("shared_ptr.cpp", "copy_shared_ptr_in_function(std::shared_ptr<Point> point)",
+              void(std::shared_ptr<Point>), Intent::OBSERVE),
+    CALL_SITE("s24_my_ptr.cpp", "take_ownership(std::unique_ptr<int> p)", void(std::unique_ptr<int>), Intent::SINK),
+    CALL_SITE("s24_my_ptr.cpp", "not_take_ownership(int *p)", void(int *), Intent::OBSERVE),
+};
+
+#undef CALL_SITE
+
+// The checks run at compile time, so they can also be static_asserts. If
+// one of these call sites changes for the worse, this file stops compiling.
+static_assert(Check<const std::vector<int> &>(Intent::OBSERVE) == Verdict::OK);
+static_assert(Check<std::vector<int> &&>(Intent::SINK) == Verdict::OK);
+static_assert(Check<std::unique_ptr<int>>(Intent::SINK) == Verdict::OK);
+static_assert(Check<std::shared_ptr<Point>>(Intent::OBSERVE) == Verdict::NEEDLESS_COPY);
+static_assert(Check<Point>(Intent::OBSERVE) == Verdict::OK, "Point is 8 bytes and trivially copyable");
+
+int main() {
+  std::printf("Part 1: types\n");
+  std::printf("%-26s %8s  %-9s %-9s %-9s %-9s %-9s %-9s\n", "type", "sizeof", "trivial", "copyable", "nothrow",
+              "observe", "modify", "sink");
+  std::printf("%-26s %8s  %-9s %-9s %-9s %-9s %-9s %-9s\n", "", "", "copy", "", "move", "as", "as", "as");
+  ReportType<int>("int");
+  ReportType<Point>("Point");
+  ReportType<Person>("Person");
+  ReportType<IntPtrManager>("IntPtrManager");
+  ReportType<Pointer<int>>("Pointer<int>");
+  ReportType<std::string>("std::string");
+  ReportType<std::vector<int>>("std::vector<int>");
+  ReportType<std::vector<std::string>>("std::vector<std::string>");
+  ReportType<std::unique_ptr<Point>>("std::unique_ptr<Point>");
+  ReportType<std::shared_ptr<Point>>("std::shared_ptr<Point>");
+
+  // A move constructor that isn't noexcept makes std::vector copy instead
+  // of move when it grows, or, for move-only types, gives up the strong
+  // exception guarantee.
+  std::printf("\nNote: a type without a nothrow move is copied (or moved unsafely) when a std::vector grows.\n");
+
+  std::printf("\nPart 2: call sites\n");
+  size_t flagged = 0;
+  for (const CallSite &site : CALL_SITES) {
+    std::printf("%-22s %-62s [%s] %s\n", site.file_, site.function_, IntentName(site.intent_),
+                VerdictMessage(site.verdict_));
+    flagged += site.verdict_ == Verdict::OK ? 0 : 1;
+  }
+  std::printf("\n%zu of %zu call sites flagged. Some of them are on purpose: the tutorial files show\n"
+              "every way of passing an argument, including the ones you shouldn't copy.\n",
+              flagged, sizeof(CALL_SITES) / sizeof(CALL_SITES[0]));
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file sync_bench.cpp
+ * @brief Benchmarks for the patterns in mutex.cpp, scoped_lock.cpp,
+ * rwlock.cpp and condition_variable.cpp at varying thread counts.
+ */
+
+// Google Benchmark runs a ->Threads(n) benchmark on n threads at once, and
+// every thread runs the loop body. The state they share is static, like the
+// global count and m in the tutorial files. UseRealTime() reports the wall
+// clock time, which is what matters when threads wait on each other.
+
+// Includes std::atomic.
+#include <atomic>
+// Includes std::condition_variable.
+#include <condition_variable>
+// Includes std::mutex, std::scoped_lock, std::unique_lock.
+#include <mutex>
+// Includes std::shared_mutex, std::shared_lock.
+#include <shared_mutex>
+// Includes std::thread.
+#include <thread>
+// Includes the vector container.
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+/* ======================================================================
+   === mutex.cpp and scoped_lock.cpp ====================================
+   ====================================================================== */
+
+// mutex.cpp's add_count: lock, increment, unlock.
+static void BM_MutexIncrement(benchmark::State &state) {
+  static std::mutex m;
+  static int count = 0;
+  for (auto _ : state) {
+    m.lock();
+    count += 1;
+    // Only while holding the lock: other threads may still be incrementing.
+    benchmark::DoNotOptimize(count);
+    m.unlock();
+  }
+}
+BENCHMARK(BM_MutexIncrement)->ThreadRange(1, 8)->UseRealTime();
+
+// scoped_lock.cpp's add_count, with an RAII lock instead of lock/unlock.
+static void BM_ScopedLockIncrement(benchmark::State &state) {
+  static std::mutex m;
+  static int count = 0;
+  for (auto _ : state) {
+    std::scoped_lock slk(m);
+    count += 1;
+    benchmark::DoNotOptimize(count);
+  }
+}
+BENCHMARK(BM_ScopedLockIncrement)->ThreadRange(1, 8)->UseRealTime();
+
+// std::scoped_lock can also lock several mutexes at once without deadlock.
+static void BM_ScopedLockTwoMutexes(benchmark::State &state) {
+  static std::mutex m1;
+  static std::mutex m2;
+  static int count = 0;
+  for (auto _ : state) {
+    std::scoped_lock slk(m1, m2);
+    count += 1;
+    benchmark::DoNotOptimize(count);
+  }
+}
+BENCHMARK(BM_ScopedLockTwoMutexes)->ThreadRange(1, 8)->UseRealTime();
+
+// The lock-free way to do the same increment, for comparison.
+static void BM_AtomicIncrement(benchmark::State &state) {
+  static std::atomic<int> count{0};
+  for (auto _ : state) {
+    count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+BENCHMARK(BM_AtomicIncrement)->ThreadRange(1, 8)->UseRealTime();
+
+/* ======================================================================
+   === rwlock.cpp =======================================================
+   ====================================================================== */
+
+// rwlock.cpp's read_value and write_value on a std::shared_mutex. Every
+// thread writes once every range(0) operations and reads otherwise (0 means
+// it never writes), so the benchmark goes from read-only to write-heavy.
+static void BM_SharedMutexReadMostly(benchmark::State &state) {
+  static std::shared_mutex m;
+  static int count = 0;
+  int64_t write_every = state.range(0);
+  int64_t i = 0;
+  for (auto _ : state) {
+    if (write_every > 0 && ++i % write_every == 0) {
+      std::unique_lock lk(m);
+      count += 3;
+    } else {
+      std::shared_lock lk(m);
+      benchmark::DoNotOptimize(count);
+    }
+  }
+}
+BENCHMARK(BM_SharedMutexReadMostly)
+    ->ArgName("write_every")
+    ->Arg(0)
+    ->Arg(10)
+    ->Arg(1000)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// The same mix with a plain mutex, which makes readers wait for each other.
+static void BM_MutexReadMostly(benchmark::State &state) {
+  static std::mutex m;
+  static int count = 0;
+  int64_t write_every = state.range(0);
+  int64_t i = 0;
+  for (auto _ : state) {
+    std::scoped_lock lk(m);
+    if (write_every > 0 && ++i % write_every == 0) {
+      count += 3;
+    } else {
+      benchmark::DoNotOptimize(count);
+    }
+  }
+}
+BENCHMARK(BM_MutexReadMostly)
+    ->ArgName("write_every")
+    ->Arg(0)
+    ->Arg(10)
+    ->Arg(1000)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+/* ======================================================================
+   === condition_variable.cpp ===========================================
+   ====================================================================== */
+
+// condition_variable.cpp has a waiter that sleeps until count reaches a
+// value, and a thread that bumps count and notifies. Here, two threads do
+// that back and forth ("ping-pong"), so each iteration is one round trip
+// of notify and wake-up.
+static void BM_ConditionVariablePingPong(benchmark::State &state) {
+  std::mutex m;
+  std::condition_variable cv;
+  int turn = 0;
+  bool done = false;
+
+  std::thread partner([&] {
+    std::unique_lock lk(m);
+    while (true) {
+      cv.wait(lk, [&] { return turn == 1 || done; });
+      if (done) {
+        return;
+      }
+      turn = 0;
+      cv.notify_one();
+    }
+  });
+
+  for (auto _ : state) {
+    std::unique_lock lk(m);
+    turn = 1;
+    cv.notify_one();
+    cv.wait(lk, [&] { return turn == 0; });
+  }
+
+  {
+    std::scoped_lock lk(m);
+    done = true;
+  }
+  cv.notify_one();
+  partner.join();
+}
+BENCHMARK(BM_ConditionVariablePingPong)->UseRealTime();
+
+// n producers each add to count and notify one consumer, which waits until
+// all of them have, like add_count_and_notify and waiter_thread.
+static void BM_ConditionVariableFanIn(benchmark::State &state) {
+  int64_t producers = state.range(0);
+  for (auto _ : state) {
+    std::mutex m;
+    std::condition_variable cv;
+    int count = 0;
+    std::thread waiter([&] {
+      std::unique_lock lk(m);
+      cv.wait(lk, [&] { return count == producers; });
+    });
+    std::vector<std::thread> threads;
+    for (int64_t i = 0; i < producers; ++i) {
+      threads.emplace_back([&] {
+        std::scoped_lock slk(m);
+        count += 1;
+        if (count == producers) {
+          cv.notify_one();
+        }
+      });
+    }
+    for (std::thread &t : threads) {
+      t.join();
+    }
+    waiter.join();
+  }
+}
+BENCHMARK(BM_ConditionVariableFanIn)->ArgName("producers")->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
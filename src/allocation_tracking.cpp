@@ -0,0 +1,133 @@
+/**
+ * @file allocation_tracking.cpp
+ * @brief Tutorial code for measuring allocations, copies and moves.
+ */
+
+// move_semantics.cpp and move_constructors.cpp explain that moving an object
+// is cheaper than copying it, because a move can steal the object's heap
+// memory instead of making a deep copy of it. This file measures that
+// claim, using the instrumentation in instrumentation/alloc_tracker.h.
+
+// This executable is always linked with the allocation tracker. To link it
+// into every other example too, configure CMake with
+//   $ cmake -DBOOTCAMP_TRACK_ALLOCATIONS=ON ..
+// Each example then prints a line like this when it exits:
+//   [alloc_tracker] at exit: 5 allocations (73776 bytes), ...
+
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::string.
+#include <string>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+#include "instrumentation/alloc_tracker.h"
+
+// The Person class from move_constructors.cpp, without the print
+// statements, and with a CopyMoveCounter member so that every copy and move
+// of a Person is counted. Unlike in move_constructors.cpp, Person is also
+// copyable here, so that we can compare the two.
+class Person {
+ public:
+  Person(uint32_t age, std::vector<std::string> &&nicknames) : age_(age), nicknames_(std::move(nicknames)) {}
+
+  Person(const Person &) = default;
+  Person &operator=(const Person &) = default;
+  Person(Person &&) noexcept = default;
+  Person &operator=(Person &&) noexcept = default;
+
+  uint32_t GetAge() const { return age_; }
+
+ private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  alloc_tracker::CopyMoveCounter counter_;
+};
+
+// The same Person, but the move constructor isn't marked noexcept. We'll
+// see below why that matters.
+class ThrowingMovePerson {
+ public:
+  ThrowingMovePerson(uint32_t age, std::vector<std::string> &&nicknames)
+      : age_(age), nicknames_(std::move(nicknames)) {}
+
+  ThrowingMovePerson(const ThrowingMovePerson &) = default;
+  ThrowingMovePerson &operator=(const ThrowingMovePerson &) = default;
+  ThrowingMovePerson(ThrowingMovePerson &&other) : age_(other.age_), nicknames_(std::move(other.nicknames_)),
+                                                   counter_(std::move(other.counter_)) {}
+  ThrowingMovePerson &operator=(ThrowingMovePerson &&) = default;
+
+ private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  alloc_tracker::CopyMoveCounter counter_;
+};
+
+std::vector<std::string> Nicknames() {
+  // The long nickname doesn't fit in std::string's inline buffer, so it
+  // needs a heap allocation of its own.
+  return {"andy", "pavlo", "the database systems professor"};
+}
+
+template <typename P>
+void GrowVector(const char *name) {
+  std::vector<P> people;
+  for (uint32_t i = 0; i < 8; ++i) {
+    people.emplace_back(i, Nicknames());
+  }
+  alloc_tracker::Scope scope(name);
+  // Growing past the capacity of 8 makes the vector move (or copy!) every
+  // Person into a new buffer.
+  people.emplace_back(8, Nicknames());
+}
+
+int main() {
+  Person andy(15445, Nicknames());
+
+  // A copy of andy needs a new nicknames vector and a new copy of the long
+  // nickname. That's 2 allocations.
+  {
+    alloc_tracker::Scope scope("copy a Person");
+    Person andy_copy(andy);
+  }
+
+  // A move of andy steals the vector's buffer. That's 0 allocations.
+  {
+    alloc_tracker::Scope scope("move a Person");
+    Person andy_moved(std::move(andy));
+  }
+
+  // When a std::vector grows, it moves its elements to the new buffer only
+  // if their move constructor is noexcept. Otherwise, it copies them, so
+  // that it can still back out if a move throws halfway through. So this
+  // missing noexcept makes every growth copy every element.
+  GrowVector<Person>("grow a vector of Person (noexcept move)");
+  GrowVector<ThrowingMovePerson>("grow a vector of ThrowingMovePerson");
+
+  // A TrackingAllocator counts one container's allocations separately from
+  // the rest of the program. Here, we count how often a vector that grows
+  // one push_back at a time allocates.
+  alloc_tracker::ContainerStats stats;
+  std::vector<int, alloc_tracker::TrackingAllocator<int>> numbers{alloc_tracker::TrackingAllocator<int>(&stats)};
+  for (int i = 0; i < 1000; ++i) {
+    numbers.push_back(i);
+  }
+  std::cout << "1000 push_backs made " << stats.allocations_ << " allocations (" << stats.bytes_allocated_
+            << " bytes in total)\n";
+
+  // And with a reserve up front, just one.
+  alloc_tracker::ContainerStats reserved_stats;
+  std::vector<int, alloc_tracker::TrackingAllocator<int>> reserved{
+      alloc_tracker::TrackingAllocator<int>(&reserved_stats)};
+  reserved.reserve(1000);
+  for (int i = 0; i < 1000; ++i) {
+    reserved.push_back(i);
+  }
+  std::cout << "1000 push_backs after a reserve made " << reserved_stats.allocations_ << " allocations\n";
+
+  return 0;
+}
@@ -0,0 +1,784 @@
+/**
+ * @file bplus_tree_set.cpp
+ * @brief Tutorial code for a cache-friendly in-memory B+tree set.
+ */
+
+// sets.cpp introduces std::set, which is usually a red-black tree. A
+// red-black tree allocates one node per key, and every node holds a key, a
+// color, and three pointers. That means a std::set<int> spends around 40
+// bytes to store a 4 byte key, and a lookup follows ~log2(n) pointers to
+// nodes that are scattered all over the heap, each of which is usually a
+// cache miss. Iterating over a range isn't much better, since neighboring
+// keys don't live next to each other in memory either.
+
+// A B+tree fixes both problems by storing many keys per node:
+//  1. Nodes are sized and aligned to a few cache lines, so reading one node
+//     is a few sequential memory accesses instead of one miss per key.
+//  2. Inner nodes only hold separator keys and child pointers. With ~20
+//     children per node, a million keys fit in a tree of height 5, instead
+//     of a red-black tree of height ~20-40.
+//  3. All keys live in the leaves, which are linked together left to right.
+//     An ordered scan is a walk over densely packed sorted arrays.
+// You'll implement a disk-based version of this data structure in the
+// 15-445/645 projects. Here we keep everything in memory and focus on the
+// layout.
+
+// The BPlusTreeSet class below supports the same insert/find/count/erase
+// and ordered iteration operations as the std::set used in sets.cpp, plus a
+// lower_bound based range scan and bulk loading from sorted input.
+
+// Includes std::lower_bound, std::upper_bound, std::sort and std::copy.
+#include <algorithm>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::allocator.
+#include <memory>
+// Includes std::mt19937.
+#include <random>
+// Includes the set container we compare against.
+#include <set>
+// Includes std::swap and std::move.
+#include <utility>
+// Includes std::vector.
+#include <vector>
+
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Every node starts with the same small header, so we can tell leaves from
+// inner nodes while descending the tree.
+struct BPlusTreeNodeBase {
+  uint16_t count_{0};
+  bool is_leaf_;
+  explicit BPlusTreeNodeBase(bool is_leaf) : is_leaf_(is_leaf) {}
+};
+
+// BPlusTreeSet<Key, NodeLines> stores unique keys in sorted order. Every node
+// is exactly NodeLines cache lines in size and is aligned to a cache line. A
+// single 64 byte line only has room for four separator keys plus their child
+// pointers in an inner node, so we default to four cache lines per node,
+// which gives int keys a fanout of 20 and 61 keys per leaf.
+template <typename Key, size_t NodeLines = 4>
+class BPlusTreeSet {
+  static constexpr size_t NODE_BYTES = NodeLines * CACHE_LINE_SIZE;
+
+  // A leaf holds a sorted array of keys and a pointer to its right sibling.
+  static constexpr size_t LEAF_SLOTS =
+      (NODE_BYTES - sizeof(BPlusTreeNodeBase) - sizeof(void *)) / sizeof(Key);
+  struct alignas(CACHE_LINE_SIZE) LeafNode : BPlusTreeNodeBase {
+    LeafNode() : BPlusTreeNodeBase(true) {}
+    Key keys_[LEAF_SLOTS];
+    LeafNode *next_{nullptr};
+  };
+
+  // An inner node with count_ separator keys has count_ + 1 children. All
+  // keys in children_[i + 1] are >= keys_[i], and all keys in children_[i]
+  // are < keys_[i].
+  static constexpr size_t INNER_SLOTS =
+      (NODE_BYTES - sizeof(BPlusTreeNodeBase) - 2 * sizeof(void *)) /
+      (sizeof(Key) + sizeof(void *));
+  struct alignas(CACHE_LINE_SIZE) InnerNode : BPlusTreeNodeBase {
+    InnerNode() : BPlusTreeNodeBase(false) {}
+    Key keys_[INNER_SLOTS];
+    BPlusTreeNodeBase *children_[INNER_SLOTS + 1];
+  };
+
+  static_assert(sizeof(LeafNode) == NODE_BYTES, "leaf must fill its cache lines");
+  static_assert(sizeof(InnerNode) <= NODE_BYTES, "inner node must fit its cache lines");
+
+  // A node (other than the root) must stay at least half full.
+  static constexpr size_t LEAF_MIN = LEAF_SLOTS / 2;
+  static constexpr size_t INNER_MIN = INNER_SLOTS / 2;
+
+ public:
+  // The iterator is a (leaf, slot) pair. Incrementing it walks along the
+  // leaf array, and hops to the next leaf at the end of the array.
+  class Iterator {
+   public:
+    Iterator(LeafNode *leaf, size_t slot) : leaf_(leaf), slot_(slot) {}
+
+    const Key &operator*() const { return leaf_->keys_[slot_]; }
+    const Key *operator->() const { return &leaf_->keys_[slot_]; }
+
+    Iterator &operator++() {
+      slot_ += 1;
+      if (slot_ == leaf_->count_) {
+        leaf_ = leaf_->next_;
+        slot_ = 0;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    bool operator==(const Iterator &other) const { return leaf_ == other.leaf_ && slot_ == other.slot_; }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+   private:
+    friend class BPlusTreeSet;
+    LeafNode *leaf_;
+    size_t slot_;
+  };
+  using iterator = Iterator;
+
+  BPlusTreeSet() : root_(NewLeaf()) {}
+
+  ~BPlusTreeSet() { FreeNode(root_); }
+
+  // The tree owns its nodes, so copying is disabled, just like in the
+  // wrapper classes from wrapper_class.cpp. Moving transfers the root, and
+  // leaves the other tree without one: an empty tree that allocates its root
+  // on the next insert, so that moving never allocates or throws.
+  BPlusTreeSet(const BPlusTreeSet &) = delete;
+  BPlusTreeSet &operator=(const BPlusTreeSet &) = delete;
+  BPlusTreeSet(BPlusTreeSet &&other) noexcept
+      : size_(std::exchange(other.size_, 0)),
+        nodes_(std::exchange(other.nodes_, 0)),
+        root_(std::exchange(other.root_, nullptr)) {}
+  BPlusTreeSet &operator=(BPlusTreeSet &&other) noexcept {
+    std::swap(root_, other.root_);
+    std::swap(size_, other.size_);
+    std::swap(nodes_, other.nodes_);
+    return *this;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns the number of bytes used by all nodes of the tree.
+  size_t MemoryUsage() const { return nodes_ * NODE_BYTES; }
+
+  iterator begin() const {
+    if (root_ == nullptr) {
+      return end();
+    }
+    BPlusTreeNodeBase *node = root_;
+    while (!node->is_leaf_) {
+      node = static_cast<InnerNode *>(node)->children_[0];
+    }
+    LeafNode *leaf = static_cast<LeafNode *>(node);
+    return leaf->count_ == 0 ? end() : Iterator(leaf, 0);
+  }
+  iterator end() const { return Iterator(nullptr, 0); }
+
+  // Returns an iterator to the first key that is >= key.
+  iterator lower_bound(const Key &key) const {
+    if (root_ == nullptr) {
+      return end();
+    }
+    LeafNode *leaf = FindLeaf(key);
+    size_t slot = std::lower_bound(leaf->keys_, leaf->keys_ + leaf->count_, key) - leaf->keys_;
+    if (slot == leaf->count_) {
+      // The separator keys only guarantee that key < the first key of the
+      // next leaf, so the answer is at the start of the next leaf.
+      return leaf->next_ == nullptr ? end() : Iterator(leaf->next_, 0);
+    }
+    return Iterator(leaf, slot);
+  }
+
+  iterator find(const Key &key) const {
+    iterator it = lower_bound(key);
+    if (it != end() && !(key < *it)) {
+      return it;
+    }
+    return end();
+  }
+
+  size_t count(const Key &key) const { return find(key) != end() ? 1 : 0; }
+
+  // Like std::set::insert, returns an iterator to the key and whether it was
+  // newly inserted.
+  std::pair<iterator, bool> insert(const Key &key) {
+    if (root_ == nullptr) {
+      root_ = NewLeaf();
+    }
+    Key separator;
+    BPlusTreeNodeBase *new_sibling = nullptr;
+    bool inserted = InsertInto(root_, key, &separator, &new_sibling);
+    if (new_sibling != nullptr) {
+      // The root split, so the tree grows by one level at the top.
+      InnerNode *new_root = NewInner();
+      new_root->count_ = 1;
+      new_root->keys_[0] = separator;
+      new_root->children_[0] = root_;
+      new_root->children_[1] = new_sibling;
+      root_ = new_root;
+    }
+    if (inserted) {
+      size_ += 1;
+    }
+    return {find(key), inserted};
+  }
+
+  // Provided for parity with std::set; there is nothing to construct in
+  // place for a set of trivially copyable keys.
+  std::pair<iterator, bool> emplace(const Key &key) { return insert(key); }
+
+  // Erases key and returns the number of keys erased (0 or 1).
+  size_t erase(const Key &key) {
+    if (root_ == nullptr || !EraseFrom(root_, key)) {
+      return 0;
+    }
+    size_ -= 1;
+    // If the root is an inner node with a single child, the tree shrinks by
+    // one level at the top.
+    if (!root_->is_leaf_ && root_->count_ == 0) {
+      InnerNode *old_root = static_cast<InnerNode *>(root_);
+      root_ = old_root->children_[0];
+      delete old_root;
+      nodes_ -= 1;
+    }
+    return 1;
+  }
+
+  // Erases the key at pos and returns an iterator to the key after it. Any
+  // other iterators into the tree are invalidated, since erasing may move
+  // keys between leaves.
+  iterator erase(iterator pos) {
+    Key key = *pos;
+    erase(key);
+    return lower_bound(key);
+  }
+
+  // Erases all keys in [first, last). We remember the keys before erasing
+  // anything, since erasing invalidates iterators.
+  iterator erase(iterator first, iterator last) {
+    bool to_end = last == end();
+    Key last_key{};
+    if (!to_end) {
+      last_key = *last;
+    }
+    std::vector<Key> keys;
+    for (iterator it = first; it != last; ++it) {
+      keys.push_back(*it);
+    }
+    for (const Key &key : keys) {
+      erase(key);
+    }
+    return to_end ? end() : lower_bound(last_key);
+  }
+
+  // Calls fn on every key in [low, high), in order. This is the operation
+  // that B+trees are best at: one descent to the first leaf, and then a
+  // sequential walk over packed key arrays.
+  template <typename Fn>
+  void RangeScan(const Key &low, const Key &high, Fn fn) const {
+    for (iterator it = lower_bound(low); it != end() && *it < high; ++it) {
+      fn(*it);
+    }
+  }
+
+  // Replaces the contents of the tree with the keys in [first, last), which
+  // must be sorted and unique. Instead of inserting keys one at a time, we
+  // pack the leaves left to right and then build each inner level on top of
+  // the level below it. This touches every node exactly once.
+  //
+  // The new tree is built on the side, and only replaces the old one once
+  // every allocation has succeeded. If one throws, the nodes built so far
+  // are freed, and the tree keeps its old contents.
+  template <typename InputIt>
+  void BulkLoad(InputIt first, InputIt last) {
+    // We fill leaves to the brim, except that the last two leaves share
+    // their keys so that neither of them is less than half full.
+    std::vector<Key> keys(first, last);
+    size_t num_leaves = std::max<size_t>(1, (keys.size() + LEAF_SLOTS - 1) / LEAF_SLOTS);
+    // Reserving up front means that only the node allocations can throw
+    // once nodes exist.
+    std::vector<BPlusTreeNodeBase *> level;
+    std::vector<Key> low_keys;
+    level.reserve(num_leaves);
+    low_keys.reserve(num_leaves);
+    std::vector<BPlusTreeNodeBase *> parents;
+    std::vector<Key> parent_low_keys;
+    parents.reserve((num_leaves + INNER_SLOTS) / (INNER_SLOTS + 1));
+    parent_low_keys.reserve(parents.capacity());
+    size_t nodes = 0;
+    // level[adopted, end) are the nodes that no parent owns yet.
+    size_t adopted = 0;
+
+    try {
+      size_t pos = 0;
+      LeafNode *prev = nullptr;
+      for (size_t i = 0; i < num_leaves; ++i) {
+        size_t remaining = keys.size() - pos;
+        size_t take = std::min(remaining, LEAF_SLOTS);
+        if (i + 2 == num_leaves && remaining < LEAF_SLOTS + LEAF_MIN) {
+          take = remaining / 2;
+        }
+        LeafNode *leaf = new LeafNode();
+        nodes += 1;
+        std::copy(keys.begin() + pos, keys.begin() + pos + take, leaf->keys_);
+        leaf->count_ = take;
+        if (prev != nullptr) {
+          prev->next_ = leaf;
+        }
+        prev = leaf;
+        level.push_back(leaf);
+        low_keys.push_back(take > 0 ? leaf->keys_[0] : Key{});
+        pos += take;
+      }
+
+      // Build inner levels until only the root is left. An inner node takes
+      // up to INNER_SLOTS + 1 children, and the separator before child i is
+      // the smallest key in child i. Each level is at most as long as the
+      // one below it, so parents never has to grow.
+      while (level.size() > 1) {
+        size_t fanout = INNER_SLOTS + 1;
+        size_t num_parents = (level.size() + fanout - 1) / fanout;
+        for (size_t i = 0; i < num_parents; ++i) {
+          size_t remaining = level.size() - adopted;
+          size_t take = std::min(remaining, fanout);
+          if (i + 2 == num_parents && remaining < fanout + INNER_MIN + 1) {
+            take = remaining / 2;
+          }
+          InnerNode *inner = new InnerNode();
+          nodes += 1;
+          for (size_t j = 0; j < take; ++j) {
+            inner->children_[j] = level[adopted + j];
+            if (j > 0) {
+              inner->keys_[j - 1] = low_keys[adopted + j];
+            }
+          }
+          inner->count_ = take - 1;
+          parents.push_back(inner);
+          parent_low_keys.push_back(low_keys[adopted]);
+          adopted += take;
+        }
+        std::swap(level, parents);
+        std::swap(low_keys, parent_low_keys);
+        parents.clear();
+        parent_low_keys.clear();
+        adopted = 0;
+      }
+    } catch (...) {
+      for (size_t i = adopted; i < level.size(); ++i) {
+        FreeNode(level[i]);
+      }
+      for (BPlusTreeNodeBase *parent : parents) {
+        FreeNode(parent);
+      }
+      throw;
+    }
+
+    FreeNode(root_);
+    root_ = level[0];
+    nodes_ = nodes;
+    size_ = keys.size();
+  }
+
+ private:
+  LeafNode *NewLeaf() {
+    nodes_ += 1;
+    return new LeafNode();
+  }
+
+  InnerNode *NewInner() {
+    nodes_ += 1;
+    return new InnerNode();
+  }
+
+  // Frees node and everything below it. node is nullptr for a moved-from
+  // tree.
+  void FreeNode(BPlusTreeNodeBase *node) {
+    if (node == nullptr) {
+      return;
+    }
+    if (node->is_leaf_) {
+      delete static_cast<LeafNode *>(node);
+      return;
+    }
+    InnerNode *inner = static_cast<InnerNode *>(node);
+    for (size_t i = 0; i <= inner->count_; ++i) {
+      FreeNode(inner->children_[i]);
+    }
+    delete inner;
+  }
+
+  // Returns the index of the child of inner that may contain key.
+  static size_t ChildIndex(const InnerNode *inner, const Key &key) {
+    return std::upper_bound(inner->keys_, inner->keys_ + inner->count_, key) - inner->keys_;
+  }
+
+  LeafNode *FindLeaf(const Key &key) const {
+    BPlusTreeNodeBase *node = root_;
+    while (!node->is_leaf_) {
+      InnerNode *inner = static_cast<InnerNode *>(node);
+      node = inner->children_[ChildIndex(inner, key)];
+    }
+    return static_cast<LeafNode *>(node);
+  }
+
+  // Inserts key into the subtree rooted at node. If node had to split, the
+  // new right sibling is returned through new_sibling, and the smallest key
+  // in that sibling's subtree through separator.
+  bool InsertInto(BPlusTreeNodeBase *node, const Key &key, Key *separator, BPlusTreeNodeBase **new_sibling) {
+    if (node->is_leaf_) {
+      LeafNode *leaf = static_cast<LeafNode *>(node);
+      Key *slot = std::lower_bound(leaf->keys_, leaf->keys_ + leaf->count_, key);
+      if (slot != leaf->keys_ + leaf->count_ && !(key < *slot)) {
+        return false;
+      }
+      if (leaf->count_ < LEAF_SLOTS) {
+        std::copy_backward(slot, leaf->keys_ + leaf->count_, leaf->keys_ + leaf->count_ + 1);
+        *slot = key;
+        leaf->count_ += 1;
+        return true;
+      }
+
+      // The leaf is full, so we move the upper half of its keys into a new
+      // right sibling, then insert into whichever half the key belongs to.
+      LeafNode *right = NewLeaf();
+      size_t split = LEAF_SLOTS / 2;
+      std::copy(leaf->keys_ + split, leaf->keys_ + LEAF_SLOTS, right->keys_);
+      right->count_ = LEAF_SLOTS - split;
+      leaf->count_ = split;
+      right->next_ = leaf->next_;
+      leaf->next_ = right;
+      LeafNode *target = key < right->keys_[0] ? leaf : right;
+      Key *target_slot = std::lower_bound(target->keys_, target->keys_ + target->count_, key);
+      std::copy_backward(target_slot, target->keys_ + target->count_, target->keys_ + target->count_ + 1);
+      *target_slot = key;
+      target->count_ += 1;
+      *separator = right->keys_[0];
+      *new_sibling = right;
+      return true;
+    }
+
+    InnerNode *inner = static_cast<InnerNode *>(node);
+    size_t idx = ChildIndex(inner, key);
+    Key child_separator;
+    BPlusTreeNodeBase *child_sibling = nullptr;
+    bool inserted = InsertInto(inner->children_[idx], key, &child_separator, &child_sibling);
+    if (child_sibling == nullptr) {
+      return inserted;
+    }
+
+    if (inner->count_ < INNER_SLOTS) {
+      InsertSeparator(inner, idx, child_separator, child_sibling);
+      return inserted;
+    }
+
+    // The inner node is full too. We split it in half, and the middle
+    // separator moves up to the parent instead of staying in either half.
+    InnerNode *right = NewInner();
+    size_t split = INNER_SLOTS / 2;
+    Key middle = inner->keys_[split];
+    std::copy(inner->keys_ + split + 1, inner->keys_ + INNER_SLOTS, right->keys_);
+    std::copy(inner->children_ + split + 1, inner->children_ + INNER_SLOTS + 1, right->children_);
+    right->count_ = INNER_SLOTS - split - 1;
+    inner->count_ = split;
+    if (idx <= split) {
+      InsertSeparator(inner, idx, child_separator, child_sibling);
+    } else {
+      InsertSeparator(right, idx - split - 1, child_separator, child_sibling);
+    }
+    *separator = middle;
+    *new_sibling = right;
+    return inserted;
+  }
+
+  // Inserts separator as keys_[idx] and child as children_[idx + 1].
+  static void InsertSeparator(InnerNode *inner, size_t idx, const Key &separator, BPlusTreeNodeBase *child) {
+    std::copy_backward(inner->keys_ + idx, inner->keys_ + inner->count_, inner->keys_ + inner->count_ + 1);
+    std::copy_backward(inner->children_ + idx + 1, inner->children_ + inner->count_ + 1,
+                       inner->children_ + inner->count_ + 2);
+    inner->keys_[idx] = separator;
+    inner->children_[idx + 1] = child;
+    inner->count_ += 1;
+  }
+
+  // Erases key from the subtree rooted at node. After erasing from a child,
+  // the parent fixes up the child if it fell below half full.
+  bool EraseFrom(BPlusTreeNodeBase *node, const Key &key) {
+    if (node->is_leaf_) {
+      LeafNode *leaf = static_cast<LeafNode *>(node);
+      Key *slot = std::lower_bound(leaf->keys_, leaf->keys_ + leaf->count_, key);
+      if (slot == leaf->keys_ + leaf->count_ || key < *slot) {
+        return false;
+      }
+      std::copy(slot + 1, leaf->keys_ + leaf->count_, slot);
+      leaf->count_ -= 1;
+      return true;
+    }
+
+    InnerNode *inner = static_cast<InnerNode *>(node);
+    size_t idx = ChildIndex(inner, key);
+    if (!EraseFrom(inner->children_[idx], key)) {
+      return false;
+    }
+    BPlusTreeNodeBase *child = inner->children_[idx];
+    if (child->count_ < (child->is_leaf_ ? LEAF_MIN : INNER_MIN)) {
+      Rebalance(inner, idx);
+    }
+    return true;
+  }
+
+  // Fixes up parent->children_[idx] after it underflowed. If a neighboring
+  // sibling can spare a key, we borrow one; otherwise we merge the two.
+  void Rebalance(InnerNode *parent, size_t idx) {
+    size_t left_idx = idx > 0 ? idx - 1 : idx;
+    BPlusTreeNodeBase *left = parent->children_[left_idx];
+    BPlusTreeNodeBase *right = parent->children_[left_idx + 1];
+    size_t min = left->is_leaf_ ? LEAF_MIN : INNER_MIN;
+    BPlusTreeNodeBase *sibling = idx > 0 ? left : right;
+
+    if (sibling->count_ > min) {
+      if (left->is_leaf_) {
+        BorrowLeaf(parent, left_idx, static_cast<LeafNode *>(left), static_cast<LeafNode *>(right), sibling == left);
+      } else {
+        BorrowInner(parent, left_idx, static_cast<InnerNode *>(left), static_cast<InnerNode *>(right),
+                    sibling == left);
+      }
+      return;
+    }
+
+    // Merge right into left, and drop the separator between them from the
+    // parent.
+    if (left->is_leaf_) {
+      LeafNode *left_leaf = static_cast<LeafNode *>(left);
+      LeafNode *right_leaf = static_cast<LeafNode *>(right);
+      std::copy(right_leaf->keys_, right_leaf->keys_ + right_leaf->count_, left_leaf->keys_ + left_leaf->count_);
+      left_leaf->count_ += right_leaf->count_;
+      left_leaf->next_ = right_leaf->next_;
+      delete right_leaf;
+    } else {
+      InnerNode *left_inner = static_cast<InnerNode *>(left);
+      InnerNode *right_inner = static_cast<InnerNode *>(right);
+      left_inner->keys_[left_inner->count_] = parent->keys_[left_idx];
+      std::copy(right_inner->keys_, right_inner->keys_ + right_inner->count_,
+                left_inner->keys_ + left_inner->count_ + 1);
+      std::copy(right_inner->children_, right_inner->children_ + right_inner->count_ + 1,
+                left_inner->children_ + left_inner->count_ + 1);
+      left_inner->count_ += right_inner->count_ + 1;
+      delete right_inner;
+    }
+    nodes_ -= 1;
+    std::copy(parent->keys_ + left_idx + 1, parent->keys_ + parent->count_, parent->keys_ + left_idx);
+    std::copy(parent->children_ + left_idx + 2, parent->children_ + parent->count_ + 1,
+              parent->children_ + left_idx + 1);
+    parent->count_ -= 1;
+  }
+
+  // Moves one key from the fuller leaf to its neighbor, and updates the
+  // separator between them.
+  static void BorrowLeaf(InnerNode *parent, size_t left_idx, LeafNode *left, LeafNode *right, bool from_left) {
+    if (from_left) {
+      std::copy_backward(right->keys_, right->keys_ + right->count_, right->keys_ + right->count_ + 1);
+      right->keys_[0] = left->keys_[left->count_ - 1];
+      right->count_ += 1;
+      left->count_ -= 1;
+    } else {
+      left->keys_[left->count_] = right->keys_[0];
+      left->count_ += 1;
+      std::copy(right->keys_ + 1, right->keys_ + right->count_, right->keys_);
+      right->count_ -= 1;
+    }
+    parent->keys_[left_idx] = right->keys_[0];
+  }
+
+  // Rotates one child between two inner nodes through the parent's
+  // separator key.
+  static void BorrowInner(InnerNode *parent, size_t left_idx, InnerNode *left, InnerNode *right, bool from_left) {
+    if (from_left) {
+      std::copy_backward(right->keys_, right->keys_ + right->count_, right->keys_ + right->count_ + 1);
+      std::copy_backward(right->children_, right->children_ + right->count_ + 1, right->children_ + right->count_ + 2);
+      right->keys_[0] = parent->keys_[left_idx];
+      right->children_[0] = left->children_[left->count_];
+      right->count_ += 1;
+      parent->keys_[left_idx] = left->keys_[left->count_ - 1];
+      left->count_ -= 1;
+    } else {
+      left->keys_[left->count_] = parent->keys_[left_idx];
+      left->children_[left->count_ + 1] = right->children_[0];
+      left->count_ += 1;
+      parent->keys_[left_idx] = right->keys_[0];
+      std::copy(right->keys_ + 1, right->keys_ + right->count_, right->keys_);
+      std::copy(right->children_ + 1, right->children_ + right->count_ + 1, right->children_);
+      right->count_ -= 1;
+    }
+  }
+
+  // nodes_ comes before root_, since the constructor's NewLeaf counts the
+  // root in it.
+  size_t size_{0};
+  size_t nodes_{0};
+  BPlusTreeNodeBase *root_;
+};
+
+// A minimal allocator that counts the bytes std::set allocates, so we can
+// compare memory per key. std::set allocates through a rebound copy of this
+// allocator, which is why the counter is shared through a pointer.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+  size_t *bytes_;
+
+  explicit CountingAllocator(size_t *bytes) : bytes_(bytes) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : bytes_(other.bytes_) {}
+
+  T *allocate(size_t n) {
+    *bytes_ += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    *bytes_ -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U> &other) const {
+    return bytes_ == other.bytes_;
+  }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U> &other) const {
+    return bytes_ != other.bytes_;
+  }
+};
+
+// Runs fn and returns how long it took in milliseconds.
+template <typename Fn>
+double TimeMs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RunBenchmark() {
+  constexpr int n = 1000000;
+  constexpr int lookups = 1000000;
+  constexpr int scans = 10000;
+  constexpr int scan_length = 1000;
+
+  // Keys are the even numbers below 2n, inserted in random order, so that
+  // half of the random lookups below hit and half of them miss.
+  std::mt19937 gen(15445);
+  std::vector<int> keys(n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = 2 * i;
+  }
+  std::shuffle(keys.begin(), keys.end(), gen);
+  std::vector<int> probes(lookups);
+  std::uniform_int_distribution<int> dist(0, 2 * n - 1);
+  for (int &probe : probes) {
+    probe = dist(gen);
+  }
+
+  size_t set_bytes = 0;
+  std::set<int, std::less<int>, CountingAllocator<int>> std_set{CountingAllocator<int>(&set_bytes)};
+  BPlusTreeSet<int> tree;
+  BPlusTreeSet<int> loaded;
+
+  double set_insert = TimeMs([&] {
+    for (int key : keys) {
+      std_set.insert(key);
+    }
+  });
+  double tree_insert = TimeMs([&] {
+    for (int key : keys) {
+      tree.insert(key);
+    }
+  });
+  std::vector<int> sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  double tree_load = TimeMs([&] { loaded.BulkLoad(sorted.begin(), sorted.end()); });
+
+  // We accumulate into `hits` and `sum` so the compiler can't throw away the
+  // work that we are timing.
+  size_t hits = 0;
+  double set_find = TimeMs([&] {
+    for (int probe : probes) {
+      hits += std_set.count(probe);
+    }
+  });
+  double tree_find = TimeMs([&] {
+    for (int probe : probes) {
+      hits += tree.count(probe);
+    }
+  });
+
+  long long sum = 0;
+  double set_scan = TimeMs([&] {
+    for (int i = 0; i < scans; ++i) {
+      int low = probes[i];
+      for (auto it = std_set.lower_bound(low); it != std_set.end() && *it < low + 2 * scan_length; ++it) {
+        sum += *it;
+      }
+    }
+  });
+  double tree_scan = TimeMs([&] {
+    for (int i = 0; i < scans; ++i) {
+      int low = probes[i];
+      tree.RangeScan(low, low + 2 * scan_length, [&](int key) { sum += key; });
+    }
+  });
+
+  std::cout << "Benchmark with " << n << " keys (checksum " << hits + sum << "):\n";
+  std::cout << "  insert:       std::set " << set_insert << " ms, BPlusTreeSet " << tree_insert
+            << " ms, BPlusTreeSet::BulkLoad " << tree_load << " ms\n";
+  std::cout << "  point lookup: std::set " << set_find << " ms, BPlusTreeSet " << tree_find << " ms\n";
+  std::cout << "  range scan:   std::set " << set_scan << " ms, BPlusTreeSet " << tree_scan << " ms\n";
+  std::cout << "  bytes/key:    std::set " << static_cast<double>(set_bytes) / n << ", BPlusTreeSet "
+            << static_cast<double>(tree.MemoryUsage()) / n << ", bulk loaded BPlusTreeSet "
+            << static_cast<double>(loaded.MemoryUsage()) / n << "\n";
+}
+
+int main() {
+  // The BPlusTreeSet can be used just like the std::set in sets.cpp.
+  BPlusTreeSet<int> int_set;
+  for (int i = 1; i <= 5; ++i) {
+    int_set.insert(i);
+  }
+  for (int i = 6; i <= 10; ++i) {
+    int_set.emplace(i);
+  }
+
+  if (int_set.find(2) != int_set.end()) {
+    std::cout << "Element 2 is in int_set.\n";
+  }
+  if (int_set.count(11) == 0) {
+    std::cout << "Element 11 is not in the set.\n";
+  }
+
+  int_set.erase(4);
+  if (int_set.count(4) == 0) {
+    std::cout << "Element 4 is not in the set.\n";
+  }
+
+  int_set.erase(int_set.begin());
+  int_set.erase(int_set.find(9), int_set.end());
+
+  std::cout << "Printing the elements of the set with a for-each loop:\n";
+  for (const int &elem : int_set) {
+    std::cout << elem << " ";
+  }
+  std::cout << "\n";
+
+  // Moving takes the nodes, and the moved-from set can still be used.
+  BPlusTreeSet<int> moved_set(std::move(int_set));
+  int_set.insert(42);
+  std::cout << "moved_set has " << moved_set.size() << " elements, int_set has " << int_set.size() << ".\n";
+
+  // With more keys the tree grows several levels deep. A range scan finds
+  // the first key with lower_bound and then walks the linked leaves.
+  BPlusTreeSet<int> big_set;
+  std::vector<int> sorted_keys;
+  for (int i = 0; i < 100000; i += 3) {
+    sorted_keys.push_back(i);
+  }
+  big_set.BulkLoad(sorted_keys.begin(), sorted_keys.end());
+  std::cout << "Keys in [50000, 50020): ";
+  big_set.RangeScan(50000, 50020, [](int key) { std::cout << key << " "; });
+  std::cout << "\n";
+
+  RunBenchmark();
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief Tutorial code for a buffer pool manager with RAII page guards,
+ * built from the shared_mutex in rwlock.cpp and the move-only wrapper class
+ * in wrapper_class.cpp.
+ */
+
+// The buffer pool itself is in cache/buffer_pool.h. This file shows how the
+// page guards are used, and then benchmarks the pool: several threads fetch
+// pages with a skewed (Zipfian) access pattern from a file that's 8 times
+// bigger than the pool, with each of the replacement policies from
+// cache/replacer.h.
+
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::filesystem::temp_directory_path, std::filesystem::remove.
+#include <filesystem>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::runtime_error.
+#include <stdexcept>
+// Includes std::string.
+#include <string>
+// Includes std::thread.
+#include <thread>
+// Includes the vector container.
+#include <vector>
+
+// Includes BufferPoolManager, DiskManager and the page guards.
+#include "cache/buffer_pool.h"
+// Includes the replacement policies.
+#include "cache/replacer.h"
+// Includes ZipfianGenerator.
+#include "cache/zipfian.h"
+
+// The layout of every page in this example: the page's own id (to check
+// that the pool returns the right page), and a counter that writers
+// increment.
+struct CounterPage {
+  cache::PageId page_id_;
+  uint64_t counter_;
+};
+
+/* ======================================================================
+   === Demo =============================================================
+   ====================================================================== */
+
+void Demo(const std::string &path) {
+  cache::DiskManager disk(path);
+  cache::BufferPoolManager<cache::LRUPolicy<cache::PageId>> pool(2, &disk);
+
+  cache::PageId first = pool.NewPage();
+  cache::PageId second = pool.NewPage();
+  cache::PageId third = pool.NewPage();
+  {
+    // A write guard gives exclusive access to the page. The page stays
+    // pinned, and the latch stays held, until the end of this scope.
+    auto guard = pool.WritePage(first);
+    guard.AsMut<CounterPage>()->counter_ = 445;
+  }
+
+  // Any number of read guards can share a page.
+  auto reader_1 = pool.ReadPage(first);
+  auto reader_2 = pool.ReadPage(first);
+  std::cout << "Two readers see " << reader_1.As<CounterPage>()->counter_ << " and "
+            << reader_2.As<CounterPage>()->counter_ << "\n";
+
+  // Guards are move-only, like IntPtrManager. The pin moves with them.
+  cache::BufferPoolManager<cache::LRUPolicy<cache::PageId>>::ReadGuard moved = std::move(reader_1);
+  std::cout << "After the move, reader_1 is " << (reader_1.Valid() ? "valid" : "empty") << "\n";
+
+  // The pool has 2 frames. first is pinned, so loading second and then
+  // third evicts second, even though first is the least recently used.
+  pool.ReadPage(second);
+  pool.ReadPage(third);
+  try {
+    auto pinned_1 = pool.ReadPage(second);
+    auto pinned_2 = pool.ReadPage(third);
+  } catch (const std::runtime_error &e) {
+    std::cout << "Pinning a third page in a pool of 2 frames: " << e.what() << "\n";
+  }
+  moved.Drop();
+  reader_2.Drop();
+  cache::CacheStats stats = pool.Stats();
+  std::cout << "Demo pool: " << stats.hits_ << " hits, " << stats.misses_ << " misses, " << stats.evictions_
+            << " evictions\n\n";
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+constexpr size_t FILE_PAGES = 8192;
+constexpr size_t POOL_FRAMES = 1024;
+constexpr size_t OPS = 400000;
+
+template <typename Policy>
+void Measure(const char *name, const std::string &path, size_t threads) {
+  cache::DiskManager disk(path);
+  cache::BufferPoolManager<Policy> pool(POOL_FRAMES, &disk);
+
+  std::vector<std::thread> workers;
+  std::atomic<size_t> wrong_pages{0};
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      cache::ZipfianGenerator zipfian(FILE_PAGES, 0.99, 445 + t);
+      for (size_t i = 0; i < OPS / threads; ++i) {
+        cache::PageId page_id = static_cast<cache::PageId>(zipfian());
+        // 1 in 10 accesses is a write.
+        if (i % 10 == 0) {
+          auto guard = pool.WritePage(page_id);
+          guard.template AsMut<CounterPage>()->counter_ += 1;
+        } else {
+          auto guard = pool.ReadPage(page_id);
+          wrong_pages += guard.template As<CounterPage>()->page_id_ != page_id ? 1 : 0;
+        }
+      }
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  cache::CacheStats stats = pool.Stats();
+  std::cout << "    " << std::left << std::setw(6) << name << std::right << threads << " threads: " << std::fixed
+            << std::setprecision(1) << std::setw(5) << stats.HitRate() * 100 << "% hits, " << std::setw(5)
+            << OPS / threads * threads / seconds / 1e6 << "M fetches/sec, " << disk.Reads() << " page reads, "
+            << disk.Writes() << " page writes" << (wrong_pages > 0 ? ", WRONG PAGES" : "") << "\n";
+}
+
+void RunBenchmark(const std::string &path) {
+  // Writes every page's id into it once, so that readers can check it.
+  {
+    cache::DiskManager disk(path);
+    cache::BufferPoolManager<cache::LRUPolicy<cache::PageId>> pool(POOL_FRAMES, &disk);
+    for (size_t i = 0; i < FILE_PAGES; ++i) {
+      cache::PageId page_id = pool.NewPage();
+      pool.WritePage(page_id).AsMut<CounterPage>()->page_id_ = page_id;
+    }
+  }
+
+  // The file is small enough to stay in the OS's page cache, so a "disk
+  // read" here is a copy from the kernel. With a real disk, misses cost far
+  // more, and the hit rate matters even more than the fetch rate.
+  std::cout << POOL_FRAMES << " frames over a file of " << FILE_PAGES << " pages, Zipfian (theta = 0.99), " << OPS
+            << " fetches, 10% writes:\n";
+  for (size_t threads : {1, 2, 4, 8}) {
+    Measure<cache::LRUPolicy<cache::PageId>>("LRU", path, threads);
+    Measure<cache::ClockPolicy<cache::PageId>>("CLOCK", path, threads);
+    Measure<cache::ARCPolicy<cache::PageId>>("ARC", path, threads);
+  }
+}
+
+int main() {
+  std::string path = (std::filesystem::temp_directory_path() / "bootcamp_buffer_pool.db").string();
+  std::filesystem::remove(path);
+
+  Demo(path);
+  RunBenchmark(path);
+
+  std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,478 @@
+/**
+ * @file buffer_pool.h
+ * @brief A buffer pool manager: a fixed number of 4KB frames that cache the
+ * pages of a file, with move-only ReadPageGuard and WritePageGuard handles.
+ */
+
+// A database's tables and indexes live in a file on disk, cut into
+// fixed-size pages. Reading a page from disk takes far longer than reading
+// it from memory, so the buffer pool keeps recently used pages in a fixed
+// number of in-memory "frames", like a cache (see lru_cache.h):
+// - The page table maps each cached page to its frame.
+// - A page that a thread is using is "pinned": its pin count says how many
+//   threads are using it, and it can't be evicted until that's back to 0.
+// - When a page that isn't cached is needed, and every frame is used, the
+//   replacement policy (see replacer.h) picks an unpinned page to evict. If
+//   it was changed ("dirty"), it's written back to the file first.
+
+// Each frame also has a latch, a std::shared_mutex like the one in
+// rwlock.cpp: any number of threads can read a page at once, but a thread
+// that writes it has it to itself. Pinning and latching are bundled into
+// guards, which are wrapper classes like IntPtrManager in wrapper_class.cpp:
+// - ReadPageGuard holds a pin and a std::shared_lock on the frame's latch.
+// - WritePageGuard holds a pin and a std::unique_lock on the frame's latch.
+// Both are move-only, and their destructor releases the latch and then the
+// pin. So a page can't be evicted while a guard for it exists, and no code
+// path can forget to unpin it.
+
+// The lock order is always the pool's mutex first, then a frame's latch,
+// and the pool's mutex is never held while waiting for a latch:
+// - To fetch a page, a thread pins it while holding the pool's mutex, lets
+//   go of the mutex, and only then waits for the latch. A pinned page can't
+//   be evicted, so the frame still holds the same page when it gets the
+//   latch.
+// - To unpin, a guard releases the latch, then takes the pool's mutex.
+
+// To keep this simple, misses read the page (and write back the evicted
+// one) while holding the pool's mutex, so misses don't overlap. A real
+// buffer pool hands the I/O to a disk scheduler and lets go of the mutex
+// while it waits.
+
+#pragma once
+
+// Includes the POSIX open and O_* flags.
+#include <fcntl.h>
+// Includes the POSIX preadv, pwritev and struct iovec.
+#include <sys/uio.h>
+// Includes the POSIX pread, pwrite, fsync and close.
+#include <unistd.h>
+
+// Includes std::atomic.
+#include <atomic>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::memset.
+#include <cstring>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::mutex, std::scoped_lock, std::unique_lock.
+#include <mutex>
+// Includes std::optional.
+#include <optional>
+// Includes std::shared_mutex, std::shared_lock.
+#include <shared_mutex>
+// Includes std::runtime_error.
+#include <stdexcept>
+// Includes std::string.
+#include <string>
+// Includes std::system_error.
+#include <system_error>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes CacheStats.
+#include "lru_cache.h"
+
+namespace cache {
+
+constexpr size_t PAGE_SIZE = 4096;
+using PageId = int64_t;
+using FrameId = size_t;
+
+/* ======================================================================
+   === DiskManager ======================================================
+   ====================================================================== */
+
+// Reads and writes whole pages of one file. Page i is at offset
+// i * PAGE_SIZE. pread and pwrite take the offset as an argument, so many
+// threads can use the same file descriptor at once.
+class DiskManager {
+ public:
+  explicit DiskManager(const std::string &path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+  }
+
+  ~DiskManager() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  DiskManager(const DiskManager &) = delete;
+  DiskManager &operator=(const DiskManager &) = delete;
+
+  // Pages past the end of the file read as zeros. Each of the four
+  // functions below returns how many system calls it made, which is more
+  // than one when a transfer comes up short.
+  size_t ReadPage(PageId page_id, char *data) {
+    size_t calls = 0;
+    size_t done = 0;
+    while (done < PAGE_SIZE) {
+      calls += 1;
+      ssize_t n = ::pread(fd_, data + done, PAGE_SIZE - done, Offset(page_id) + static_cast<off_t>(done));
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pread");
+      }
+      if (n == 0) {
+        std::memset(data + done, 0, PAGE_SIZE - done);
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    reads_.fetch_add(1, std::memory_order_relaxed);
+    return calls;
+  }
+
+  size_t WritePage(PageId page_id, const char *data) {
+    size_t calls = 0;
+    size_t done = 0;
+    while (done < PAGE_SIZE) {
+      calls += 1;
+      ssize_t n = ::pwrite(fd_, data + done, PAGE_SIZE - done, Offset(page_id) + static_cast<off_t>(done));
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+      }
+      done += static_cast<size_t>(n);
+    }
+    writes_.fetch_add(1, std::memory_order_relaxed);
+    return calls;
+  }
+
+  // Reads count consecutive pages, starting at first, with one preadv call.
+  // The buffers don't have to be next to each other in memory. count can't
+  // be more than IOV_MAX (1024 on Linux).
+  size_t ReadPages(PageId first, char *const *pages, size_t count) {
+    std::vector<iovec> iov(count);
+    for (size_t i = 0; i < count; ++i) {
+      iov[i] = {pages[i], PAGE_SIZE};
+    }
+    ssize_t n = ::preadv(fd_, iov.data(), static_cast<int>(count), Offset(first));
+    if (n < 0) {
+      throw std::system_error(errno, std::generic_category(), "preadv");
+    }
+    // A short read (at the end of the file, for example) is finished one
+    // page at a time.
+    size_t done = static_cast<size_t>(n) / PAGE_SIZE;
+    reads_.fetch_add(done, std::memory_order_relaxed);
+    size_t calls = 1;
+    for (size_t i = done; i < count; ++i) {
+      calls += ReadPage(first + static_cast<PageId>(i), pages[i]);
+    }
+    return calls;
+  }
+
+  size_t WritePages(PageId first, const char *const *pages, size_t count) {
+    std::vector<iovec> iov(count);
+    for (size_t i = 0; i < count; ++i) {
+      iov[i] = {const_cast<char *>(pages[i]), PAGE_SIZE};
+    }
+    ssize_t n = ::pwritev(fd_, iov.data(), static_cast<int>(count), Offset(first));
+    if (n < 0) {
+      throw std::system_error(errno, std::generic_category(), "pwritev");
+    }
+    size_t done = static_cast<size_t>(n) / PAGE_SIZE;
+    writes_.fetch_add(done, std::memory_order_relaxed);
+    size_t calls = 1;
+    for (size_t i = done; i < count; ++i) {
+      calls += WritePage(first + static_cast<PageId>(i), pages[i]);
+    }
+    return calls;
+  }
+
+  void Sync() {
+    if (::fsync(fd_) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fsync");
+    }
+  }
+
+  int Fd() const { return fd_; }
+  uint64_t Reads() const { return reads_.load(std::memory_order_relaxed); }
+  uint64_t Writes() const { return writes_.load(std::memory_order_relaxed); }
+
+ private:
+  static off_t Offset(PageId page_id) { return static_cast<off_t>(page_id) * static_cast<off_t>(PAGE_SIZE); }
+
+  int fd_{-1};
+  std::atomic<uint64_t> reads_{0};
+  std::atomic<uint64_t> writes_{0};
+};
+
+/* ======================================================================
+   === Frames and guards ================================================
+   ====================================================================== */
+
+struct Frame {
+  alignas(64) char data_[PAGE_SIZE];
+  std::shared_mutex latch_;
+  // The fields below are protected by the pool's mutex.
+  PageId page_id_{-1};
+  size_t pin_count_{0};
+  bool dirty_{false};
+};
+
+// Pool is the BufferPoolManager that the page came from. Use the guards
+// through BufferPoolManager<Policy>::ReadGuard and ::WriteGuard.
+template <typename Pool>
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+  ReadPageGuard(Pool *pool, Frame *frame) : pool_(pool), frame_(frame), lock_(frame->latch_) {}
+
+  ~ReadPageGuard() { Drop(); }
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+
+  ReadPageGuard(ReadPageGuard &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)),
+        frame_(std::exchange(other.frame_, nullptr)),
+        lock_(std::move(other.lock_)) {}
+
+  ReadPageGuard &operator=(ReadPageGuard &&other) noexcept {
+    if (this != &other) {
+      Drop();
+      pool_ = std::exchange(other.pool_, nullptr);
+      frame_ = std::exchange(other.frame_, nullptr);
+      lock_ = std::move(other.lock_);
+    }
+    return *this;
+  }
+
+  bool Valid() const { return frame_ != nullptr; }
+  // page_id_ can only change while the page isn't pinned.
+  PageId GetPageId() const { return frame_->page_id_; }
+  const char *Data() const { return frame_->data_; }
+
+  template <typename T>
+  const T *As() const {
+    static_assert(sizeof(T) <= PAGE_SIZE, "T has to fit in a page");
+    return reinterpret_cast<const T *>(frame_->data_);
+  }
+
+  // Releases the latch and the pin before the guard goes out of scope.
+  void Drop() {
+    if (frame_ == nullptr) {
+      return;
+    }
+    lock_.unlock();
+    pool_->Unpin(frame_, false);
+    pool_ = nullptr;
+    frame_ = nullptr;
+  }
+
+ private:
+  Pool *pool_{nullptr};
+  Frame *frame_{nullptr};
+  std::shared_lock<std::shared_mutex> lock_;
+};
+
+template <typename Pool>
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+  WritePageGuard(Pool *pool, Frame *frame) : pool_(pool), frame_(frame), lock_(frame->latch_) {}
+
+  ~WritePageGuard() { Drop(); }
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+
+  WritePageGuard(WritePageGuard &&other) noexcept
+      : pool_(std::exchange(other.pool_, nullptr)),
+        frame_(std::exchange(other.frame_, nullptr)),
+        lock_(std::move(other.lock_)) {}
+
+  WritePageGuard &operator=(WritePageGuard &&other) noexcept {
+    if (this != &other) {
+      Drop();
+      pool_ = std::exchange(other.pool_, nullptr);
+      frame_ = std::exchange(other.frame_, nullptr);
+      lock_ = std::move(other.lock_);
+    }
+    return *this;
+  }
+
+  bool Valid() const { return frame_ != nullptr; }
+  PageId GetPageId() const { return frame_->page_id_; }
+  const char *Data() const { return frame_->data_; }
+  char *MutableData() { return frame_->data_; }
+
+  template <typename T>
+  T *AsMut() {
+    static_assert(sizeof(T) <= PAGE_SIZE, "T has to fit in a page");
+    return reinterpret_cast<T *>(frame_->data_);
+  }
+
+  // Marks the page dirty: any page that had a write guard is assumed to
+  // have been changed.
+  void Drop() {
+    if (frame_ == nullptr) {
+      return;
+    }
+    lock_.unlock();
+    pool_->Unpin(frame_, true);
+    pool_ = nullptr;
+    frame_ = nullptr;
+  }
+
+ private:
+  Pool *pool_{nullptr};
+  Frame *frame_{nullptr};
+  std::unique_lock<std::shared_mutex> lock_;
+};
+
+/* ======================================================================
+   === BufferPoolManager ================================================
+   ====================================================================== */
+
+// Policy is one of the replacement policies from replacer.h, over page ids.
+template <typename Policy>
+class BufferPoolManager {
+ public:
+  using ReadGuard = ReadPageGuard<BufferPoolManager>;
+  using WriteGuard = WritePageGuard<BufferPoolManager>;
+
+  BufferPoolManager(size_t frames, DiskManager *disk)
+      : frames_(std::make_unique<Frame[]>(frames)), frame_count_(frames), disk_(disk), policy_(frames) {
+    page_table_.reserve(frames);
+    for (size_t i = frames; i > 0; --i) {
+      free_frames_.push_back(i - 1);
+    }
+  }
+
+  BufferPoolManager(const BufferPoolManager &) = delete;
+  BufferPoolManager &operator=(const BufferPoolManager &) = delete;
+
+  // Every guard has to be dropped before the pool is destroyed. Dirty pages
+  // are written back on a best-effort basis: a destructor can't throw, so
+  // callers that need to know whether it worked call FlushAllPages() first.
+  ~BufferPoolManager() {
+    try {
+      FlushAllPages();
+    } catch (const std::exception &) {
+    }
+  }
+
+  // Allocates a new page in the file. Its contents are all zeros.
+  PageId NewPage() { return next_page_id_.fetch_add(1); }
+
+  // Throws std::runtime_error if every frame is pinned.
+  ReadGuard ReadPage(PageId page_id) { return ReadGuard(this, Pin(page_id)); }
+  WriteGuard WritePage(PageId page_id) { return WriteGuard(this, Pin(page_id)); }
+
+  // Writes every dirty page back to the file, and fsyncs it. Callers must
+  // make sure that no other thread is using the pool at the same time.
+  void FlushAllPages() {
+    std::scoped_lock lock(mutex_);
+    for (size_t i = 0; i < frame_count_; ++i) {
+      Frame &frame = frames_[i];
+      if (frame.page_id_ >= 0 && frame.dirty_) {
+        disk_->WritePage(frame.page_id_, frame.data_);
+        frame.dirty_ = false;
+      }
+    }
+    disk_->Sync();
+  }
+
+  CacheStats Stats() {
+    std::scoped_lock lock(mutex_);
+    return stats_;
+  }
+
+  size_t Frames() const { return frame_count_; }
+
+ private:
+  friend ReadGuard;
+  friend WriteGuard;
+
+  // Finds or loads page_id, and pins it.
+  Frame *Pin(PageId page_id) {
+    std::scoped_lock lock(mutex_);
+    auto it = page_table_.find(page_id);
+    if (it != page_table_.end()) {
+      Frame &frame = frames_[it->second];
+      stats_.hits_ += 1;
+      policy_.RecordAccess(page_id);
+      if (frame.pin_count_++ == 0) {
+        policy_.SetEvictable(page_id, false);
+      }
+      return &frame;
+    }
+
+    stats_.misses_ += 1;
+    policy_.RecordMiss(page_id);
+    FrameId frame_id;
+    if (!free_frames_.empty()) {
+      frame_id = free_frames_.back();
+      free_frames_.pop_back();
+    } else {
+      std::optional<PageId> victim = policy_.Evict();
+      if (!victim.has_value()) {
+        throw std::runtime_error("every frame in the buffer pool is pinned");
+      }
+      frame_id = page_table_.at(*victim);
+      Frame &old = frames_[frame_id];
+      // Nobody holds the victim's latch: it isn't pinned.
+      if (old.dirty_) {
+        try {
+          disk_->WritePage(old.page_id_, old.data_);
+        } catch (...) {
+          // The victim's data only lives in the frame, so it stays cached.
+          policy_.RecordInsert(*victim);
+          throw;
+        }
+        old.dirty_ = false;
+      }
+      page_table_.erase(*victim);
+      old.page_id_ = -1;
+      stats_.evictions_ += 1;
+    }
+
+    Frame &frame = frames_[frame_id];
+    try {
+      disk_->ReadPage(page_id, frame.data_);
+    } catch (...) {
+      free_frames_.push_back(frame_id);
+      throw;
+    }
+    frame.page_id_ = page_id;
+    frame.pin_count_ = 1;
+    page_table_.emplace(page_id, frame_id);
+    policy_.RecordInsert(page_id);
+    policy_.SetEvictable(page_id, false);
+    stats_.insertions_ += 1;
+    return &frame;
+  }
+
+  void Unpin(Frame *frame, bool dirty) {
+    std::scoped_lock lock(mutex_);
+    frame->dirty_ = frame->dirty_ || dirty;
+    if (--frame->pin_count_ == 0) {
+      policy_.SetEvictable(frame->page_id_, true);
+    }
+  }
+
+  std::unique_ptr<Frame[]> frames_;
+  size_t frame_count_;
+  DiskManager *disk_;
+  std::atomic<PageId> next_page_id_{0};
+
+  // Protects everything below, and the page_id_, pin_count_ and dirty_ of
+  // every frame.
+  std::mutex mutex_;
+  std::unordered_map<PageId, FrameId> page_table_;
+  std::vector<FrameId> free_frames_;
+  Policy policy_;
+  CacheStats stats_;
+};
+
+}  // namespace cache
@@ -0,0 +1,214 @@
+/**
+ * @file disk_scheduler.h
+ * @brief DiskScheduler: a queue of page reads and writes, drained by
+ * background worker threads that merge requests for adjacent pages.
+ */
+
+// DiskManager in buffer_pool.h does one blocking pread or pwrite per page,
+// on the caller's thread. A DiskScheduler lets the caller hand the request
+// off and continue: Schedule puts the request in a queue and returns a
+// std::future, which becomes ready once the page has been read or written.
+// Background workers take requests out of the queue. This is the
+// producer/consumer pattern from condition_variable.cpp: callers push a
+// request and notify a worker, and workers wait on the condition variable
+// while the queue is empty.
+
+// Workers take up to max_batch requests at a time. They sort the batch by
+// page id, and turn every run of reads (or writes) of consecutive pages
+// into a single preadv (or pwritev) call. So when the queue fills up, for
+// example during a scan, 16 page reads can cost one system call instead of
+// 16. Under a light load, batches are small and nothing is merged, so a
+// request never waits for others to arrive.
+
+// With more than one worker, the workers form a thread pool, and several
+// system calls are in flight at once, which a fast SSD needs to reach its
+// full speed. io_uring would do the same with one thread, by submitting
+// many requests to the kernel at once, but it needs liburing or raw system
+// calls, so this uses a thread pool everywhere instead.
+
+// Requests for the same page aren't ordered: a write and a read of the same
+// page that are both in the queue can happen in either order. Callers that
+// care (like a buffer pool writing back a page before reading it again)
+// wait for the first future before scheduling the second request.
+
+#pragma once
+
+// Includes std::sort.
+#include <algorithm>
+// Includes std::condition_variable.
+#include <condition_variable>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::deque.
+#include <deque>
+// Includes std::promise, std::future.
+#include <future>
+// Includes std::mutex, std::unique_lock.
+#include <mutex>
+// Includes std::thread.
+#include <thread>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes DiskManager, PageId and PAGE_SIZE.
+#include "buffer_pool.h"
+
+namespace cache {
+
+struct DiskRequest {
+  bool is_write_;
+  PageId page_id_;
+  // The page's buffer: read into, or written from. It must stay valid until
+  // the future is ready.
+  char *data_;
+  std::promise<void> done_;
+};
+
+class DiskScheduler {
+ public:
+  // preadv and pwritev take at most IOV_MAX (1024) buffers.
+  static constexpr size_t MAX_BATCH = 1024;
+
+  DiskScheduler(DiskManager *disk, size_t workers = 1, size_t max_batch = 16)
+      : disk_(disk), max_batch_(max_batch < 1 ? 1 : max_batch > MAX_BATCH ? MAX_BATCH : max_batch) {
+    // Without a worker, nothing would ever complete the futures.
+    for (size_t i = 0; i < (workers < 1 ? 1 : workers); ++i) {
+      workers_.emplace_back([this] { Work(); });
+    }
+  }
+
+  // Finishes every request in the queue, then stops the workers.
+  ~DiskScheduler() {
+    {
+      std::scoped_lock lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  DiskScheduler(const DiskScheduler &) = delete;
+  DiskScheduler &operator=(const DiskScheduler &) = delete;
+
+  std::future<void> ScheduleRead(PageId page_id, char *data) { return Schedule(false, page_id, data); }
+  std::future<void> ScheduleWrite(PageId page_id, const char *data) {
+    // Writes only read from data.
+    return Schedule(true, page_id, const_cast<char *>(data));
+  }
+
+  // How many system calls the workers made, and how many requests they
+  // served. The difference is what merging saved.
+  uint64_t SystemCalls() {
+    std::scoped_lock lock(mutex_);
+    return system_calls_;
+  }
+  uint64_t Requests() {
+    std::scoped_lock lock(mutex_);
+    return requests_;
+  }
+
+ private:
+  std::future<void> Schedule(bool is_write, PageId page_id, char *data) {
+    DiskRequest request{is_write, page_id, data, std::promise<void>()};
+    std::future<void> future = request.done_.get_future();
+    {
+      std::scoped_lock lock(mutex_);
+      queue_.push_back(std::move(request));
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+  void Work() {
+    std::vector<DiskRequest> batch;
+    batch.reserve(max_batch_);
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        while (!queue_.empty() && batch.size() < max_batch_) {
+          batch.push_back(std::move(queue_.front()));
+          queue_.pop_front();
+        }
+        // Other workers can start on the rest of the queue.
+        if (!queue_.empty()) {
+          cv_.notify_one();
+        }
+      }
+      size_t calls = Execute(batch);
+      {
+        std::scoped_lock lock(mutex_);
+        system_calls_ += calls;
+        requests_ += batch.size();
+      }
+      batch.clear();
+    }
+  }
+
+  // Runs a batch, and returns how many system calls it took.
+  size_t Execute(std::vector<DiskRequest> &batch) {
+    std::stable_sort(batch.begin(), batch.end(), [](const DiskRequest &a, const DiskRequest &b) {
+      return a.is_write_ != b.is_write_ ? a.is_write_ < b.is_write_ : a.page_id_ < b.page_id_;
+    });
+    size_t calls = 0;
+    std::vector<char *> buffers;
+    size_t begin = 0;
+    while (begin < batch.size()) {
+      // Extends the run while the next request is the same kind, for the
+      // next page.
+      size_t end = begin + 1;
+      while (end < batch.size() && batch[end].is_write_ == batch[begin].is_write_ &&
+             batch[end].page_id_ == batch[end - 1].page_id_ + 1) {
+        end += 1;
+      }
+      buffers.clear();
+      for (size_t i = begin; i < end; ++i) {
+        buffers.push_back(batch[i].data_);
+      }
+      // A short transfer is finished one page at a time, so a run can take
+      // more than one call. One that fails counts as one.
+      size_t run_calls = 1;
+      try {
+        if (batch[begin].is_write_) {
+          run_calls = disk_->WritePages(batch[begin].page_id_, buffers.data(), buffers.size());
+        } else {
+          run_calls = disk_->ReadPages(batch[begin].page_id_, buffers.data(), buffers.size());
+        }
+        for (size_t i = begin; i < end; ++i) {
+          batch[i].done_.set_value();
+        }
+      } catch (...) {
+        // The caller sees the exception when it calls get() on the future.
+        for (size_t i = begin; i < end; ++i) {
+          batch[i].done_.set_exception(std::current_exception());
+        }
+      }
+      calls += run_calls;
+      begin = end;
+    }
+    return calls;
+  }
+
+  DiskManager *disk_;
+  size_t max_batch_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<DiskRequest> queue_;
+  bool stopping_{false};
+  uint64_t system_calls_{0};
+  uint64_t requests_{0};
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace cache
@@ -0,0 +1,444 @@
+/**
+ * @file lru_cache.h
+ * @brief Bounded in-memory caches with O(1) get, put and evict: LRUCache,
+ * LRUKCache, and ShardedCache to use either of them from many threads.
+ */
+
+// A cache holds up to `capacity` key-value pairs. When it's full and a new
+// key comes in, it has to throw one out ("evict" it). LRU (least recently
+// used) evicts the key that hasn't been used for the longest time.
+
+// An LRU cache is two data structures in one:
+// - A doubly linked list of the entries, like the DLL from iterator.cpp,
+//   ordered from most recently used (the front) to least recently used (the
+//   back). A hit moves the entry to the front, and eviction takes the back.
+// - A hash index from key to list entry, like the unordered_map from
+//   unordered_maps.cpp, so that a lookup doesn't have to walk the list.
+// Both take O(1) time per operation.
+
+// The list is "intrusive": the prev and next pointers live inside the entry
+// itself, just like Node in iterator.cpp has next_ and prev_. So moving an
+// entry to the front only rewires four pointers. A std::list<std::pair<K, V>>
+// would work too, but then the hash index would point to list iterators,
+// and every insert would allocate a new list node. Here, all entries are
+// allocated once, when the cache is created, and the hash index reuses the
+// node of the evicted key for the new one (with extract(), from C++17), so
+// a full cache doesn't allocate at all.
+
+#pragma once
+
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::hash.
+#include <functional>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::mutex, std::scoped_lock.
+#include <mutex>
+// Includes std::optional.
+#include <optional>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+namespace cache {
+
+/* ======================================================================
+   === Stats ============================================================
+   ====================================================================== */
+
+struct CacheStats {
+  uint64_t hits_{0};
+  uint64_t misses_{0};
+  uint64_t insertions_{0};
+  uint64_t evictions_{0};
+
+  double HitRate() const {
+    uint64_t lookups = hits_ + misses_;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(lookups);
+  }
+
+  CacheStats &operator+=(const CacheStats &other) {
+    hits_ += other.hits_;
+    misses_ += other.misses_;
+    insertions_ += other.insertions_;
+    evictions_ += other.evictions_;
+    return *this;
+  }
+};
+
+/* ======================================================================
+   === The intrusive list ===============================================
+   ====================================================================== */
+
+// The links that an entry needs to be in an IntrusiveList. Entries inherit
+// from it.
+struct ListHook {
+  ListHook *prev_{nullptr};
+  ListHook *next_{nullptr};
+};
+
+// A circular doubly linked list with a sentinel: head_ is a hook that isn't
+// an entry, and the list goes head_ -> front -> ... -> back -> head_. With a
+// sentinel, every entry always has a prev_ and a next_, so linking and
+// unlinking have no "is this the first/last one?" branches, unlike the DLL
+// in iterator.cpp. T must inherit from ListHook.
+template <typename T>
+class IntrusiveList {
+ public:
+  IntrusiveList() { head_.prev_ = head_.next_ = &head_; }
+  IntrusiveList(const IntrusiveList &) = delete;
+  IntrusiveList &operator=(const IntrusiveList &) = delete;
+
+  bool Empty() const { return head_.next_ == &head_; }
+  size_t Size() const { return size_; }
+  T *Front() { return Empty() ? nullptr : static_cast<T *>(head_.next_); }
+  T *Back() { return Empty() ? nullptr : static_cast<T *>(head_.prev_); }
+
+  void PushFront(T *entry) { InsertAfter(&head_, entry); }
+  void PushBack(T *entry) { InsertAfter(head_.prev_, entry); }
+
+  void Remove(T *entry) {
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    entry->prev_ = entry->next_ = nullptr;
+    size_ -= 1;
+  }
+
+  void MoveToFront(T *entry) {
+    Remove(entry);
+    PushFront(entry);
+  }
+
+  T *PopBack() {
+    T *entry = Back();
+    if (entry != nullptr) {
+      Remove(entry);
+    }
+    return entry;
+  }
+
+  // The entry before this one, or nullptr if this one is the front. Walks
+  // from the back toward the front.
+  T *Before(T *entry) { return entry->prev_ == &head_ ? nullptr : static_cast<T *>(entry->prev_); }
+
+ private:
+  void InsertAfter(ListHook *pos, T *entry) {
+    entry->prev_ = pos;
+    entry->next_ = pos->next_;
+    pos->next_->prev_ = entry;
+    pos->next_ = entry;
+    size_ += 1;
+  }
+
+  ListHook head_;
+  size_t size_{0};
+};
+
+/* ======================================================================
+   === LRUCache =========================================================
+   ====================================================================== */
+
+// Get returns a copy of the value, so that it stays valid even if the entry
+// is evicted right after (which matters once the cache is shared by several
+// threads). For big values, make V a std::shared_ptr.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LRUCache {
+ public:
+  explicit LRUCache(size_t capacity) : entries_(capacity) {
+    index_.reserve(capacity);
+    for (Entry &entry : entries_) {
+      free_.PushBack(&entry);
+    }
+  }
+
+  LRUCache(const LRUCache &) = delete;
+  LRUCache &operator=(const LRUCache &) = delete;
+
+  size_t Capacity() const { return entries_.size(); }
+  size_t Size() const { return index_.size(); }
+  const CacheStats &Stats() const { return stats_; }
+
+  std::optional<V> Get(const K &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      stats_.misses_ += 1;
+      return std::nullopt;
+    }
+    stats_.hits_ += 1;
+    lru_.MoveToFront(it->second);
+    return it->second->value_;
+  }
+
+  // Inserts key or overwrites its value, and makes it the most recently
+  // used key. Evicts the least recently used key if the cache is full.
+  void Put(const K &key, V value) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->value_ = std::move(value);
+      lru_.MoveToFront(it->second);
+      return;
+    }
+    if (entries_.empty()) {
+      return;
+    }
+    stats_.insertions_ += 1;
+    Entry *entry = free_.PopBack();
+    if (entry == nullptr) {
+      entry = lru_.PopBack();
+      stats_.evictions_ += 1;
+      // Reuse the victim's hash node for the new key instead of freeing it
+      // and allocating a new one.
+      auto node = index_.extract(entry->key_);
+      node.key() = key;
+      node.mapped() = entry;
+      index_.insert(std::move(node));
+    } else {
+      index_.emplace(key, entry);
+    }
+    entry->key_ = key;
+    entry->value_ = std::move(value);
+    lru_.PushFront(entry);
+  }
+
+  bool Erase(const K &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    Entry *entry = it->second;
+    index_.erase(it);
+    lru_.Remove(entry);
+    entry->value_ = V();
+    free_.PushBack(entry);
+    return true;
+  }
+
+ private:
+  struct Entry : ListHook {
+    K key_{};
+    V value_{};
+  };
+
+  // All entries live here, and never move, since the vector never grows.
+  std::vector<Entry> entries_;
+  std::unordered_map<K, Entry *, Hash> index_;
+  IntrusiveList<Entry> lru_;
+  IntrusiveList<Entry> free_;
+  CacheStats stats_;
+};
+
+/* ======================================================================
+   === LRUKCache ========================================================
+   ====================================================================== */
+
+// Plain LRU has a weakness: a key that's used once, for example by a scan
+// over a whole table, goes straight to the front and pushes out keys that
+// are used all the time. LRU-K (O'Neil et al., SIGMOD 1993) only trusts
+// keys that have been used at least K times. It keeps two lists:
+// - history_ holds the keys that have been used fewer than K times, in the
+//   order they first came in. These are evicted first, oldest first.
+// - cache_ holds the keys that have been used K times or more, in LRU order.
+// A hit on a key in history_ only counts the access, until the K-th one
+// promotes the key to the front of cache_.
+
+// The LRU-K paper orders cache_ by the time of each key's K-th most recent
+// access. Keeping that order exactly needs a priority queue, and O(log n)
+// per access. Ordering cache_ by the most recent access instead keeps every
+// operation O(1), and is the same for K = 2 in most practical traces. The
+// paper also remembers keys for a while after they're evicted, which this
+// version doesn't (the ARC and 2Q policies do something similar).
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LRUKCache {
+ public:
+  LRUKCache(size_t capacity, uint32_t k) : k_(k), entries_(capacity) {
+    index_.reserve(capacity);
+    for (Entry &entry : entries_) {
+      free_.PushBack(&entry);
+    }
+  }
+
+  LRUKCache(const LRUKCache &) = delete;
+  LRUKCache &operator=(const LRUKCache &) = delete;
+
+  size_t Capacity() const { return entries_.size(); }
+  size_t Size() const { return index_.size(); }
+  const CacheStats &Stats() const { return stats_; }
+
+  std::optional<V> Get(const K &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      stats_.misses_ += 1;
+      return std::nullopt;
+    }
+    stats_.hits_ += 1;
+    RecordAccess(it->second);
+    return it->second->value_;
+  }
+
+  void Put(const K &key, V value) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->value_ = std::move(value);
+      RecordAccess(it->second);
+      return;
+    }
+    if (entries_.empty()) {
+      return;
+    }
+    stats_.insertions_ += 1;
+    Entry *entry = free_.PopBack();
+    if (entry == nullptr) {
+      entry = history_.Empty() ? cache_.PopBack() : history_.PopBack();
+      stats_.evictions_ += 1;
+      auto node = index_.extract(entry->key_);
+      node.key() = key;
+      node.mapped() = entry;
+      index_.insert(std::move(node));
+    } else {
+      index_.emplace(key, entry);
+    }
+    entry->key_ = key;
+    entry->value_ = std::move(value);
+    entry->accesses_ = 1;
+    if (k_ <= 1) {
+      cache_.PushFront(entry);
+    } else {
+      history_.PushFront(entry);
+    }
+  }
+
+  bool Erase(const K &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+    Entry *entry = it->second;
+    index_.erase(it);
+    ListOf(entry).Remove(entry);
+    entry->value_ = V();
+    free_.PushBack(entry);
+    return true;
+  }
+
+ private:
+  struct Entry : ListHook {
+    K key_{};
+    V value_{};
+    uint32_t accesses_{0};
+  };
+
+  IntrusiveList<Entry> &ListOf(Entry *entry) { return entry->accesses_ >= k_ ? cache_ : history_; }
+
+  void RecordAccess(Entry *entry) {
+    if (entry->accesses_ >= k_) {
+      cache_.MoveToFront(entry);
+      return;
+    }
+    entry->accesses_ += 1;
+    if (entry->accesses_ == k_) {
+      history_.Remove(entry);
+      cache_.PushFront(entry);
+    }
+  }
+
+  uint32_t k_;
+  std::vector<Entry> entries_;
+  std::unordered_map<K, Entry *, Hash> index_;
+  IntrusiveList<Entry> history_;
+  IntrusiveList<Entry> cache_;
+  IntrusiveList<Entry> free_;
+  CacheStats stats_;
+};
+
+/* ======================================================================
+   === ShardedCache =====================================================
+   ====================================================================== */
+
+// A cache isn't thread-safe: even Get changes the list. The simplest fix is
+// one mutex around the whole cache, but then every thread waits for that
+// one mutex. ShardedCache splits the keys over several independent caches
+// ("shards"), each with its own mutex, by the hash of the key. Threads only
+// wait for each other when they use keys in the same shard.
+
+// The price: each shard evicts on its own, so the cache as a whole is only
+// approximately LRU, and an unlucky shard can be full while others have
+// room.
+template <typename Cache, typename K, typename V, typename Hash = std::hash<K>>
+class ShardedCache {
+ public:
+  // make_shard(capacity) returns a std::unique_ptr<Cache> with the given
+  // capacity. The caches aren't movable, hence the pointer. There is always
+  // at least one shard.
+  template <typename MakeShard>
+  ShardedCache(size_t shards, size_t capacity, MakeShard make_shard) : shards_(shards < 1 ? 1 : shards) {
+    size_t count = shards_.size();
+    for (size_t i = 0; i < count; ++i) {
+      // The capacity is split as evenly as possible.
+      size_t shard_capacity = capacity / count + (i < capacity % count ? 1 : 0);
+      shards_[i] = std::make_unique<Shard>(make_shard(shard_capacity));
+    }
+  }
+
+  std::optional<V> Get(const K &key) {
+    Shard &shard = ShardFor(key);
+    std::scoped_lock lock(shard.mutex_);
+    return shard.cache_->Get(key);
+  }
+
+  void Put(const K &key, V value) {
+    Shard &shard = ShardFor(key);
+    std::scoped_lock lock(shard.mutex_);
+    shard.cache_->Put(key, std::move(value));
+  }
+
+  bool Erase(const K &key) {
+    Shard &shard = ShardFor(key);
+    std::scoped_lock lock(shard.mutex_);
+    return shard.cache_->Erase(key);
+  }
+
+  size_t Size() {
+    size_t size = 0;
+    for (auto &shard : shards_) {
+      std::scoped_lock lock(shard->mutex_);
+      size += shard->cache_->Size();
+    }
+    return size;
+  }
+
+  CacheStats Stats() {
+    CacheStats stats;
+    for (auto &shard : shards_) {
+      std::scoped_lock lock(shard->mutex_);
+      stats += shard->cache_->Stats();
+    }
+    return stats;
+  }
+
+ private:
+  // Each shard gets its own cache lines, so that two threads locking two
+  // different shards don't fight over the same line.
+  struct alignas(64) Shard {
+    explicit Shard(std::unique_ptr<Cache> cache) : cache_(std::move(cache)) {}
+    std::mutex mutex_;
+    std::unique_ptr<Cache> cache_;
+  };
+
+  Shard &ShardFor(const K &key) {
+    // The low bits of std::hash are often just the key itself (for ints),
+    // which the shard's own hash table also uses. Mixing the bits first
+    // keeps the two from lining up.
+    uint64_t h = static_cast<uint64_t>(Hash()(key)) * 0x9e3779b97f4a7c15ULL;
+    return *shards_[(h >> 32) % shards_.size()];
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace cache
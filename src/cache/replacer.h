@@ -0,0 +1,689 @@
+/**
+ * @file replacer.h
+ * @brief Replacement policies (LRU, LRU-K, CLOCK, 2Q and ARC) that decide
+ * which key a cache evicts, and PolicyCache, a cache that takes the policy as
+ * a template parameter.
+ */
+
+// LRUCache in lru_cache.h has its eviction order built in. That's the
+// fastest way to write one cache, but a buffer pool or a simulator wants to
+// swap the policy while keeping everything else the same. So here, the
+// cache and the policy are split:
+// - The cache stores the values, and knows how full it is.
+// - The policy only sees keys. The cache tells it what happens to them
+//   (this key was used, this key came in, this key can't be evicted right
+//   now), and asks it for a victim when it's full.
+
+// Every policy has the same member functions, and the cache takes the
+// policy as a template parameter, like ShardedCache takes its Cache. There's
+// no base class with virtual functions, so the compiler can inline the
+// policy into the cache:
+// - Policy(size_t capacity): the most keys the cache will hold at once.
+// - void RecordAccess(const K &key): a cached key was used (a hit).
+// - void RecordMiss(const K &key): key isn't cached, and is about to be
+//   added. Called before Evict, so that the policy can use what it knows
+//   about key to pick the victim (ARC does).
+// - std::optional<K> Evict(): picks an evictable key, stops tracking it, and
+//   returns it. Returns std::nullopt if every cached key is pinned.
+// - void RecordInsert(const K &key): key was added to the cache.
+// - void Remove(const K &key): key was erased from the cache.
+// - void SetEvictable(const K &key, bool evictable): pins or unpins a cached
+//   key. A buffer pool pins the pages that threads are using. New keys are
+//   evictable.
+// - size_t Size() const: the number of evictable keys.
+
+// Why not plain LRU everywhere? A sequential scan, like a query reading a
+// whole table, touches many keys exactly once. LRU puts each of them at the
+// front, and a scan longer than the cache pushes out every key that's used
+// all the time. The other policies here all resist that in some way:
+// - LRU-K only trusts keys that have been used K times.
+// - CLOCK approximates LRU with one bit per key, and costs less per hit.
+// - 2Q puts new keys in a small FIFO queue first, and only promotes them if
+//   they're used again after leaving it.
+// - ARC balances a recency list and a frequency list, and adapts the split
+//   between them to the workload.
+
+// Pinned keys: LRU, LRU-K, 2Q and ARC skip pinned keys by walking their
+// lists from the eviction end. That's O(1) when few keys are pinned, which
+// is the usual case for a buffer pool, but O(pinned keys) in the worst case.
+
+#pragma once
+
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::hash.
+#include <functional>
+// Includes std::optional.
+#include <optional>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes CacheStats and IntrusiveList.
+#include "lru_cache.h"
+
+namespace cache {
+
+/* ======================================================================
+   === Shared pieces ====================================================
+   ====================================================================== */
+
+// One tracked key. It lives in the node of an std::unordered_map, whose
+// address never changes, so the lists can link entries directly.
+template <typename K>
+struct PolicyEntry : ListHook {
+  K key_{};
+  // Which of the policy's lists the entry is in.
+  uint8_t list_{0};
+  bool evictable_{true};
+  uint32_t accesses_{0};
+};
+
+// Finds the evictable entry closest to the back of the list, or nullptr.
+template <typename Entry>
+Entry *BackEvictable(IntrusiveList<Entry> &list) {
+  Entry *entry = list.Back();
+  while (entry != nullptr && !entry->evictable_) {
+    entry = list.Before(entry);
+  }
+  return entry;
+}
+
+/* ======================================================================
+   === LRU ==============================================================
+   ====================================================================== */
+
+template <typename K, typename Hash = std::hash<K>>
+class LRUPolicy {
+ public:
+  static constexpr const char *NAME = "LRU";
+
+  explicit LRUPolicy(size_t capacity) { entries_.reserve(capacity); }
+
+  void RecordAccess(const K &key) { lru_.MoveToFront(&entries_.at(key)); }
+  void RecordMiss(const K & /*key*/) {}
+
+  void RecordInsert(const K &key) {
+    Entry &entry = entries_[key];
+    entry.key_ = key;
+    lru_.PushFront(&entry);
+    evictable_ += 1;
+  }
+
+  std::optional<K> Evict() {
+    Entry *victim = BackEvictable(lru_);
+    if (victim == nullptr) {
+      return std::nullopt;
+    }
+    K key = victim->key_;
+    Remove(key);
+    return key;
+  }
+
+  void Remove(const K &key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    evictable_ -= it->second.evictable_ ? 1 : 0;
+    lru_.Remove(&it->second);
+    entries_.erase(it);
+  }
+
+  void SetEvictable(const K &key, bool evictable) {
+    Entry &entry = entries_.at(key);
+    evictable_ += static_cast<size_t>(evictable) - static_cast<size_t>(entry.evictable_);
+    entry.evictable_ = evictable;
+  }
+
+  size_t Size() const { return evictable_; }
+
+ private:
+  using Entry = PolicyEntry<K>;
+
+  std::unordered_map<K, Entry, Hash> entries_;
+  IntrusiveList<Entry> lru_;
+  size_t evictable_{0};
+};
+
+/* ======================================================================
+   === LRU-K ============================================================
+   ====================================================================== */
+
+// The same two lists as LRUKCache in lru_cache.h, with the same O(1)
+// approximation: keys used fewer than K times are evicted first, in the
+// order they came in, and then keys used K times or more, in LRU order.
+template <typename K, typename Hash = std::hash<K>>
+class LRUKPolicy {
+ public:
+  static constexpr const char *NAME = "LRU-K";
+
+  explicit LRUKPolicy(size_t capacity, uint32_t k = 2) : k_(k) { entries_.reserve(capacity); }
+
+  void RecordAccess(const K &key) {
+    Entry &entry = entries_.at(key);
+    if (entry.list_ == CACHE) {
+      cache_.MoveToFront(&entry);
+      return;
+    }
+    entry.accesses_ += 1;
+    if (entry.accesses_ >= k_) {
+      history_.Remove(&entry);
+      entry.list_ = CACHE;
+      cache_.PushFront(&entry);
+    }
+  }
+
+  void RecordMiss(const K & /*key*/) {}
+
+  void RecordInsert(const K &key) {
+    Entry &entry = entries_[key];
+    entry.key_ = key;
+    entry.accesses_ = 1;
+    entry.list_ = k_ <= 1 ? CACHE : HISTORY;
+    ListOf(entry).PushFront(&entry);
+    evictable_ += 1;
+  }
+
+  std::optional<K> Evict() {
+    Entry *victim = BackEvictable(history_);
+    if (victim == nullptr) {
+      victim = BackEvictable(cache_);
+    }
+    if (victim == nullptr) {
+      return std::nullopt;
+    }
+    K key = victim->key_;
+    Remove(key);
+    return key;
+  }
+
+  void Remove(const K &key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    evictable_ -= it->second.evictable_ ? 1 : 0;
+    ListOf(it->second).Remove(&it->second);
+    entries_.erase(it);
+  }
+
+  void SetEvictable(const K &key, bool evictable) {
+    Entry &entry = entries_.at(key);
+    evictable_ += static_cast<size_t>(evictable) - static_cast<size_t>(entry.evictable_);
+    entry.evictable_ = evictable;
+  }
+
+  size_t Size() const { return evictable_; }
+
+ private:
+  using Entry = PolicyEntry<K>;
+  static constexpr uint8_t HISTORY = 0;
+  static constexpr uint8_t CACHE = 1;
+
+  IntrusiveList<Entry> &ListOf(Entry &entry) { return entry.list_ == CACHE ? cache_ : history_; }
+
+  uint32_t k_;
+  std::unordered_map<K, Entry, Hash> entries_;
+  IntrusiveList<Entry> history_;
+  IntrusiveList<Entry> cache_;
+  size_t evictable_{0};
+};
+
+/* ======================================================================
+   === CLOCK ============================================================
+   ====================================================================== */
+
+// The keys sit in a circle of slots, each with a "referenced" bit, and a
+// clock hand points at one slot. A hit only sets the bit: no list to
+// rewire, so hits are cheaper than with LRU, and a buffer pool could even
+// set the bit without taking the policy's lock. To evict, the hand sweeps
+// forward: a slot with the bit set gets a second chance (the bit is
+// cleared), and the first slot with the bit clear is the victim. Keys used
+// since the last sweep survive it, which approximates LRU.
+template <typename K, typename Hash = std::hash<K>>
+class ClockPolicy {
+ public:
+  static constexpr const char *NAME = "CLOCK";
+
+  explicit ClockPolicy(size_t capacity) : slots_(capacity) {
+    index_.reserve(capacity);
+    free_.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i) {
+      free_.push_back(i - 1);
+    }
+  }
+
+  void RecordAccess(const K &key) { slots_[index_.at(key)].referenced_ = true; }
+  void RecordMiss(const K & /*key*/) {}
+
+  // A new key starts with its bit clear, so a key that's only used once
+  // (like one from a scan) is evicted on the hand's next pass.
+  void RecordInsert(const K &key) {
+    size_t slot = free_.back();
+    free_.pop_back();
+    slots_[slot] = Slot{key, true, false, true};
+    index_.emplace(key, slot);
+    evictable_ += 1;
+  }
+
+  std::optional<K> Evict() {
+    if (evictable_ == 0) {
+      return std::nullopt;
+    }
+    // Terminates: after one full turn every bit is clear, so the second
+    // turn finds an evictable slot.
+    while (true) {
+      Slot &slot = slots_[hand_];
+      size_t current = hand_;
+      hand_ = hand_ + 1 == slots_.size() ? 0 : hand_ + 1;
+      if (!slot.used_ || !slot.evictable_) {
+        continue;
+      }
+      if (slot.referenced_) {
+        slot.referenced_ = false;
+        continue;
+      }
+      K key = slot.key_;
+      RemoveSlot(current);
+      return key;
+    }
+  }
+
+  void Remove(const K &key) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      RemoveSlot(it->second);
+    }
+  }
+
+  void SetEvictable(const K &key, bool evictable) {
+    Slot &slot = slots_[index_.at(key)];
+    evictable_ += static_cast<size_t>(evictable) - static_cast<size_t>(slot.evictable_);
+    slot.evictable_ = evictable;
+  }
+
+  size_t Size() const { return evictable_; }
+
+ private:
+  struct Slot {
+    K key_{};
+    bool used_{false};
+    bool referenced_{false};
+    bool evictable_{false};
+  };
+
+  void RemoveSlot(size_t slot) {
+    evictable_ -= slots_[slot].evictable_ ? 1 : 0;
+    index_.erase(slots_[slot].key_);
+    slots_[slot] = Slot();
+    free_.push_back(slot);
+  }
+
+  std::vector<Slot> slots_;
+  std::unordered_map<K, size_t, Hash> index_;
+  std::vector<size_t> free_;
+  size_t hand_{0};
+  size_t evictable_{0};
+};
+
+/* ======================================================================
+   === 2Q ===============================================================
+   ====================================================================== */
+
+// From "2Q: A Low Overhead High Performance Buffer Management Replacement
+// Algorithm" (Johnson and Shasha, VLDB 1994). There are three queues:
+// - a1_in_: a FIFO queue of keys seen once, about 25% of the cache. A hit
+//   here doesn't move the key, so a quick burst of accesses (like a scan
+//   reading every row of a page) only counts once.
+// - a1_out_: a FIFO queue of keys recently evicted from a1_in_. It only
+//   holds keys, no values, for as many keys as half the cache.
+// - am_: an LRU list of keys that came back while they were in a1_out_,
+//   which means they're used again after some time, not just in a burst.
+// A scan fills a1_in_, and its keys go through a1_out_ and disappear
+// without ever touching am_.
+template <typename K, typename Hash = std::hash<K>>
+class TwoQPolicy {
+ public:
+  static constexpr const char *NAME = "2Q";
+
+  explicit TwoQPolicy(size_t capacity)
+      : k_in_(capacity / 4 > 0 ? capacity / 4 : 1), k_out_(capacity / 2 > 0 ? capacity / 2 : 1) {
+    entries_.reserve(capacity + k_out_);
+  }
+
+  void RecordAccess(const K &key) {
+    Entry &entry = entries_.at(key);
+    if (entry.list_ == AM) {
+      am_.MoveToFront(&entry);
+    }
+  }
+
+  // The cache evicts before it inserts, so Evict needs to know which key is
+  // coming in: if it's in a1_out_, trimming a1_out_ must not forget it.
+  void RecordMiss(const K &key) { missed_ = key; }
+
+  void RecordInsert(const K &key) {
+    missed_.reset();
+    auto [it, inserted] = entries_.try_emplace(key);
+    Entry &entry = it->second;
+    entry.key_ = key;
+    entry.evictable_ = true;
+    if (!inserted && entry.list_ == A1_OUT) {
+      a1_out_.Remove(&entry);
+      entry.list_ = AM;
+      am_.PushFront(&entry);
+    } else {
+      entry.list_ = A1_IN;
+      a1_in_.PushFront(&entry);
+    }
+    evictable_ += 1;
+  }
+
+  std::optional<K> Evict() {
+    Entry *victim = nullptr;
+    if (a1_in_.Size() > k_in_ || am_.Empty()) {
+      victim = BackEvictable(a1_in_);
+    }
+    if (victim == nullptr) {
+      victim = BackEvictable(am_);
+    }
+    if (victim == nullptr) {
+      victim = BackEvictable(a1_in_);
+    }
+    if (victim == nullptr) {
+      return std::nullopt;
+    }
+    K key = victim->key_;
+    evictable_ -= 1;
+    if (victim->list_ == A1_IN) {
+      // Remember the key in a1_out_, and forget the oldest one there.
+      a1_in_.Remove(victim);
+      victim->list_ = A1_OUT;
+      a1_out_.PushFront(victim);
+      if (a1_out_.Size() > k_out_) {
+        Entry *oldest = a1_out_.Back();
+        if (missed_ == oldest->key_) {
+          oldest = a1_out_.Before(oldest);
+        }
+        a1_out_.Remove(oldest);
+        entries_.erase(oldest->key_);
+      }
+    } else {
+      am_.Remove(victim);
+      entries_.erase(key);
+    }
+    return key;
+  }
+
+  void Remove(const K &key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.list_ == A1_OUT) {
+      return;
+    }
+    evictable_ -= it->second.evictable_ ? 1 : 0;
+    ListOf(it->second).Remove(&it->second);
+    entries_.erase(it);
+  }
+
+  void SetEvictable(const K &key, bool evictable) {
+    Entry &entry = entries_.at(key);
+    evictable_ += static_cast<size_t>(evictable) - static_cast<size_t>(entry.evictable_);
+    entry.evictable_ = evictable;
+  }
+
+  size_t Size() const { return evictable_; }
+
+ private:
+  using Entry = PolicyEntry<K>;
+  static constexpr uint8_t A1_IN = 0;
+  static constexpr uint8_t A1_OUT = 1;
+  static constexpr uint8_t AM = 2;
+
+  IntrusiveList<Entry> &ListOf(Entry &entry) {
+    return entry.list_ == AM ? am_ : entry.list_ == A1_IN ? a1_in_ : a1_out_;
+  }
+
+  size_t k_in_;
+  size_t k_out_;
+  std::unordered_map<K, Entry, Hash> entries_;
+  IntrusiveList<Entry> a1_in_;
+  IntrusiveList<Entry> a1_out_;
+  IntrusiveList<Entry> am_;
+  // The key passed to the last RecordMiss, until it's inserted.
+  std::optional<K> missed_;
+  size_t evictable_{0};
+};
+
+/* ======================================================================
+   === ARC ==============================================================
+   ====================================================================== */
+
+// From "ARC: A Self-Tuning, Low Overhead Replacement Cache" (Megiddo and
+// Modha, FAST 2003). With a cache of c keys, there are four LRU lists:
+// - t1_: cached keys used once recently.
+// - t2_: cached keys used at least twice recently.
+// - b1_ and b2_: "ghosts", keys recently evicted from t1_ and t2_. They
+//   only hold keys, up to c of them in total.
+// p_ is the target size of t1_, and eviction takes from t1_ if it's bigger
+// than that, and from t2_ otherwise. A miss on a key in b1_ means t1_ was
+// too small to keep it, so p_ grows. A miss on a key in b2_ means the same
+// for t2_, so p_ shrinks. During a scan, the new keys only ever go into t1_,
+// and they never come back to hit b1_, so p_ doesn't move toward t1_ and
+// the frequently used keys in t2_ stay cached.
+template <typename K, typename Hash = std::hash<K>>
+class ARCPolicy {
+ public:
+  static constexpr const char *NAME = "ARC";
+
+  explicit ARCPolicy(size_t capacity) : c_(capacity) { entries_.reserve(2 * capacity); }
+
+  void RecordAccess(const K &key) {
+    Entry &entry = entries_.at(key);
+    ListOf(entry).Remove(&entry);
+    entry.list_ = T2;
+    t2_.PushFront(&entry);
+  }
+
+  // Adapts p_ if key is a ghost, and remembers where it was for Evict and
+  // RecordInsert.
+  void RecordMiss(const K &key) {
+    auto it = entries_.find(key);
+    missed_list_ = it == entries_.end() ? NONE : it->second.list_;
+    if (missed_list_ == B1) {
+      size_t delta = b1_.Size() >= b2_.Size() ? 1 : b2_.Size() / b1_.Size();
+      p_ = p_ + delta < c_ ? p_ + delta : c_;
+    } else if (missed_list_ == B2) {
+      size_t delta = b2_.Size() >= b1_.Size() ? 1 : b1_.Size() / b2_.Size();
+      p_ = p_ > delta ? p_ - delta : 0;
+    }
+  }
+
+  // The REPLACE step of the paper: moves the victim to the matching ghost
+  // list.
+  std::optional<K> Evict() {
+    bool from_t1 = t1_.Size() > 0 && (t1_.Size() > p_ || (missed_list_ == B2 && t1_.Size() == p_));
+    Entry *victim = BackEvictable(from_t1 ? t1_ : t2_);
+    if (victim == nullptr) {
+      victim = BackEvictable(from_t1 ? t2_ : t1_);
+    }
+    if (victim == nullptr) {
+      return std::nullopt;
+    }
+    K key = victim->key_;
+    evictable_ -= 1;
+    bool in_t1 = victim->list_ == T1;
+    ListOf(*victim).Remove(victim);
+    victim->list_ = in_t1 ? B1 : B2;
+    (in_t1 ? b1_ : b2_).PushFront(victim);
+    return key;
+  }
+
+  void RecordInsert(const K &key) {
+    auto [it, inserted] = entries_.try_emplace(key);
+    Entry &entry = it->second;
+    entry.key_ = key;
+    entry.evictable_ = true;
+    if (!inserted && (entry.list_ == B1 || entry.list_ == B2)) {
+      // A ghost came back: it's been used twice recently.
+      ListOf(entry).Remove(&entry);
+      entry.list_ = T2;
+      t2_.PushFront(&entry);
+    } else {
+      entry.list_ = T1;
+      t1_.PushFront(&entry);
+    }
+    missed_list_ = NONE;
+    evictable_ += 1;
+    TrimGhosts();
+  }
+
+  void Remove(const K &key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.list_ == B1 || it->second.list_ == B2) {
+      return;
+    }
+    evictable_ -= it->second.evictable_ ? 1 : 0;
+    ListOf(it->second).Remove(&it->second);
+    entries_.erase(it);
+  }
+
+  void SetEvictable(const K &key, bool evictable) {
+    Entry &entry = entries_.at(key);
+    evictable_ += static_cast<size_t>(evictable) - static_cast<size_t>(entry.evictable_);
+    entry.evictable_ = evictable;
+  }
+
+  size_t Size() const { return evictable_; }
+
+ private:
+  using Entry = PolicyEntry<K>;
+  static constexpr uint8_t T1 = 0;
+  static constexpr uint8_t T2 = 1;
+  static constexpr uint8_t B1 = 2;
+  static constexpr uint8_t B2 = 3;
+  static constexpr uint8_t NONE = 4;
+
+  IntrusiveList<Entry> &ListOf(Entry &entry) {
+    switch (entry.list_) {
+      case T1:
+        return t1_;
+      case T2:
+        return t2_;
+      case B1:
+        return b1_;
+      default:
+        return b2_;
+    }
+  }
+
+  // Keeps the paper's invariants: t1_ and b1_ hold at most c keys together,
+  // and all four lists at most 2c.
+  void TrimGhosts() {
+    while (t1_.Size() + b1_.Size() > c_ && !b1_.Empty()) {
+      entries_.erase(b1_.PopBack()->key_);
+    }
+    while (t1_.Size() + t2_.Size() + b1_.Size() + b2_.Size() > 2 * c_) {
+      IntrusiveList<Entry> &ghosts = b2_.Empty() ? b1_ : b2_;
+      if (ghosts.Empty()) {
+        break;
+      }
+      entries_.erase(ghosts.PopBack()->key_);
+    }
+  }
+
+  size_t c_;
+  size_t p_{0};
+  uint8_t missed_list_{NONE};
+  std::unordered_map<K, Entry, Hash> entries_;
+  IntrusiveList<Entry> t1_;
+  IntrusiveList<Entry> t2_;
+  IntrusiveList<Entry> b1_;
+  IntrusiveList<Entry> b2_;
+  size_t evictable_{0};
+};
+
+/* ======================================================================
+   === PolicyCache ======================================================
+   ====================================================================== */
+
+// A cache with the same interface as LRUCache (Get, Put, Erase, Stats),
+// which asks its Policy what to evict. Pin keeps a key cached until Unpin.
+template <typename K, typename V, typename Policy, typename Hash = std::hash<K>>
+class PolicyCache {
+ public:
+  template <typename... PolicyArgs>
+  explicit PolicyCache(size_t capacity, PolicyArgs &&...policy_args)
+      : capacity_(capacity), policy_(capacity, std::forward<PolicyArgs>(policy_args)...) {
+    values_.reserve(capacity);
+  }
+
+  PolicyCache(const PolicyCache &) = delete;
+  PolicyCache &operator=(const PolicyCache &) = delete;
+
+  size_t Capacity() const { return capacity_; }
+  size_t Size() const { return values_.size(); }
+  const CacheStats &Stats() const { return stats_; }
+
+  std::optional<V> Get(const K &key) {
+    auto it = values_.find(key);
+    if (it == values_.end()) {
+      stats_.misses_ += 1;
+      return std::nullopt;
+    }
+    stats_.hits_ += 1;
+    policy_.RecordAccess(key);
+    return it->second;
+  }
+
+  // Returns false if the cache is full of pinned keys, so key couldn't be
+  // added.
+  bool Put(const K &key, V value) {
+    auto it = values_.find(key);
+    if (it != values_.end()) {
+      it->second = std::move(value);
+      policy_.RecordAccess(key);
+      return true;
+    }
+    if (capacity_ == 0) {
+      return false;
+    }
+    policy_.RecordMiss(key);
+    if (values_.size() == capacity_) {
+      std::optional<K> victim = policy_.Evict();
+      if (!victim.has_value()) {
+        return false;
+      }
+      values_.erase(*victim);
+      stats_.evictions_ += 1;
+    }
+    values_.emplace(key, std::move(value));
+    policy_.RecordInsert(key);
+    stats_.insertions_ += 1;
+    return true;
+  }
+
+  bool Erase(const K &key) {
+    if (values_.erase(key) == 0) {
+      return false;
+    }
+    policy_.Remove(key);
+    return true;
+  }
+
+  void Pin(const K &key) { policy_.SetEvictable(key, false); }
+  void Unpin(const K &key) { policy_.SetEvictable(key, true); }
+
+ private:
+  size_t capacity_;
+  Policy policy_;
+  std::unordered_map<K, V, Hash> values_;
+  CacheStats stats_;
+};
+
+}  // namespace cache
@@ -0,0 +1,90 @@
+/**
+ * @file zipfian.h
+ * @brief A Zipfian key generator, for replaying skewed access traces against
+ * the caches in this directory.
+ */
+
+// In most real workloads, a few keys are accessed far more often than the
+// rest: the front page of a website, the root of a B+ tree, this week's
+// orders. The Zipfian distribution models that. With n keys, the key of rank
+// i (counting from 1) is drawn with probability proportional to 1 / i^theta.
+// theta = 0 is uniform, and the larger theta gets, the more skewed the
+// accesses are. YCSB, a standard benchmark for key-value stores, uses 0.99:
+// with a million keys, the 1% most popular ones get about 70% of the accesses.
+
+// This is the generator from "Quickly Generating Billion-Record Synthetic
+// Databases" (Gray et al., SIGMOD 1994), which YCSB uses too. It needs O(n)
+// work once to compute zeta(n), and then O(1) per key.
+
+#pragma once
+
+// Includes std::pow.
+#include <cmath>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::mt19937_64, std::uniform_real_distribution.
+#include <random>
+
+namespace cache {
+
+class ZipfianGenerator {
+ public:
+  // Generates keys in [0, n). Key 0 is the most popular one. With
+  // scramble, the popular keys are spread over the whole range instead, so
+  // that they don't all end up next to each other (for example, in the same
+  // shard or the same page).
+  ZipfianGenerator(uint64_t n, double theta, uint64_t seed, bool scramble = true)
+      : n_(n), theta_(theta), scramble_(scramble), gen_(seed) {
+    zeta_n_ = Zeta(n, theta);
+    double zeta_2 = Zeta(2, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta_2 / zeta_n_);
+  }
+
+  uint64_t Next() {
+    double u = uniform_(gen_);
+    double uz = u * zeta_n_;
+    uint64_t rank;
+    if (uz < 1.0) {
+      rank = 0;
+    } else if (uz < 1.0 + std::pow(0.5, theta_)) {
+      rank = 1;
+    } else {
+      rank = static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+      rank = rank < n_ ? rank : n_ - 1;
+    }
+    return scramble_ ? Scramble(rank) % n_ : rank;
+  }
+
+  uint64_t operator()() { return Next(); }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  // FNV-1a over the 8 bytes of the rank.
+  static uint64_t Scramble(uint64_t rank) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < 8; ++i) {
+      h ^= (rank >> (8 * i)) & 0xff;
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  uint64_t n_;
+  double theta_;
+  bool scramble_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+  std::mt19937_64 gen_;
+  std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+};
+
+}  // namespace cache
@@ -0,0 +1,165 @@
+/**
+ * @file cache_simulator.cpp
+ * @brief Replays synthetic access traces against every replacement policy
+ * in cache/replacer.h, and reports their hit rates and speed.
+ */
+
+// A replacement policy is judged on two things: how many of the lookups it
+// turns into hits (each miss is a disk read for a buffer pool), and how much
+// it costs per lookup. This program builds a few traces that real systems
+// see, replays each of them through a PolicyCache with every policy, and
+// prints both numbers.
+
+// The traces, for a cache of CAPACITY keys:
+// - Zipfian: a skewed workload, like in lru_cache.cpp.
+// - Zipfian + scans: the same, but every so often a query scans a range of
+//   keys that nobody else uses, longer than the whole cache.
+// - Hot set + scans: a hot set that fits in half the cache, used
+//   uniformly, with the same scans in between.
+// - Loop: a loop over slightly more keys than the cache holds, like a
+//   nested loop join rereading its inner table. LRU always evicts the key
+//   that's needed next, so it never hits.
+
+// No policy wins every trace. Some things to look for in the results:
+// - On the loop, every policy that keeps its keys in LRU order (LRU, LRU-K,
+//   ARC) evicts the key that's needed next, just like LRU. 2Q keeps the keys
+//   that came back through a1_out_ in am_, and those stay.
+// - On the hot set, the hot keys are hit many times while they're still in
+//   2Q's a1_in_ queue, which 2Q treats as one burst, so it never promotes
+//   them and a scan evicts them like LRU would. LRU-K and ARC keep them.
+// - CLOCK's hit rate is close to LRU's, but a hit only sets a bit, so it's
+//   usually the fastest per lookup.
+
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::mt19937_64.
+#include <random>
+// Includes std::string.
+#include <string>
+// Includes the vector container.
+#include <vector>
+
+// Includes the policies and PolicyCache.
+#include "cache/replacer.h"
+// Includes ZipfianGenerator.
+#include "cache/zipfian.h"
+
+/* ======================================================================
+   === Traces ===========================================================
+   ====================================================================== */
+
+constexpr size_t CAPACITY = 10000;
+constexpr size_t OPS = 2000000;
+
+// Scans use keys from this value on, so they never collide with the others.
+constexpr uint64_t SCAN_KEYS = uint64_t{1} << 40;
+
+struct Trace {
+  std::string name_;
+  std::vector<uint64_t> keys_;
+};
+
+Trace ZipfianTrace() {
+  cache::ZipfianGenerator zipfian(100000, 0.99, 445);
+  Trace trace{"Zipfian", {}};
+  trace.keys_.reserve(OPS);
+  while (trace.keys_.size() < OPS) {
+    trace.keys_.push_back(zipfian());
+  }
+  return trace;
+}
+
+// Every `period` lookups, scans 2 * CAPACITY keys that are never used
+// again.
+template <typename NextKey>
+Trace WithScans(std::string name, NextKey next_key, size_t period) {
+  Trace trace{std::move(name), {}};
+  trace.keys_.reserve(OPS);
+  uint64_t scan_key = SCAN_KEYS;
+  while (trace.keys_.size() < OPS) {
+    for (size_t i = 0; i < period && trace.keys_.size() < OPS; ++i) {
+      trace.keys_.push_back(next_key());
+    }
+    for (size_t i = 0; i < 2 * CAPACITY && trace.keys_.size() < OPS; ++i) {
+      trace.keys_.push_back(scan_key++);
+    }
+  }
+  return trace;
+}
+
+Trace ZipfianScanTrace() {
+  cache::ZipfianGenerator zipfian(100000, 0.99, 445);
+  return WithScans("Zipfian + scans", [&] { return zipfian(); }, 100000);
+}
+
+Trace HotSetScanTrace() {
+  std::mt19937_64 gen(445);
+  std::uniform_int_distribution<uint64_t> hot_key(0, CAPACITY / 2 - 1);
+  return WithScans("Hot set + scans", [&] { return hot_key(gen); }, 50000);
+}
+
+Trace LoopTrace() {
+  Trace trace{"Loop", {}};
+  trace.keys_.reserve(OPS);
+  const uint64_t loop = CAPACITY + CAPACITY / 5;
+  for (size_t i = 0; i < OPS; ++i) {
+    trace.keys_.push_back(i % loop);
+  }
+  return trace;
+}
+
+/* ======================================================================
+   === Simulation =======================================================
+   ====================================================================== */
+
+template <typename Policy>
+void Simulate(const Trace &trace) {
+  cache::PolicyCache<uint64_t, uint64_t, Policy> cache(CAPACITY);
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t key : trace.keys_) {
+    if (!cache.Get(key).has_value()) {
+      cache.Put(key, key * 2);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "    " << std::left << std::setw(8) << Policy::NAME << std::right << std::fixed << std::setprecision(1)
+            << std::setw(6) << cache.Stats().HitRate() * 100 << "% hits, " << std::setw(6)
+            << trace.keys_.size() / seconds / 1e6 << "M ops/sec\n";
+}
+
+void SimulateAll(const Trace &trace) {
+  std::cout << "  " << trace.name_ << ":\n";
+  Simulate<cache::LRUPolicy<uint64_t>>(trace);
+  Simulate<cache::LRUKPolicy<uint64_t>>(trace);
+  Simulate<cache::ClockPolicy<uint64_t>>(trace);
+  Simulate<cache::TwoQPolicy<uint64_t>>(trace);
+  Simulate<cache::ARCPolicy<uint64_t>>(trace);
+}
+
+int main() {
+  // Pinning: with a cache of 2 keys and key 1 pinned, key 2 is evicted even
+  // though key 1 is the least recently used one.
+  cache::PolicyCache<int, int, cache::ARCPolicy<int>> small(2);
+  small.Put(1, 10);
+  small.Put(2, 20);
+  small.Pin(1);
+  small.Put(3, 30);
+  std::cout << "With key 1 pinned, key 1 is " << (small.Get(1).has_value() ? "cached" : "evicted") << " and key 2 is "
+            << (small.Get(2).has_value() ? "cached" : "evicted") << "\n";
+  small.Pin(3);
+  std::cout << "With every key pinned, adding key 4 " << (small.Put(4, 40) ? "works" : "fails") << "\n\n";
+
+  std::cout << "Read-through cache of " << CAPACITY << " keys, " << OPS << " lookups per trace:\n";
+  SimulateAll(ZipfianTrace());
+  SimulateAll(ZipfianScanTrace());
+  SimulateAll(HotSetScanTrace());
+  SimulateAll(LoopTrace());
+
+  return 0;
+}
@@ -0,0 +1,444 @@
+/**
+ * @file concurrent_skip_list.cpp
+ * @brief Tutorial code for a concurrent skip list with lock-free reads and
+ * epoch-based memory reclamation.
+ */
+
+// sets.cpp shows std::set, which is not safe to use from several threads at
+// once. The simple fix, which we use as the baseline at the end of this
+// file, is to guard the set with a std::mutex (see mutex.cpp). But then only
+// one thread can use the set at a time, even if all of them only read.
+
+// A skip list is an ordered set that is much easier to make concurrent than
+// a balanced tree. It is a sorted linked list with "express lanes": every
+// node is in the bottom list, about half of the nodes are also in the list
+// above it, a quarter in the list above that, and so on. A search starts in
+// the top list and drops down a level whenever the next node is too far, so
+// it takes O(log n) steps on average. Because there is no rebalancing, every
+// update only changes a few next pointers, and each of those changes can be
+// done with a single compare-and-swap (CAS) instruction instead of a lock.
+
+// This is the lock-free skip list from "The Art of Multiprocessor
+// Programming" by Herlihy and Shavit (chapter 14):
+//  1. Find and iteration never write to shared memory and never wait. They
+//     just skip over nodes that are marked as deleted.
+//  2. Insert links a new node into the bottom list with one CAS, which is
+//     the moment it becomes part of the set, and then links the upper levels.
+//  3. Erase first *marks* the node's next pointers by setting their lowest
+//     bit (nodes are aligned, so the bit is otherwise always 0). A marked
+//     pointer can't be the target of a CAS that expects an unmarked one, so
+//     nobody can link anything after a deleted node. Marking the bottom
+//     level is the moment the key leaves the set. Unlinking the node happens
+//     afterwards, and any thread that walks past a marked node helps.
+
+// Once a node is unlinked, another thread may still be looking at it, so we
+// can't delete it right away. We use epoch-based reclamation (EBR): every
+// operation runs inside an "epoch guard", and an unlinked node is only freed
+// once every thread has left the epoch in which it was unlinked. The EBR
+// library is in reclaim/epoch.h, and epoch_reclamation.cpp benchmarks it.
+
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::mutex and std::scoped_lock.
+#include <mutex>
+// Includes std::mt19937.
+#include <random>
+// Includes the set container we compare against.
+#include <set>
+// Includes std::thread.
+#include <thread>
+// Includes std::vector.
+#include <vector>
+
+// Includes EpochGuard and EpochDomain.
+#include "reclaim/epoch.h"
+
+/* ======================================================================
+   === The skip list ====================================================
+   ====================================================================== */
+
+template <typename Key>
+class ConcurrentSkipList {
+  static constexpr int MAX_LEVEL = 20;
+
+  // A node's next pointers are stored as integers, so that we can use the
+  // lowest bit as the "deleted" mark. Most nodes are only one or two levels
+  // tall, so instead of giving every node MAX_LEVEL next pointers, NewNode
+  // allocates exactly height_ of them right behind the node.
+  struct alignas(alignof(std::atomic<uintptr_t>)) Node {
+    Node(const Key &key, int height) : key_(key), height_(height) {}
+    std::atomic<uintptr_t> &Next(int level) { return reinterpret_cast<std::atomic<uintptr_t> *>(this + 1)[level]; }
+    Key key_;
+    int height_;
+    // Set once the node is linked at every level. Erase waits for this, so
+    // that an insert can never link a level after the node was unlinked.
+    std::atomic<bool> fully_linked_{false};
+  };
+
+  static Node *NewNode(const Key &key, int height) {
+    void *memory = ::operator new(sizeof(Node) + height * sizeof(std::atomic<uintptr_t>));
+    Node *node = new (memory) Node(key, height);
+    for (int level = 0; level < height; ++level) {
+      new (&node->Next(level)) std::atomic<uintptr_t>(0);
+    }
+    return node;
+  }
+
+  static void DeleteNode(void *ptr) {
+    static_cast<Node *>(ptr)->~Node();
+    ::operator delete(ptr);
+  }
+
+  static uintptr_t Pack(Node *node, bool marked) { return reinterpret_cast<uintptr_t>(node) | (marked ? 1 : 0); }
+  static Node *Ptr(uintptr_t packed) { return reinterpret_cast<Node *>(packed & ~uintptr_t{1}); }
+  static bool IsMarked(uintptr_t packed) { return (packed & 1) != 0; }
+
+ public:
+  // The head node is a sentinel with a key smaller than any real key. The
+  // end of every level is nullptr.
+  ConcurrentSkipList() : head_(NewNode(Key{}, MAX_LEVEL)) {}
+
+  // Destroying the list is not thread safe: no other thread may use it.
+  ~ConcurrentSkipList() {
+    Node *node = head_;
+    while (node != nullptr) {
+      Node *next = Ptr(node->Next(0).load());
+      DeleteNode(node);
+      node = next;
+    }
+  }
+
+  ConcurrentSkipList(const ConcurrentSkipList &) = delete;
+  ConcurrentSkipList &operator=(const ConcurrentSkipList &) = delete;
+
+  // Lock-free and read-only: we walk down the levels, stepping over marked
+  // (deleted) nodes without unlinking them.
+  bool Contains(const Key &key) const {
+    reclaim::EpochGuard guard;
+    Node *pred = head_;
+    Node *curr = nullptr;
+    for (int level = levels_.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+      curr = Ptr(pred->Next(level).load(std::memory_order_acquire));
+      while (curr != nullptr) {
+        uintptr_t succ = curr->Next(level).load(std::memory_order_acquire);
+        if (IsMarked(succ)) {
+          curr = Ptr(succ);
+        } else if (curr->key_ < key) {
+          pred = curr;
+          curr = Ptr(succ);
+        } else {
+          break;
+        }
+      }
+    }
+    return curr != nullptr && !(key < curr->key_) && !IsMarked(curr->Next(0).load(std::memory_order_acquire));
+  }
+
+  size_t count(const Key &key) const { return Contains(key) ? 1 : 0; }
+
+  // Returns true if the key was inserted, and false if it was already there.
+  bool Insert(const Key &key) {
+    reclaim::EpochGuard guard;
+    int height = RandomHeight();
+    // Searches start at the highest level in use rather than at MAX_LEVEL,
+    // so we raise it before searching for a node that is taller than that.
+    int levels = levels_.load();
+    while (levels < height && !levels_.compare_exchange_weak(levels, height)) {
+    }
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    while (true) {
+      if (Find(key, preds, succs)) {
+        return false;
+      }
+      Node *node = NewNode(key, height);
+      for (int level = 0; level < height; ++level) {
+        node->Next(level).store(Pack(succs[level], false), std::memory_order_relaxed);
+      }
+
+      // Linking the bottom level is what puts the key into the set.
+      uintptr_t expected = Pack(succs[0], false);
+      if (!preds[0]->Next(0).compare_exchange_strong(expected, Pack(node, false))) {
+        // Someone changed the list under us. Nobody else has seen our node,
+        // so we can delete it right away and try again.
+        DeleteNode(node);
+        continue;
+      }
+
+      // Now we link the upper levels one by one. If a CAS fails, we search
+      // again to get fresh predecessors and successors at that level. The
+      // node isn't linked at this level yet, so nobody else can be changing
+      // its next pointer here.
+      for (int level = 1; level < height; ++level) {
+        while (true) {
+          node->Next(level).store(Pack(succs[level], false));
+          expected = Pack(succs[level], false);
+          if (preds[level]->Next(level).compare_exchange_strong(expected, Pack(node, false))) {
+            break;
+          }
+          Find(key, preds, succs);
+        }
+      }
+      node->fully_linked_.store(true, std::memory_order_release);
+      return true;
+    }
+  }
+
+  // Returns true if this call erased the key.
+  bool Erase(const Key &key) {
+    reclaim::EpochGuard guard;
+    Node *preds[MAX_LEVEL];
+    Node *succs[MAX_LEVEL];
+    if (!Find(key, preds, succs)) {
+      return false;
+    }
+    Node *node = succs[0];
+    while (!node->fully_linked_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+
+    // Mark the upper levels top-down, so no new node can be linked after it.
+    for (int level = node->height_ - 1; level >= 1; --level) {
+      node->Next(level).fetch_or(1);
+    }
+
+    // Marking the bottom level logically deletes the key. If another thread
+    // marked it first, that thread erased the key and we didn't.
+    uintptr_t next = node->Next(0).load();
+    while (true) {
+      if (IsMarked(next)) {
+        return false;
+      }
+      if (node->Next(0).compare_exchange_weak(next, next | 1)) {
+        break;
+      }
+    }
+
+    // Find unlinks every marked node it walks past, which includes ours at
+    // every level. After that no new reader can reach the node, so we hand
+    // it to the global epoch domain.
+    Find(key, preds, succs);
+    reclaim::EpochDomain::Global().Local().Retire(node, DeleteNode);
+    return true;
+  }
+
+  // Calls fn on every key in [low, high), in order. Like Contains, this is
+  // lock-free and only skips over deleted nodes. Keys that are inserted or
+  // erased during the scan may or may not be seen.
+  template <typename Fn>
+  void RangeScan(const Key &low, const Key &high, Fn fn) const {
+    reclaim::EpochGuard guard;
+    Node *pred = head_;
+    for (int level = levels_.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+      Node *curr = Ptr(pred->Next(level).load(std::memory_order_acquire));
+      while (curr != nullptr && curr->key_ < low) {
+        pred = curr;
+        curr = Ptr(curr->Next(level).load(std::memory_order_acquire));
+      }
+    }
+    Node *curr = Ptr(pred->Next(0).load(std::memory_order_acquire));
+    while (curr != nullptr && curr->key_ < high) {
+      uintptr_t next = curr->Next(0).load(std::memory_order_acquire);
+      if (!IsMarked(next) && !(curr->key_ < low)) {
+        fn(curr->key_);
+      }
+      curr = Ptr(next);
+    }
+  }
+
+  // Calls fn on every key, in order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    reclaim::EpochGuard guard;
+    Node *curr = Ptr(head_->Next(0).load(std::memory_order_acquire));
+    while (curr != nullptr) {
+      uintptr_t next = curr->Next(0).load(std::memory_order_acquire);
+      if (!IsMarked(next)) {
+        fn(curr->key_);
+      }
+      curr = Ptr(next);
+    }
+  }
+
+ private:
+  // Fills preds and succs with the nodes before and at-or-after key on every
+  // level, and returns whether succs[0] holds key. Along the way, every
+  // marked node is unlinked with a CAS on its predecessor. If that CAS fails
+  // the predecessor itself changed, so we restart from the top.
+  bool Find(const Key &key, Node **preds, Node **succs) {
+  retry:
+    Node *pred = head_;
+    for (int level = levels_.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+      Node *curr = Ptr(pred->Next(level).load());
+      while (curr != nullptr) {
+        uintptr_t succ = curr->Next(level).load();
+        while (IsMarked(succ)) {
+          uintptr_t expected = Pack(curr, false);
+          if (!pred->Next(level).compare_exchange_strong(expected, Pack(Ptr(succ), false))) {
+            goto retry;
+          }
+          curr = Ptr(succ);
+          if (curr == nullptr) {
+            break;
+          }
+          succ = curr->Next(level).load();
+        }
+        if (curr == nullptr || !(curr->key_ < key)) {
+          break;
+        }
+        pred = curr;
+        curr = Ptr(succ);
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return succs[0] != nullptr && !(key < succs[0]->key_);
+  }
+
+  // Each level is used with half the probability of the level below it.
+  static int RandomHeight() {
+    thread_local std::mt19937 gen(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    int height = 1;
+    while (height < MAX_LEVEL && (gen() & 1) != 0) {
+      height += 1;
+    }
+    return height;
+  }
+
+  Node *head_;
+  std::atomic<int> levels_{1};
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// The baseline: a std::set protected by one mutex, like in mutex.cpp.
+class LockedSet {
+ public:
+  bool Contains(int key) {
+    std::scoped_lock lock(m_);
+    return set_.count(key) == 1;
+  }
+  bool Insert(int key) {
+    std::scoped_lock lock(m_);
+    return set_.insert(key).second;
+  }
+  bool Erase(int key) {
+    std::scoped_lock lock(m_);
+    return set_.erase(key) == 1;
+  }
+
+ private:
+  std::mutex m_;
+  std::set<int> set_;
+};
+
+// Every thread runs ops_per_thread operations on random keys: 80% lookups,
+// 10% inserts and 10% erases. Returns millions of operations per second.
+template <typename Set>
+double RunWorkload(Set &set, int threads, int ops_per_thread, int key_range) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<int> key_dist(0, key_range - 1);
+      for (int i = 0; i < ops_per_thread; ++i) {
+        int key = key_dist(gen);
+        int op = gen() % 10;
+        if (op == 0) {
+          set.Insert(key);
+        } else if (op == 1) {
+          set.Erase(key);
+        } else {
+          set.Contains(key);
+        }
+      }
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return threads * ops_per_thread / seconds / 1e6;
+}
+
+void RunBenchmark() {
+  constexpr int key_range = 100000;
+  constexpr int ops_per_thread = 200000;
+  std::cout << "Benchmark (80% lookups, 10% inserts, 10% erases, " << std::thread::hardware_concurrency()
+            << " hardware threads):\n";
+  for (int threads : {1, 2, 4, 8}) {
+    ConcurrentSkipList<int> skip_list;
+    LockedSet locked_set;
+    for (int key = 0; key < key_range; key += 2) {
+      skip_list.Insert(key);
+      locked_set.Insert(key);
+    }
+    double locked = RunWorkload(locked_set, threads, ops_per_thread, key_range);
+    double lock_free = RunWorkload(skip_list, threads, ops_per_thread, key_range);
+    std::cout << "  " << threads << " threads: mutex + std::set " << locked << " Mops/s, ConcurrentSkipList "
+              << lock_free << " Mops/s\n";
+  }
+}
+
+int main() {
+  // Used from a single thread, the skip list behaves like the set in
+  // sets.cpp.
+  ConcurrentSkipList<int> int_set;
+  for (int i = 1; i <= 10; ++i) {
+    int_set.Insert(i);
+  }
+  if (int_set.Contains(2)) {
+    std::cout << "Element 2 is in int_set.\n";
+  }
+  int_set.Erase(4);
+  if (int_set.count(4) == 0) {
+    std::cout << "Element 4 is not in the set.\n";
+  }
+  std::cout << "Printing the elements of the set:\n";
+  int_set.ForEach([](int key) { std::cout << key << " "; });
+  std::cout << "\n";
+
+  // Four threads insert disjoint ranges of keys at the same time, while a
+  // fifth thread erases the even keys. Nobody takes a lock.
+  ConcurrentSkipList<int> shared;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&shared, t] {
+      for (int key = t * 1000; key < (t + 1) * 1000; ++key) {
+        shared.Insert(key);
+      }
+    });
+  }
+  threads.emplace_back([&shared] {
+    for (int round = 0; round < 3; ++round) {
+      for (int key = 0; key < 4000; key += 2) {
+        shared.Erase(key);
+      }
+    }
+  });
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (int key = 0; key < 4000; key += 2) {
+    shared.Erase(key);
+  }
+  size_t count = 0;
+  shared.ForEach([&count](int) { count += 1; });
+  std::cout << "After the concurrent inserts and erases, " << count << " odd keys remain.\n";
+  std::cout << "Keys in [1990, 2010): ";
+  shared.RangeScan(1990, 2010, [](int key) { std::cout << key << " "; });
+  std::cout << "\n";
+
+  RunBenchmark();
+
+  return 0;
+}
@@ -0,0 +1,378 @@
+/**
+ * @file cow_trie.cpp
+ * @brief Tutorial code for a persistent copy-on-write trie, whose versions
+ * share their unchanged nodes through std::shared_ptr, and a trie store
+ * that lets readers use snapshots without taking a lock for the lookup.
+ */
+
+// shared_ptr.cpp shows that several std::shared_ptrs can own the same
+// object, which is freed when the last of them goes away. This file uses
+// that to build a persistent data structure: one that's never changed in
+// place. Instead, Put and Remove return a new version, and the old version
+// stays valid, unchanged, for as long as someone holds on to it.
+
+// A trie is a tree that stores string keys one character per level: the
+// key "ab" is found by following the child for 'a' from the root, and then
+// the child for 'b'. To Put "ab", we copy only the nodes on that path (the
+// root, the node for "a" and the node for "ab"), and the copies point to
+// the same children as the originals for every other character. So a new
+// version costs O(key length) new nodes, and shares all the others with
+// the old version, through shared_ptrs. When no version uses a node
+// anymore, its last shared_ptr frees it.
+
+//        old root          new root (Put "ab")
+//         /    \            /    \.
+//       [a]    [b] <------/-     [a'] (copy)
+//       /                        /   \.
+//     [ac] <--------------------/    [ab] (new)
+
+// Since a version never changes, any number of threads can read it without
+// a lock. TrieStore builds a key-value store on top: a writer makes a new
+// version and then swaps the store's root to it, while readers keep using
+// whichever version they started with. This is how BusTub's trie store (the
+// first 15-445 project) works, and how many databases implement snapshot
+// isolation in memory.
+
+// Includes std::lower_bound.
+#include <algorithm>
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::shared_ptr.
+#include <memory>
+// Includes std::mutex, std::scoped_lock.
+#include <mutex>
+// Includes std::optional.
+#include <optional>
+// Includes std::mt19937_64.
+#include <random>
+// Includes std::string.
+#include <string>
+// Includes std::string_view.
+#include <string_view>
+// Includes std::thread.
+#include <thread>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+/* ======================================================================
+   === Trie =============================================================
+   ====================================================================== */
+
+template <typename V>
+class Trie {
+ public:
+  // The empty trie.
+  Trie() = default;
+
+  // Returns a pointer to key's value, or nullptr. The pointer stays valid as
+  // long as this Trie (or any copy of it) exists.
+  const V *Get(std::string_view key) const {
+    const Node *node = root_.get();
+    for (char c : key) {
+      if (node == nullptr) {
+        return nullptr;
+      }
+      node = node->Child(c);
+    }
+    return node == nullptr || node->value_ == nullptr ? nullptr : node->value_.get();
+  }
+
+  // Returns a new version of the trie in which key maps to value. This
+  // version doesn't change.
+  Trie Put(std::string_view key, V value) const {
+    auto shared_value = std::make_shared<const V>(std::move(value));
+    return Trie(PutIn(root_.get(), key, std::move(shared_value)));
+  }
+
+  // Returns a new version of the trie without key. Nodes that end up with
+  // no value and no children are dropped.
+  Trie Remove(std::string_view key) const {
+    if (Get(key) == nullptr) {
+      return *this;
+    }
+    return Trie(RemoveFrom(root_.get(), key));
+  }
+
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  struct Node {
+    // Sorted by character. A node usually has few children, and a vector
+    // is much cheaper to copy than a std::map, which matters since every
+    // Put copies a node per character of the key.
+    std::vector<std::pair<char, NodePtr>> children_;
+    // Values are shared too: a copied node points to the same value.
+    std::shared_ptr<const V> value_;
+
+    const Node *Child(char c) const {
+      auto it = Find(c);
+      return it != children_.end() && it->first == c ? it->second.get() : nullptr;
+    }
+
+    typename std::vector<std::pair<char, NodePtr>>::const_iterator Find(char c) const {
+      return std::lower_bound(children_.begin(), children_.end(), c,
+                              [](const std::pair<char, NodePtr> &child, char ch) { return child.first < ch; });
+    }
+
+    bool Empty() const { return children_.empty() && value_ == nullptr; }
+  };
+
+  explicit Trie(NodePtr root) : root_(std::move(root)) {}
+
+  // Returns a copy of node (or a new node, if it's nullptr), with key put
+  // under it. Only the nodes on key's path are new.
+  static NodePtr PutIn(const Node *node, std::string_view key, std::shared_ptr<const V> value) {
+    auto copy = node == nullptr ? std::make_shared<Node>() : std::make_shared<Node>(*node);
+    if (key.empty()) {
+      copy->value_ = std::move(value);
+      return copy;
+    }
+    char c = key.front();
+    auto it = copy->Find(c);
+    bool found = it != copy->children_.end() && it->first == c;
+    NodePtr child = PutIn(found ? it->second.get() : nullptr, key.substr(1), std::move(value));
+    size_t index = static_cast<size_t>(it - copy->children_.cbegin());
+    if (found) {
+      copy->children_[index].second = std::move(child);
+    } else {
+      copy->children_.insert(copy->children_.begin() + static_cast<std::ptrdiff_t>(index), {c, std::move(child)});
+    }
+    return copy;
+  }
+
+  // key must be in the trie under node. Returns nullptr if the copy of node
+  // would be empty.
+  static NodePtr RemoveFrom(const Node *node, std::string_view key) {
+    auto copy = std::make_shared<Node>(*node);
+    if (key.empty()) {
+      copy->value_ = nullptr;
+    } else {
+      auto it = copy->Find(key.front());
+      size_t index = static_cast<size_t>(it - copy->children_.cbegin());
+      NodePtr child = RemoveFrom(it->second.get(), key.substr(1));
+      if (child == nullptr) {
+        copy->children_.erase(copy->children_.begin() + static_cast<std::ptrdiff_t>(index));
+      } else {
+        copy->children_[index].second = std::move(child);
+      }
+    }
+    return copy->Empty() ? nullptr : copy;
+  }
+
+  NodePtr root_;
+};
+
+/* ======================================================================
+   === TrieStore ========================================================
+   ====================================================================== */
+
+// Keeps the snapshot that a value came from alive, so the value stays valid
+// even if a writer removes the key right after.
+template <typename V>
+class ValueGuard {
+ public:
+  ValueGuard(Trie<V> snapshot, const V &value) : snapshot_(std::move(snapshot)), value_(value) {}
+  const V &operator*() const { return value_; }
+  const V *operator->() const { return &value_; }
+
+ private:
+  Trie<V> snapshot_;
+  const V &value_;
+};
+
+// One writer at a time, and any number of readers. A reader takes
+// root_lock_ only to copy the root (one shared_ptr copy), and looks the key
+// up without any lock, so a writer building a new version never blocks it.
+// Writers take write_lock_ for the whole Put, so two writers can't both
+// start from the same version and lose one of the updates.
+
+// root_lock_ could be replaced by std::atomic_load and std::atomic_store on
+// the shared_ptr (or std::atomic<std::shared_ptr> in C++20), but libstdc++
+// implements both with a small table of mutexes anyway.
+template <typename V>
+class TrieStore {
+ public:
+  std::optional<ValueGuard<V>> Get(std::string_view key) {
+    Trie<V> snapshot = Snapshot();
+    const V *value = snapshot.Get(key);
+    if (value == nullptr) {
+      return std::nullopt;
+    }
+    return ValueGuard<V>(std::move(snapshot), *value);
+  }
+
+  void Put(std::string_view key, V value) {
+    std::scoped_lock write_lock(write_lock_);
+    Trie<V> updated = Snapshot().Put(key, std::move(value));
+    std::scoped_lock root_lock(root_lock_);
+    root_ = std::move(updated);
+  }
+
+  void Remove(std::string_view key) {
+    std::scoped_lock write_lock(write_lock_);
+    Trie<V> updated = Snapshot().Remove(key);
+    std::scoped_lock root_lock(root_lock_);
+    root_ = std::move(updated);
+  }
+
+  // The current version. It never changes, whatever writers do afterwards.
+  Trie<V> Snapshot() {
+    std::scoped_lock root_lock(root_lock_);
+    return root_;
+  }
+
+ private:
+  std::mutex root_lock_;
+  std::mutex write_lock_;
+  Trie<V> root_;
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// The baseline: a std::unordered_map that readers and the writer share,
+// guarded by one mutex.
+class MutexMap {
+ public:
+  std::optional<uint64_t> Get(std::string_view key) {
+    std::scoped_lock lock(mutex_);
+    auto it = map_.find(std::string(key));
+    return it == map_.end() ? std::nullopt : std::optional<uint64_t>(it->second);
+  }
+
+  void Put(std::string_view key, uint64_t value) {
+    std::scoped_lock lock(mutex_);
+    map_[std::string(key)] = value;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, uint64_t> map_;
+};
+
+constexpr size_t KEYS = 100000;
+constexpr size_t READS_PER_READER = 300000;
+
+std::vector<std::string> MakeKeys() {
+  std::vector<std::string> keys;
+  keys.reserve(KEYS);
+  for (size_t i = 0; i < KEYS; ++i) {
+    keys.push_back("key" + std::to_string(i * 7919 % KEYS));
+  }
+  return keys;
+}
+
+// Runs `readers` threads that each do READS_PER_READER lookups, while one
+// writer keeps updating random keys until the readers are done.
+template <typename Store, typename Read>
+void Measure(const char *name, Store &store, const std::vector<std::string> &keys, size_t readers, Read read) {
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> found{0};
+  uint64_t writes = 0;
+  std::thread writer([&] {
+    std::mt19937_64 gen(445);
+    while (!done.load(std::memory_order_relaxed)) {
+      store.Put(keys[gen() % KEYS], writes);
+      writes += 1;
+    }
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < readers; ++t) {
+    // Each reader gets its own copy of read.
+    threads.emplace_back([&, t, read]() mutable {
+      std::mt19937_64 gen(t);
+      uint64_t local = 0;
+      for (size_t i = 0; i < READS_PER_READER; ++i) {
+        local += read(store, keys[gen() % KEYS]) ? 1 : 0;
+      }
+      found += local;
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  done = true;
+  writer.join();
+
+  std::cout << "    " << std::left << std::setw(26) << name << std::right << readers << " readers: " << std::fixed
+            << std::setprecision(2) << std::setw(6) << readers * READS_PER_READER / seconds / 1e6
+            << "M reads/sec, " << std::setw(6) << writes / seconds / 1e6 << "M writes/sec"
+            << (found != readers * READS_PER_READER ? ", MISSING KEYS" : "") << "\n";
+}
+
+void RunBenchmark() {
+  std::vector<std::string> keys = MakeKeys();
+  TrieStore<uint64_t> trie_store;
+  MutexMap mutex_map;
+  for (const std::string &key : keys) {
+    trie_store.Put(key, 0);
+    mutex_map.Put(key, 0);
+  }
+
+  // What to expect: a lookup in the trie follows one pointer per character
+  // (about 8 here), while the hash map hashes once and follows about one,
+  // and every Put copies a path of nodes and frees the old one. So one
+  // thread alone is faster with the map. The trie wins when readers would
+  // otherwise wait: with many cores, the map's readers all queue up on its
+  // mutex, and each one also waits for every write. The trie's readers only
+  // share root_lock_ for a shared_ptr copy, or not at all with a snapshot.
+  std::cout << KEYS << " keys, random reads, one writer updating random keys:\n";
+  for (size_t readers : {1, 2, 4}) {
+    Measure("TrieStore", trie_store, keys, readers,
+            [](TrieStore<uint64_t> &store, const std::string &key) { return store.Get(key).has_value(); });
+    // Readers that take one snapshot and do all their lookups in it (a
+    // read-only transaction) don't even touch root_lock_ per lookup.
+    Measure("Trie snapshot per 1000", trie_store, keys, readers,
+            [snapshot = trie_store.Snapshot(), count = size_t{0}](TrieStore<uint64_t> &store,
+                                                                  const std::string &key) mutable {
+              if (++count % 1000 == 0) {
+                snapshot = store.Snapshot();
+              }
+              return snapshot.Get(key) != nullptr;
+            });
+    Measure("mutex + unordered_map", mutex_map, keys, readers,
+            [](MutexMap &store, const std::string &key) { return store.Get(key).has_value(); });
+  }
+}
+
+int main() {
+  Trie<int> empty;
+  Trie<int> v1 = empty.Put("cmu", 15);
+  Trie<int> v2 = v1.Put("cmu", 445).Put("cs", 213);
+  Trie<int> v3 = v2.Remove("cmu");
+
+  // Every version still has its own values.
+  std::cout << "v1: cmu = " << *v1.Get("cmu") << ", cs is " << (v1.Get("cs") ? "there" : "not there") << "\n";
+  std::cout << "v2: cmu = " << *v2.Get("cmu") << ", cs = " << *v2.Get("cs") << "\n";
+  std::cout << "v3: cmu is " << (v3.Get("cmu") ? "there" : "not there") << ", cs = " << *v3.Get("cs") << "\n";
+
+  // A value from the store stays valid after the key is removed, because
+  // the guard keeps its snapshot alive.
+  TrieStore<std::string> store;
+  store.Put("course", "15-445");
+  auto course = store.Get("course");
+  store.Remove("course");
+  std::cout << "The guard still says " << **course << ", and the store now has "
+            << (store.Get("course").has_value() ? "it" : "nothing") << "\n\n";
+
+  RunBenchmark();
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file disk_scheduler.cpp
+ * @brief Tutorial code for an asynchronous disk scheduler, which uses the
+ * condition variable producer/consumer pattern from condition_variable.cpp
+ * to hand page I/O to background workers.
+ */
+
+// The scheduler is in cache/disk_scheduler.h. This file shows how to use it,
+// and benchmarks random and sequential page reads and writes on a local
+// file, comparing:
+// - A blocking pread or pwrite per page, on the calling thread.
+// - A scheduler with one worker that doesn't merge (a batch of 1).
+// - A scheduler with one worker that merges batches of up to 16 requests.
+// - A scheduler with four workers that merge.
+// The caller keeps up to DEPTH requests in flight, like a scan that reads
+// ahead, or a buffer pool flushing dirty pages.
+
+// Includes std::array.
+#include <array>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::memcpy.
+#include <cstring>
+// Includes std::filesystem::temp_directory_path, std::filesystem::remove.
+#include <filesystem>
+// Includes std::future.
+#include <future>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::mt19937_64.
+#include <random>
+// Includes std::string.
+#include <string>
+// Includes std::system_error.
+#include <system_error>
+// Includes the vector container.
+#include <vector>
+
+// Includes DiskScheduler.
+#include "cache/disk_scheduler.h"
+
+/* ======================================================================
+   === Demo =============================================================
+   ====================================================================== */
+
+void Demo(const std::string &path) {
+  cache::DiskManager disk(path);
+  cache::DiskScheduler scheduler(&disk);
+
+  // The buffers have to outlive the requests.
+  std::array<char, cache::PAGE_SIZE> written{};
+  std::array<char, cache::PAGE_SIZE> read{};
+  std::memcpy(written.data(), "15-445", 7);
+
+  // ScheduleWrite returns right away. The caller can do other work, and
+  // then wait for the write with get().
+  std::future<void> write = scheduler.ScheduleWrite(3, written.data());
+  write.get();
+  std::future<void> reading = scheduler.ScheduleRead(3, read.data());
+  reading.get();
+  std::cout << "Page 3 says " << read.data() << "\n";
+
+  // An I/O error shows up as an exception from get(). Reading into an
+  // invalid buffer makes preadv fail with EFAULT.
+  try {
+    scheduler.ScheduleRead(0, nullptr).get();
+  } catch (const std::system_error &e) {
+    std::cout << "Reading into nullptr: " << e.what() << "\n";
+  }
+  std::cout << "\n";
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+constexpr size_t FILE_PAGES = 16384;
+constexpr size_t OPS = 65536;
+constexpr size_t DEPTH = 64;
+
+std::vector<cache::PageId> SequentialPages() {
+  std::vector<cache::PageId> pages(OPS);
+  for (size_t i = 0; i < OPS; ++i) {
+    pages[i] = static_cast<cache::PageId>(i % FILE_PAGES);
+  }
+  return pages;
+}
+
+std::vector<cache::PageId> RandomPages() {
+  std::mt19937_64 gen(445);
+  std::uniform_int_distribution<cache::PageId> page(0, FILE_PAGES - 1);
+  std::vector<cache::PageId> pages(OPS);
+  for (cache::PageId &page_id : pages) {
+    page_id = page(gen);
+  }
+  return pages;
+}
+
+void Report(const char *name, double seconds, double calls_per_page) {
+  std::cout << "    " << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(7) << OPS / seconds / 1e6 << "M pages/sec, " << calls_per_page
+            << " system calls per page\n";
+}
+
+void MeasureBlocking(cache::DiskManager &disk, bool is_write, const std::vector<cache::PageId> &pages) {
+  std::vector<char> buffer(cache::PAGE_SIZE, 'x');
+  auto start = std::chrono::steady_clock::now();
+  for (cache::PageId page_id : pages) {
+    if (is_write) {
+      disk.WritePage(page_id, buffer.data());
+    } else {
+      disk.ReadPage(page_id, buffer.data());
+    }
+  }
+  Report("blocking pread/pwrite", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+         1.0);
+}
+
+void MeasureScheduler(const char *name, cache::DiskManager &disk, size_t workers, size_t max_batch, bool is_write,
+                      const std::vector<cache::PageId> &pages) {
+  cache::DiskScheduler scheduler(&disk, workers, max_batch);
+  // One buffer per request in flight. Request i uses slot i % DEPTH, and
+  // waits for the request that used the slot before it.
+  std::vector<char> buffers(DEPTH * cache::PAGE_SIZE, 'x');
+  std::vector<std::future<void>> in_flight(DEPTH);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < pages.size(); ++i) {
+    size_t slot = i % DEPTH;
+    if (in_flight[slot].valid()) {
+      in_flight[slot].get();
+    }
+    char *data = buffers.data() + slot * cache::PAGE_SIZE;
+    in_flight[slot] = is_write ? scheduler.ScheduleWrite(pages[i], data) : scheduler.ScheduleRead(pages[i], data);
+  }
+  for (std::future<void> &future : in_flight) {
+    if (future.valid()) {
+      future.get();
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Report(name, seconds, static_cast<double>(scheduler.SystemCalls()) / static_cast<double>(scheduler.Requests()));
+}
+
+void RunBenchmark(const std::string &path) {
+  cache::DiskManager disk(path);
+  {
+    std::vector<char> page(cache::PAGE_SIZE, 'x');
+    for (size_t i = 0; i < FILE_PAGES; ++i) {
+      disk.WritePage(static_cast<cache::PageId>(i), page.data());
+    }
+    disk.Sync();
+  }
+
+  // The file fits in the OS's page cache, so a page I/O here is a 4KB copy
+  // from the kernel, which takes about a microsecond. That's less than the
+  // cost of a handoff to a worker (a mutex, a condition variable and a
+  // promise per request), so the blocking calls win. What the numbers do
+  // show is how much merging saves: sequential I/O takes one system call
+  // per 16 pages instead of one per page. With a real disk, where a page
+  // I/O takes from 10 microseconds (an SSD) to 10 milliseconds (a hard
+  // drive), the handoff is noise, and the scheduler lets the caller keep
+  // the disk busy while it does other work.
+  std::cout << OPS << " page I/Os over a file of " << FILE_PAGES << " pages, " << DEPTH << " in flight:\n";
+  std::vector<cache::PageId> sequential = SequentialPages();
+  std::vector<cache::PageId> random = RandomPages();
+  for (bool is_write : {false, true}) {
+    for (bool is_random : {false, true}) {
+      const std::vector<cache::PageId> &pages = is_random ? random : sequential;
+      std::cout << "  " << (is_random ? "Random " : "Sequential ") << (is_write ? "writes" : "reads") << ":\n";
+      MeasureBlocking(disk, is_write, pages);
+      MeasureScheduler("scheduler, 1 worker, no merging", disk, 1, 1, is_write, pages);
+      MeasureScheduler("scheduler, 1 worker, batches of 16", disk, 1, 16, is_write, pages);
+      MeasureScheduler("scheduler, 4 workers, batches of 16", disk, 4, 16, is_write, pages);
+    }
+  }
+}
+
+int main() {
+  std::string path = (std::filesystem::temp_directory_path() / "bootcamp_disk_scheduler.db").string();
+  std::filesystem::remove(path);
+
+  Demo(path);
+  RunBenchmark(path);
+
+  std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file epoch_reclamation.cpp
+ * @brief Tutorial code for epoch-based memory reclamation, the scheme that
+ * lets lock-free data structures free the nodes they unlink.
+ */
+
+// The library is in reclaim/epoch.h, and concurrent_skip_list.cpp uses it.
+// This file shows the API, and then benchmarks a "churn" workload: threads
+// keep replacing objects in a small shared table while other operations
+// read them without locks, so every write retires an object. We compare:
+// - Never freeing anything, which is the fastest a scheme could be.
+// - EBR with batch sizes from 1 to 1024: how often a thread scans the other
+//   threads' slots to advance the epoch and free its retired objects.
+// - std::shared_ptr with std::atomic_load and std::atomic_store, where
+//   every reader pays for a reference count instead.
+// - EBR with a reader that stalls inside a guard for the whole run.
+// For each, we report the throughput, and the high-water mark of objects
+// that were retired but not yet freed, which is the memory EBR costs.
+
+// Includes std::array.
+#include <array>
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::shared_ptr and std::atomic_load.
+#include <memory>
+// Includes std::mutex and std::scoped_lock.
+#include <mutex>
+// Includes std::optional.
+#include <optional>
+// Includes std::mt19937.
+#include <random>
+// Includes std::string.
+#include <string>
+// Includes std::thread.
+#include <thread>
+// Includes the vector container.
+#include <vector>
+
+// Includes EpochDomain, Participant and EpochGuard.
+#include "reclaim/epoch.h"
+
+/* ======================================================================
+   === Demo =============================================================
+   ====================================================================== */
+
+// Says when it's destroyed, so that we can see when EBR frees it.
+struct Noisy {
+  explicit Noisy(int id) : id_(id) {}
+  ~Noisy() { std::cout << "  (freed " << id_ << ")\n"; }
+  int id_;
+};
+
+void Demo() {
+  // A thread tries to free its retired objects every 4 retires.
+  reclaim::EpochDomain domain(4);
+  reclaim::Participant writer = domain.Register();
+  std::atomic<Noisy *> current{new Noisy(0)};
+
+  // Each replacement retires the old object. It's freed two epochs later,
+  // and the epoch only moves when a batch is collected, so the frees lag
+  // the retires.
+  std::cout << "Replacing objects 0 to 9 with 1 to 10:\n";
+  for (int id = 1; id <= 10; ++id) {
+    reclaim::EpochGuard guard(writer);
+    writer.Retire(current.exchange(new Noisy(id)));
+  }
+  std::cout << "  " << writer.Pending() << " retired objects are not freed yet\n";
+
+  // A reader that stays inside a guard pins its epoch, and nothing retired
+  // after that can be freed until it leaves, however often we collect.
+  reclaim::Participant reader = domain.Register();
+  reader.Enter();
+  std::cout << "A reader enters, and we replace objects 10 to 29:\n";
+  for (int id = 11; id <= 30; ++id) {
+    reclaim::EpochGuard guard(writer);
+    writer.Retire(current.exchange(new Noisy(id)));
+  }
+  std::cout << "  " << writer.Pending() << " retired objects are not freed yet\n";
+  std::cout << "The reader leaves:\n";
+  reader.Exit();
+  writer.Collect();
+  writer.Collect();
+  std::cout << "  " << writer.Pending() << " retired objects are not freed yet\n";
+
+  // The current object was never retired, so it's ours to delete.
+  delete current.load();
+  reclaim::ReclaimStats stats = domain.Stats();
+  std::cout << "Retired " << stats.retired_ << ", freed " << stats.freed_ << ", at most " << stats.high_water_mark_
+            << " waiting at once\n\n";
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+constexpr size_t SLOTS = 64;
+constexpr int OPS_PER_THREAD = 250000;
+constexpr int WRITE_PERCENT = 50;
+
+// A cache line, like a small node of a lock-free structure.
+struct Node {
+  explicit Node(uint64_t value) : value_(value) {}
+  uint64_t value_;
+  char payload_[56]{};
+};
+
+// Every scheme has a Worker, which one thread uses to read and replace the
+// table's objects.
+
+// Never frees anything while the threads run. The workers hand the objects
+// they replaced to the scheme, which frees them at the end.
+class LeakScheme {
+ public:
+  LeakScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      slot.store(new Node(0));
+    }
+  }
+  ~LeakScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      delete slot.load();
+    }
+    for (Node *node : leaked_) {
+      delete node;
+    }
+  }
+  std::optional<uint64_t> HighWaterMark() const { return leaked_.size(); }
+
+  class Worker {
+   public:
+    explicit Worker(LeakScheme &scheme) : scheme_(scheme) {}
+    // The other workers may still be reading these, so only the scheme
+    // frees them, once every worker is done.
+    ~Worker() {
+      std::scoped_lock lock(scheme_.m_);
+      scheme_.leaked_.insert(scheme_.leaked_.end(), leaked_.begin(), leaked_.end());
+    }
+    uint64_t Read(size_t slot) { return scheme_.slots_[slot].load()->value_; }
+    void Write(size_t slot, uint64_t value) { leaked_.push_back(scheme_.slots_[slot].exchange(new Node(value))); }
+
+   private:
+    LeakScheme &scheme_;
+    std::vector<Node *> leaked_;
+  };
+
+ private:
+  std::array<std::atomic<Node *>, SLOTS> slots_;
+  std::mutex m_;
+  std::vector<Node *> leaked_;
+};
+
+class EpochScheme {
+ public:
+  explicit EpochScheme(size_t batch_size) : domain_(batch_size) {
+    for (std::atomic<Node *> &slot : slots_) {
+      slot.store(new Node(0));
+    }
+  }
+  // domain_ is destroyed after this runs, and frees what's still retired.
+  ~EpochScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      delete slot.load();
+    }
+  }
+  reclaim::EpochDomain &Domain() { return domain_; }
+  std::optional<uint64_t> HighWaterMark() const { return domain_.Stats().high_water_mark_; }
+
+  class Worker {
+   public:
+    explicit Worker(EpochScheme &scheme) : scheme_(scheme), me_(scheme.domain_.Register()) {}
+    uint64_t Read(size_t slot) {
+      reclaim::EpochGuard guard(me_);
+      return scheme_.slots_[slot].load()->value_;
+    }
+    void Write(size_t slot, uint64_t value) {
+      Node *node = new Node(value);
+      reclaim::EpochGuard guard(me_);
+      me_.Retire(scheme_.slots_[slot].exchange(node));
+    }
+
+   private:
+    EpochScheme &scheme_;
+    reclaim::Participant me_;
+  };
+
+ private:
+  reclaim::EpochDomain domain_;
+  std::array<std::atomic<Node *>, SLOTS> slots_;
+};
+
+// A retired object is freed by whichever thread drops the last reference,
+// so nothing waits, but every read increments and decrements a shared
+// reference count. libstdc++ implements std::atomic_load on a shared_ptr
+// with a small table of global mutexes.
+class SharedPtrScheme {
+ public:
+  SharedPtrScheme() {
+    for (std::shared_ptr<Node> &slot : slots_) {
+      slot = std::make_shared<Node>(0);
+    }
+  }
+  std::optional<uint64_t> HighWaterMark() const { return std::nullopt; }
+
+  class Worker {
+   public:
+    explicit Worker(SharedPtrScheme &scheme) : scheme_(scheme) {}
+    uint64_t Read(size_t slot) { return std::atomic_load(&scheme_.slots_[slot])->value_; }
+    void Write(size_t slot, uint64_t value) { std::atomic_store(&scheme_.slots_[slot], std::make_shared<Node>(value)); }
+
+   private:
+    SharedPtrScheme &scheme_;
+  };
+
+ private:
+  std::array<std::shared_ptr<Node>, SLOTS> slots_;
+};
+
+// Keeps the compiler from optimizing the reads away.
+std::atomic<uint64_t> sink{0};
+
+template <typename Scheme>
+void RunChurn(const std::string &name, Scheme &scheme, int threads) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&scheme, t] {
+      typename Scheme::Worker worker(scheme);
+      std::mt19937 gen(t);
+      uint64_t sum = 0;
+      for (int i = 0; i < OPS_PER_THREAD; ++i) {
+        size_t slot = gen() % SLOTS;
+        if (static_cast<int>(gen() % 100) < WRITE_PERCENT) {
+          worker.Write(slot, i);
+        } else {
+          sum += worker.Read(slot);
+        }
+      }
+      sink += sum;
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "  " << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(6) << threads * OPS_PER_THREAD / seconds / 1e6 << " Mops/s, ";
+  std::optional<uint64_t> high_water_mark = scheme.HighWaterMark();
+  if (high_water_mark.has_value()) {
+    std::cout << "at most " << std::setw(7) << *high_water_mark << " retired objects waiting ("
+              << *high_water_mark * sizeof(Node) / 1024 << " KB)\n";
+  } else {
+    std::cout << "nothing waits\n";
+  }
+}
+
+void RunBenchmark(int threads) {
+  std::cout << threads << (threads == 1 ? " thread, " : " threads, ") << OPS_PER_THREAD << " operations each, "
+            << WRITE_PERCENT << "% replacements, " << SLOTS << " objects:\n";
+  {
+    LeakScheme scheme;
+    RunChurn("no reclamation (leak)", scheme, threads);
+  }
+  // A batch of 1 scans every slot on every retire, and frees at most one
+  // object. Bigger batches amortize the scan over more retires, but hold
+  // more objects back.
+  for (size_t batch_size : {1, 16, 64, 256, 1024}) {
+    EpochScheme scheme(batch_size);
+    RunChurn("EBR, batch of " + std::to_string(batch_size), scheme, threads);
+  }
+  {
+    SharedPtrScheme scheme;
+    RunChurn("std::shared_ptr, atomic_load/store", scheme, threads);
+  }
+  // Nothing can be freed while a reader is stuck in its guard, so EBR's
+  // memory is unbounded: every object retired during the run waits.
+  {
+    EpochScheme scheme(64);
+    reclaim::Participant stalled = scheme.Domain().Register();
+    stalled.Enter();
+    RunChurn("EBR, batch of 64, a stalled reader", scheme, threads);
+    stalled.Exit();
+  }
+}
+
+int main() {
+  Demo();
+
+  // With one thread, the epoch advances at every collect, and EBR holds
+  // back two batches of objects. A small batch can even be the fastest,
+  // since malloc hands the object that was just freed right back.
+  RunBenchmark(1);
+  // Most of a thread's time is spent inside a guard, so a thread that's
+  // descheduled is usually inside one, and holds the epoch back until it
+  // runs again. With fewer cores than threads, the high-water marks are
+  // about a time slice's worth of retires, whatever the batch size. Freeing
+  // memory soon also makes everything but the leak faster: malloc reuses
+  // blocks that are still in the cache, instead of touching new pages.
+  std::cout << std::thread::hardware_concurrency() << " hardware threads.\n";
+  RunBenchmark(4);
+  return 0;
+}
@@ -0,0 +1,613 @@
+/**
+ * @file extendible_hash_index.cpp
+ * @brief Tutorial code for a disk-oriented extendible hash index.
+ */
+
+// unordered_maps.cpp shows std::unordered_map, which is a hash table that
+// lives entirely in memory. When it runs out of room, it rehashes: it
+// allocates a bigger bucket array and moves every single element over, so
+// the one insert that triggers the rehash is much slower than all of the
+// others. A database can't afford either of those properties. Its indexes
+// have to be stored on disk, and an insert should never stall for a time
+// that is proportional to the size of the whole table.
+
+// Extendible hashing solves both problems. The index is made of fixed-size
+// pages, and it grows one bucket at a time:
+//  1. A directory page maps the low `global_depth` bits of a key's hash to a
+//     bucket page. Several directory slots may point to the same bucket.
+//  2. Every bucket remembers its own `local_depth`, which is the number of
+//     hash bits that all of the keys in the bucket have in common.
+//  3. When a bucket overflows, only that bucket is split into two. If its
+//     local depth was already equal to the global depth, the directory
+//     doubles first, which only copies the (small) directory, not the data.
+//  4. When a bucket becomes empty, it is merged back with its split image,
+//     and the directory shrinks when no bucket needs all of its bits.
+// To go beyond a single directory page, we follow the same layout as the
+// BusTub hash index: a header page uses the high bits of the hash to pick
+// one of many directory pages.
+
+// Every page in this file is a plain struct with no pointers inside of it,
+// so it can be written to a file byte for byte and read back later. Pages
+// refer to each other by page id, never by memory address.
+
+// Includes std::fill and std::max.
+#include <algorithm>
+// Includes std::array.
+#include <array>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::remove (deleting the demo file).
+#include <cstdio>
+// Includes std::memset.
+#include <cstring>
+// Includes std::ofstream and std::ifstream.
+#include <fstream>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::optional.
+#include <optional>
+// Includes std::invalid_argument.
+#include <stdexcept>
+// Includes std::string.
+#include <string>
+// Includes std::is_trivially_copyable.
+#include <type_traits>
+// Includes the unordered_map container we compare against.
+#include <unordered_map>
+// Includes std::vector.
+#include <vector>
+
+using page_id_t = int32_t;
+static constexpr page_id_t INVALID_PAGE_ID = -1;
+static constexpr size_t PAGE_SIZE = 4096;
+
+// A page is nothing more than PAGE_SIZE bytes. The header, directory and
+// bucket page classes below are "views" that we lay over these bytes with
+// reinterpret_cast, the same way a real storage engine does.
+struct Page {
+  alignas(64) char data_[PAGE_SIZE];
+};
+
+// The PageStore plays the role of the disk manager. It hands out page ids,
+// keeps the pages in memory, and can write all of them to a file or read
+// them back. A freed page id is recycled by the next NewPage call.
+class PageStore {
+public:
+  page_id_t NewPage() {
+    if (!free_list_.empty()) {
+      page_id_t page_id = free_list_.back();
+      free_list_.pop_back();
+      std::memset(pages_[page_id]->data_, 0, PAGE_SIZE);
+      return page_id;
+    }
+    pages_.push_back(std::make_unique<Page>());
+    std::memset(pages_.back()->data_, 0, PAGE_SIZE);
+    return static_cast<page_id_t>(pages_.size() - 1);
+  }
+
+  void DeletePage(page_id_t page_id) { free_list_.push_back(page_id); }
+
+  char *GetPageData(page_id_t page_id) { return pages_[page_id]->data_; }
+
+  size_t NumPages() const { return pages_.size() - free_list_.size(); }
+
+  // The file format is simply the page count, followed by the free list,
+  // followed by every page in page id order.
+  bool WriteToFile(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    uint32_t num_pages = pages_.size();
+    uint32_t num_free = free_list_.size();
+    out.write(reinterpret_cast<const char *>(&num_pages), sizeof(num_pages));
+    out.write(reinterpret_cast<const char *>(&num_free), sizeof(num_free));
+    out.write(reinterpret_cast<const char *>(free_list_.data()),
+              num_free * sizeof(page_id_t));
+    for (const auto &page : pages_) {
+      out.write(page->data_, PAGE_SIZE);
+    }
+    return static_cast<bool>(out);
+  }
+
+  bool ReadFromFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    uint32_t num_pages = 0;
+    uint32_t num_free = 0;
+    in.read(reinterpret_cast<char *>(&num_pages), sizeof(num_pages));
+    in.read(reinterpret_cast<char *>(&num_free), sizeof(num_free));
+    free_list_.resize(num_free);
+    in.read(reinterpret_cast<char *>(free_list_.data()),
+            num_free * sizeof(page_id_t));
+    pages_.clear();
+    for (uint32_t i = 0; i < num_pages; ++i) {
+      pages_.push_back(std::make_unique<Page>());
+      in.read(pages_.back()->data_, PAGE_SIZE);
+    }
+    return static_cast<bool>(in);
+  }
+
+private:
+  std::vector<std::unique_ptr<Page>> pages_;
+  std::vector<page_id_t> free_list_;
+};
+
+// The header page is the root of the index. The top `max_depth_` bits of a
+// hash select one of its slots, and every slot holds the page id of a
+// directory page (or INVALID_PAGE_ID if no key has landed there yet).
+static constexpr uint32_t HEADER_MAX_DEPTH = 9;
+
+class HashHeaderPage {
+public:
+  void Init(uint32_t max_depth) {
+    max_depth_ = max_depth;
+    std::fill(directory_page_ids_.begin(), directory_page_ids_.end(),
+              INVALID_PAGE_ID);
+  }
+
+  uint32_t HashToDirectoryIndex(uint32_t hash) const {
+    return max_depth_ == 0 ? 0 : hash >> (32 - max_depth_);
+  }
+  page_id_t GetDirectoryPageId(uint32_t idx) const {
+    return directory_page_ids_[idx];
+  }
+  void SetDirectoryPageId(uint32_t idx, page_id_t page_id) {
+    directory_page_ids_[idx] = page_id;
+  }
+
+private:
+  uint32_t max_depth_;
+  std::array<page_id_t, 1 << HEADER_MAX_DEPTH> directory_page_ids_;
+};
+
+// The directory page maps the low `global_depth_` bits of a hash to a bucket
+// page, and stores the local depth of every bucket next to its page id.
+static constexpr uint32_t DIRECTORY_MAX_DEPTH = 9;
+static constexpr uint32_t DIRECTORY_ARRAY_SIZE = 1 << DIRECTORY_MAX_DEPTH;
+
+class HashDirectoryPage {
+public:
+  void Init(uint32_t max_depth) {
+    max_depth_ = max_depth;
+    global_depth_ = 0;
+    std::fill(local_depths_.begin(), local_depths_.end(), 0);
+    std::fill(bucket_page_ids_.begin(), bucket_page_ids_.end(),
+              INVALID_PAGE_ID);
+  }
+
+  uint32_t Size() const { return 1U << global_depth_; }
+  uint32_t GetGlobalDepth() const { return global_depth_; }
+  uint32_t GetMaxDepth() const { return max_depth_; }
+  uint32_t GetGlobalDepthMask() const { return Size() - 1; }
+
+  uint32_t HashToBucketIndex(uint32_t hash) const {
+    return hash & GetGlobalDepthMask();
+  }
+
+  page_id_t GetBucketPageId(uint32_t idx) const { return bucket_page_ids_[idx]; }
+  void SetBucketPageId(uint32_t idx, page_id_t page_id) {
+    bucket_page_ids_[idx] = page_id;
+  }
+
+  uint32_t GetLocalDepth(uint32_t idx) const { return local_depths_[idx]; }
+  void SetLocalDepth(uint32_t idx, uint32_t depth) {
+    local_depths_[idx] = static_cast<uint8_t>(depth);
+  }
+
+  // Doubling the directory copies the first half of the slots into the second
+  // half, so every new slot points to the same bucket as its "twin".
+  void IncrGlobalDepth() {
+    uint32_t old_size = Size();
+    for (uint32_t i = 0; i < old_size; ++i) {
+      bucket_page_ids_[i + old_size] = bucket_page_ids_[i];
+      local_depths_[i + old_size] = local_depths_[i];
+    }
+    global_depth_ += 1;
+  }
+
+  void DecrGlobalDepth() { global_depth_ -= 1; }
+
+  // The directory can only shrink if no bucket uses all global_depth_ bits.
+  bool CanShrink() const {
+    if (global_depth_ == 0) {
+      return false;
+    }
+    for (uint32_t i = 0; i < Size(); ++i) {
+      if (local_depths_[i] == global_depth_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  uint32_t max_depth_;
+  uint32_t global_depth_;
+  std::array<uint8_t, DIRECTORY_ARRAY_SIZE> local_depths_;
+  std::array<page_id_t, DIRECTORY_ARRAY_SIZE> bucket_page_ids_;
+};
+
+// Why a bucket did or didn't take a key, so that the index can tell a
+// duplicate (give up) from a full bucket (split it) with a single scan.
+enum class BucketInsertResult { INSERTED, DUPLICATE, FULL };
+
+// The bucket page is an unsorted array of key-value pairs. Keys and values
+// must be trivially copyable, since the page is written to disk as raw bytes.
+template <typename K, typename V>
+class HashBucketPage {
+public:
+  static constexpr uint32_t BUCKET_ARRAY_SIZE =
+      (PAGE_SIZE - 2 * sizeof(uint32_t)) / sizeof(std::pair<K, V>);
+
+  void Init(uint32_t max_size = BUCKET_ARRAY_SIZE) {
+    size_ = 0;
+    max_size_ = max_size;
+  }
+
+  std::optional<V> Lookup(const K &key) const {
+    for (uint32_t i = 0; i < size_; ++i) {
+      if (array_[i].first == key) {
+        return array_[i].second;
+      }
+    }
+    return std::nullopt;
+  }
+
+  BucketInsertResult Insert(const K &key, const V &value) {
+    if (Lookup(key).has_value()) {
+      return BucketInsertResult::DUPLICATE;
+    }
+    if (IsFull()) {
+      return BucketInsertResult::FULL;
+    }
+    array_[size_++] = {key, value};
+    return BucketInsertResult::INSERTED;
+  }
+
+  // Removing swaps the last entry into the hole, so the array stays dense.
+  bool Remove(const K &key) {
+    for (uint32_t i = 0; i < size_; ++i) {
+      if (array_[i].first == key) {
+        array_[i] = array_[size_ - 1];
+        size_ -= 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const std::pair<K, V> &EntryAt(uint32_t idx) const { return array_[idx]; }
+  void Clear() { size_ = 0; }
+  uint32_t Size() const { return size_; }
+  bool IsFull() const { return size_ == max_size_; }
+  bool IsEmpty() const { return size_ == 0; }
+
+private:
+  uint32_t size_;
+  uint32_t max_size_;
+  std::pair<K, V> array_[BUCKET_ARRAY_SIZE];
+};
+
+// These static_asserts check that every page view actually fits in a page.
+static_assert(sizeof(HashHeaderPage) <= PAGE_SIZE);
+static_assert(sizeof(HashDirectoryPage) <= PAGE_SIZE);
+static_assert(sizeof(HashBucketPage<int32_t, int32_t>) <= PAGE_SIZE);
+
+// The extendible hash index itself. Page 0 of the store is always the
+// header page, so an index that was written to a file can be reopened by
+// reading the file back into a PageStore and passing it in.
+template <typename K, typename V>
+class ExtendibleHashIndex {
+  static_assert(std::is_trivially_copyable_v<K> &&
+                    std::is_trivially_copyable_v<V>,
+                "keys and values are stored as raw bytes in pages");
+  using BucketPage = HashBucketPage<K, V>;
+
+public:
+  explicit ExtendibleHashIndex(PageStore *store,
+                               uint32_t header_max_depth = HEADER_MAX_DEPTH,
+                               uint32_t bucket_max_size =
+                                   BucketPage::BUCKET_ARRAY_SIZE)
+      : store_(store), header_max_depth_(header_max_depth),
+        bucket_max_size_(bucket_max_size) {
+    // Both limits are baked into the page layouts, and anything larger
+    // would index past the end of a page.
+    if (header_max_depth_ > HEADER_MAX_DEPTH) {
+      throw std::invalid_argument("header_max_depth is larger than "
+                                  "HEADER_MAX_DEPTH");
+    }
+    if (bucket_max_size_ == 0 ||
+        bucket_max_size_ > BucketPage::BUCKET_ARRAY_SIZE) {
+      throw std::invalid_argument("bucket_max_size must be between 1 and "
+                                  "BUCKET_ARRAY_SIZE");
+    }
+    if (store_->NumPages() == 0) {
+      header_page_id_ = store_->NewPage();
+      Header()->Init(header_max_depth_);
+    }
+  }
+
+  std::optional<V> Get(const K &key) {
+    uint32_t hash = Hash(key);
+    page_id_t directory_page_id =
+        Header()->GetDirectoryPageId(Header()->HashToDirectoryIndex(hash));
+    if (directory_page_id == INVALID_PAGE_ID) {
+      return std::nullopt;
+    }
+    HashDirectoryPage *directory = Directory(directory_page_id);
+    page_id_t bucket_page_id =
+        directory->GetBucketPageId(directory->HashToBucketIndex(hash));
+    return Bucket(bucket_page_id)->Lookup(key);
+  }
+
+  // Returns false if the key already exists, or if the bucket is full and
+  // can't be split because the directory is already at its maximum depth.
+  bool Insert(const K &key, const V &value) {
+    uint32_t hash = Hash(key);
+    uint32_t directory_idx = Header()->HashToDirectoryIndex(hash);
+    page_id_t directory_page_id = Header()->GetDirectoryPageId(directory_idx);
+    if (directory_page_id == INVALID_PAGE_ID) {
+      directory_page_id = NewDirectory();
+      Header()->SetDirectoryPageId(directory_idx, directory_page_id);
+    }
+    HashDirectoryPage *directory = Directory(directory_page_id);
+
+    while (true) {
+      uint32_t bucket_idx = directory->HashToBucketIndex(hash);
+      BucketPage *bucket = Bucket(directory->GetBucketPageId(bucket_idx));
+      BucketInsertResult result = bucket->Insert(key, value);
+      if (result != BucketInsertResult::FULL) {
+        return result == BucketInsertResult::INSERTED;
+      }
+      if (!SplitBucket(directory, bucket_idx)) {
+        return false;
+      }
+    }
+  }
+
+  bool Remove(const K &key) {
+    uint32_t hash = Hash(key);
+    page_id_t directory_page_id =
+        Header()->GetDirectoryPageId(Header()->HashToDirectoryIndex(hash));
+    if (directory_page_id == INVALID_PAGE_ID) {
+      return false;
+    }
+    HashDirectoryPage *directory = Directory(directory_page_id);
+    uint32_t bucket_idx = directory->HashToBucketIndex(hash);
+    if (!Bucket(directory->GetBucketPageId(bucket_idx))->Remove(key)) {
+      return false;
+    }
+    MergeBuckets(directory, bucket_idx);
+    return true;
+  }
+
+  // Returns the largest global depth of any directory page, for debugging.
+  uint32_t MaxGlobalDepth() {
+    uint32_t depth = 0;
+    for (uint32_t i = 0; i < (1U << header_max_depth_); ++i) {
+      page_id_t directory_page_id = Header()->GetDirectoryPageId(i);
+      if (directory_page_id != INVALID_PAGE_ID) {
+        depth = std::max(depth, Directory(directory_page_id)->GetGlobalDepth());
+      }
+    }
+    return depth;
+  }
+
+private:
+  // libstdc++'s std::hash<int> is the identity function, which would put
+  // every small key in header slot 0. We mix the bits with the MurmurHash3
+  // finalizer so that both the high and the low bits are well distributed.
+  static uint32_t Hash(const K &key) {
+    uint64_t h = std::hash<K>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+  }
+
+  HashHeaderPage *Header() {
+    return reinterpret_cast<HashHeaderPage *>(
+        store_->GetPageData(header_page_id_));
+  }
+  HashDirectoryPage *Directory(page_id_t page_id) {
+    return reinterpret_cast<HashDirectoryPage *>(store_->GetPageData(page_id));
+  }
+  BucketPage *Bucket(page_id_t page_id) {
+    return reinterpret_cast<BucketPage *>(store_->GetPageData(page_id));
+  }
+
+  page_id_t NewDirectory() {
+    page_id_t directory_page_id = store_->NewPage();
+    page_id_t bucket_page_id = store_->NewPage();
+    Directory(directory_page_id)->Init(DIRECTORY_MAX_DEPTH);
+    Bucket(bucket_page_id)->Init(bucket_max_size_);
+    Directory(directory_page_id)->SetBucketPageId(0, bucket_page_id);
+    return directory_page_id;
+  }
+
+  // Splits the bucket at bucket_idx into itself and a new split image. Only
+  // the entries of this one bucket are moved.
+  bool SplitBucket(HashDirectoryPage *directory, uint32_t bucket_idx) {
+    uint32_t local_depth = directory->GetLocalDepth(bucket_idx);
+    if (local_depth == directory->GetGlobalDepth()) {
+      if (directory->GetGlobalDepth() == directory->GetMaxDepth()) {
+        return false;
+      }
+      directory->IncrGlobalDepth();
+    }
+
+    page_id_t old_page_id = directory->GetBucketPageId(bucket_idx);
+    page_id_t new_page_id = store_->NewPage();
+    BucketPage *old_bucket = Bucket(old_page_id);
+    BucketPage *new_bucket = Bucket(new_page_id);
+    new_bucket->Init(bucket_max_size_);
+
+    // Every directory slot that pointed to the old bucket and has the new
+    // hash bit set now points to the new bucket instead.
+    uint32_t new_bit = 1U << local_depth;
+    for (uint32_t i = 0; i < directory->Size(); ++i) {
+      if (directory->GetBucketPageId(i) == old_page_id) {
+        directory->SetLocalDepth(i, local_depth + 1);
+        if ((i & new_bit) != 0) {
+          directory->SetBucketPageId(i, new_page_id);
+        }
+      }
+    }
+
+    // Redistribute the entries by the new hash bit. We copy them out first,
+    // since the old bucket is rebuilt in place.
+    std::vector<std::pair<K, V>> entries;
+    entries.reserve(old_bucket->Size());
+    for (uint32_t i = 0; i < old_bucket->Size(); ++i) {
+      entries.push_back(old_bucket->EntryAt(i));
+    }
+    old_bucket->Clear();
+    for (const auto &[key, value] : entries) {
+      if ((Hash(key) & new_bit) != 0) {
+        new_bucket->Insert(key, value);
+      } else {
+        old_bucket->Insert(key, value);
+      }
+    }
+    return true;
+  }
+
+  // Merges empty buckets with their split images for as long as possible,
+  // then shrinks the directory.
+  void MergeBuckets(HashDirectoryPage *directory, uint32_t bucket_idx) {
+    while (true) {
+      uint32_t local_depth = directory->GetLocalDepth(bucket_idx);
+      if (local_depth == 0) {
+        break;
+      }
+      uint32_t image_idx = bucket_idx ^ (1U << (local_depth - 1));
+      if (directory->GetLocalDepth(image_idx) != local_depth) {
+        break;
+      }
+      page_id_t page_id = directory->GetBucketPageId(bucket_idx);
+      page_id_t image_page_id = directory->GetBucketPageId(image_idx);
+      BucketPage *bucket = Bucket(page_id);
+      BucketPage *image = Bucket(image_page_id);
+      if (!bucket->IsEmpty() && !image->IsEmpty()) {
+        break;
+      }
+
+      // Keep whichever bucket still has entries, and free the other one.
+      page_id_t keep = bucket->IsEmpty() ? image_page_id : page_id;
+      page_id_t drop = bucket->IsEmpty() ? page_id : image_page_id;
+      for (uint32_t i = 0; i < directory->Size(); ++i) {
+        page_id_t current = directory->GetBucketPageId(i);
+        if (current == keep || current == drop) {
+          directory->SetBucketPageId(i, keep);
+          directory->SetLocalDepth(i, local_depth - 1);
+        }
+      }
+      store_->DeletePage(drop);
+      bucket_idx &= (1U << (local_depth - 1)) - 1;
+    }
+
+    while (directory->CanShrink()) {
+      directory->DecrGlobalDepth();
+    }
+  }
+
+  PageStore *store_;
+  page_id_t header_page_id_{0};
+  uint32_t header_max_depth_;
+  uint32_t bucket_max_size_;
+};
+
+// This benchmark inserts `n` keys into both tables in batches, and records
+// the slowest batch. std::unordered_map's slowest batch contains a full
+// rehash, so it grows with the table size. The extendible hash index's
+// slowest batch only ever contains a few bucket splits and, at worst, the
+// doubling of one 4KB directory page.
+template <typename Table, typename InsertFn>
+void RunGrowthBenchmark(const char *name, Table &table, InsertFn insert,
+                        int n, int batch) {
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> batch_us;
+  auto start = Clock::now();
+  for (int i = 0; i < n; i += batch) {
+    auto batch_start = Clock::now();
+    for (int j = i; j < i + batch && j < n; ++j) {
+      insert(table, j);
+    }
+    batch_us.push_back(std::chrono::duration<double, std::micro>(
+                           Clock::now() - batch_start)
+                           .count());
+  }
+  double total_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  std::sort(batch_us.begin(), batch_us.end());
+  std::cout << name << ": " << n << " inserts in " << total_ms
+            << " ms, batches of " << batch << " took " << batch_us[batch_us.size() / 2]
+            << " us (median) and " << batch_us.back() << " us (slowest)\n";
+}
+
+int main() {
+  // First, let's make an index with a single directory page and tiny buckets,
+  // so that we can watch the directory grow and shrink with only a handful
+  // of keys.
+  PageStore store;
+  ExtendibleHashIndex<int32_t, int32_t> index(&store, 0, 4);
+  for (int32_t i = 0; i < 64; ++i) {
+    index.Insert(i, i * 10);
+  }
+  std::cout << "After 64 inserts, global depth is " << index.MaxGlobalDepth()
+            << " and the index uses " << store.NumPages() << " pages.\n";
+
+  if (auto value = index.Get(42)) {
+    std::cout << "Key 42 maps to " << *value << ".\n";
+  }
+
+  // Inserting a duplicate key fails, just like std::unordered_map::insert.
+  if (!index.Insert(42, 0)) {
+    std::cout << "Key 42 is already in the index.\n";
+  }
+
+  // Removing keys empties buckets, which are merged back together. Empty
+  // bucket pages go back to the store's free list.
+  for (int32_t i = 0; i < 60; ++i) {
+    index.Remove(i);
+  }
+  std::cout << "After 60 removes, global depth is " << index.MaxGlobalDepth()
+            << " and the index uses " << store.NumPages() << " pages.\n";
+
+  // Since the index is made of plain pages, we can write it to a file and
+  // open it again later. The new index finds the header page at page 0.
+  const std::string path = "extendible_hash_index.db";
+  store.WriteToFile(path);
+  PageStore reopened_store;
+  reopened_store.ReadFromFile(path);
+  ExtendibleHashIndex<int32_t, int32_t> reopened(&reopened_store, 0, 4);
+  std::cout << "After reopening, key 61 maps to " << reopened.Get(61).value_or(-1)
+            << " and key 5 is " << (reopened.Get(5) ? "present" : "absent")
+            << ".\n";
+  std::remove(path.c_str());
+
+  // Lastly, we compare how the two tables behave as they grow.
+  constexpr int n = 1000000;
+  constexpr int batch = 1000;
+  std::unordered_map<int32_t, int32_t> map;
+  RunGrowthBenchmark(
+      "std::unordered_map", map,
+      [](auto &table, int key) { table.insert({key, key}); }, n, batch);
+
+  PageStore bench_store;
+  ExtendibleHashIndex<int32_t, int32_t> bench_index(&bench_store);
+  RunGrowthBenchmark(
+      "ExtendibleHashIndex", bench_index,
+      [](auto &table, int key) { table.Insert(key, key); }, n, batch);
+
+  return 0;
+}
@@ -0,0 +1,398 @@
+/**
+ * @file hazard_pointers.cpp
+ * @brief Tutorial code for hazard pointers, a memory reclamation scheme for
+ * lock-free data structures whose memory use stays bounded even when a
+ * reader stalls.
+ */
+
+// The library is in reclaim/hazard.h, next to the epoch-based reclamation
+// (EBR) in reclaim/epoch.h that epoch_reclamation.cpp covers. This file
+// shows the API, including retiring ownership handles like Pointer<T> from
+// spring2024/s24_my_ptr.cpp, and then benchmarks:
+// - What a protected read costs with each scheme, on one thread.
+// - Throughput and the most retired objects waiting to be freed under
+//   churn, with and without a reader that stalls in the middle of a read.
+
+// Includes std::array.
+#include <array>
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::unique_ptr and std::shared_ptr.
+#include <memory>
+// Includes std::mutex and std::scoped_lock.
+#include <mutex>
+// Includes std::optional.
+#include <optional>
+// Includes std::mt19937.
+#include <random>
+// Includes std::string.
+#include <string>
+// Includes std::thread.
+#include <thread>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes EpochDomain, Participant and EpochGuard.
+#include "reclaim/epoch.h"
+// Includes HazardDomain, HazardParticipant and HazardGuard.
+#include "reclaim/hazard.h"
+
+/* ======================================================================
+   === Demo =============================================================
+   ====================================================================== */
+
+// The final version of Pointer<T> from spring2024/s24_my_ptr.cpp, which is
+// a program of its own, so we can't include it. Like there, it says when it
+// frees its object.
+template <typename T>
+class Pointer {
+ public:
+  explicit Pointer(T val) : ptr_(new T(val)) {}
+  ~Pointer() {
+    if (ptr_) {
+      std::cout << "  Freed: " << *ptr_ << "\n";
+      delete ptr_;
+    }
+  }
+  Pointer(const Pointer<T> &) = delete;
+  Pointer<T> &operator=(const Pointer<T> &) = delete;
+  Pointer(Pointer<T> &&another) noexcept : ptr_(another.ptr_) { another.ptr_ = nullptr; }
+  Pointer<T> &operator=(Pointer<T> &&another) noexcept {
+    if (ptr_ == another.ptr_) {
+      return *this;
+    }
+    delete ptr_;
+    ptr_ = another.ptr_;
+    another.ptr_ = nullptr;
+    return *this;
+  }
+  T &operator*() { return *ptr_; }
+
+ private:
+  T *ptr_;
+};
+
+void Demo() {
+  reclaim::HazardDomain domain;
+  reclaim::HazardParticipant writer = domain.Register();
+  reclaim::HazardParticipant reader = domain.Register();
+
+  // The writer owns the current object through a Pointer<int>, and
+  // publishes a raw pointer to it for readers.
+  {
+    Pointer<int> owner(1);
+    std::atomic<int *> current{&*owner};
+    {
+      reclaim::HazardGuard hazard(reader);
+      int *seen = hazard.Protect(current);
+      std::cout << "The reader protects " << *seen << ".\n";
+
+      // The writer replaces the object, and retires its old handle. Retire
+      // takes ownership, so the handle has to be moved in, like with
+      // take_ownership in s24_my_ptr.cpp.
+      Pointer<int> next(2);
+      current.store(&*next);
+      writer.Retire(std::move(owner));
+      owner = std::move(next);
+      writer.Scan();
+      std::cout << "After a scan, " << writer.Pending() << " retired object is still protected, and the reader can use "
+                << *seen << ".\n";
+    }
+    std::cout << "The reader's guard ends, and the writer scans:\n";
+    writer.Scan();
+    std::cout << "The writer's handle goes out of scope:\n";
+  }
+
+  // std::unique_ptr works too. A reader that stalls while it protects an
+  // object only holds back that object: every other retired object gets
+  // freed by the next scan.
+  std::atomic<int *> value{std::make_unique<int>(-1).release()};
+  reclaim::HazardGuard stalled(reader);
+  stalled.Protect(value);
+  for (int i = 0; i < 10000; ++i) {
+    auto next = std::make_unique<int>(i);
+    writer.Retire(std::unique_ptr<int>(value.exchange(next.release())));
+  }
+  reclaim::ReclaimStats stats = domain.Stats();
+  std::cout << "A stalled reader: " << stats.retired_ << " retired, at most " << stats.high_water_mark_
+            << " waiting at once.\n\n";
+  stalled.Reset();
+  writer.Retire(std::unique_ptr<int>(value.load()));
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+constexpr size_t SLOTS = 64;
+
+// A cache line, like a small node of a lock-free structure.
+struct Node {
+  explicit Node(uint64_t value) : value_(value) {}
+  uint64_t value_;
+  char payload_[56]{};
+};
+
+// Every scheme has a Worker, which one thread uses to read and replace the
+// table's objects.
+
+// Never frees anything, and reads without any protection. Only safe because
+// nothing is freed until the workers are done.
+class LeakScheme {
+ public:
+  LeakScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      slot.store(new Node(0));
+    }
+  }
+  ~LeakScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      delete slot.load();
+    }
+    for (Node *node : leaked_) {
+      delete node;
+    }
+  }
+  std::optional<uint64_t> HighWaterMark() const { return leaked_.size(); }
+
+  class Worker {
+   public:
+    explicit Worker(LeakScheme &scheme) : scheme_(scheme) {}
+    // The other workers may still be reading these, so only the scheme
+    // frees them, once every worker is done.
+    ~Worker() {
+      std::scoped_lock lock(scheme_.m_);
+      scheme_.leaked_.insert(scheme_.leaked_.end(), leaked_.begin(), leaked_.end());
+    }
+    uint64_t Read(size_t slot) { return scheme_.slots_[slot].load()->value_; }
+    void Write(size_t slot, uint64_t value) { leaked_.push_back(scheme_.slots_[slot].exchange(new Node(value))); }
+
+   private:
+    LeakScheme &scheme_;
+    std::vector<Node *> leaked_;
+  };
+
+ private:
+  std::array<std::atomic<Node *>, SLOTS> slots_;
+  std::mutex m_;
+  std::vector<Node *> leaked_;
+};
+
+class EpochScheme {
+ public:
+  EpochScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      slot.store(new Node(0));
+    }
+  }
+  ~EpochScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      delete slot.load();
+    }
+  }
+  reclaim::EpochDomain &Domain() { return domain_; }
+  std::optional<uint64_t> HighWaterMark() const { return domain_.Stats().high_water_mark_; }
+
+  class Worker {
+   public:
+    explicit Worker(EpochScheme &scheme) : scheme_(scheme), me_(scheme.domain_.Register()) {}
+    uint64_t Read(size_t slot) {
+      reclaim::EpochGuard guard(me_);
+      return scheme_.slots_[slot].load()->value_;
+    }
+    void Write(size_t slot, uint64_t value) { me_.Retire(scheme_.slots_[slot].exchange(new Node(value))); }
+
+   private:
+    EpochScheme &scheme_;
+    reclaim::Participant me_;
+  };
+
+ private:
+  reclaim::EpochDomain domain_;
+  std::array<std::atomic<Node *>, SLOTS> slots_;
+};
+
+class HazardScheme {
+ public:
+  HazardScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      slot.store(new Node(0));
+    }
+  }
+  ~HazardScheme() {
+    for (std::atomic<Node *> &slot : slots_) {
+      delete slot.load();
+    }
+  }
+  reclaim::HazardDomain &Domain() { return domain_; }
+  std::atomic<Node *> &Slot(size_t slot) { return slots_[slot]; }
+  std::optional<uint64_t> HighWaterMark() const { return domain_.Stats().high_water_mark_; }
+
+  class Worker {
+   public:
+    explicit Worker(HazardScheme &scheme) : scheme_(scheme), me_(scheme.domain_.Register()) {}
+    uint64_t Read(size_t slot) {
+      reclaim::HazardGuard hazard(me_);
+      return hazard.Protect(scheme_.slots_[slot])->value_;
+    }
+    void Write(size_t slot, uint64_t value) { me_.Retire(scheme_.slots_[slot].exchange(new Node(value))); }
+
+   private:
+    HazardScheme &scheme_;
+    reclaim::HazardParticipant me_;
+  };
+
+ private:
+  reclaim::HazardDomain domain_;
+  std::array<std::atomic<Node *>, SLOTS> slots_;
+};
+
+// Every read increments and decrements a reference count instead, and
+// libstdc++ implements std::atomic_load on a shared_ptr with a small table
+// of global mutexes. Nothing ever waits to be freed.
+class SharedPtrScheme {
+ public:
+  SharedPtrScheme() {
+    for (std::shared_ptr<Node> &slot : slots_) {
+      slot = std::make_shared<Node>(0);
+    }
+  }
+  std::optional<uint64_t> HighWaterMark() const { return std::nullopt; }
+
+  class Worker {
+   public:
+    explicit Worker(SharedPtrScheme &scheme) : scheme_(scheme) {}
+    uint64_t Read(size_t slot) { return std::atomic_load(&scheme_.slots_[slot])->value_; }
+    void Write(size_t slot, uint64_t value) { std::atomic_store(&scheme_.slots_[slot], std::make_shared<Node>(value)); }
+
+   private:
+    SharedPtrScheme &scheme_;
+  };
+
+ private:
+  std::array<std::shared_ptr<Node>, SLOTS> slots_;
+};
+
+// Keeps the compiler from optimizing the reads away.
+std::atomic<uint64_t> sink{0};
+
+template <typename Scheme>
+void MeasureReads(const char *name) {
+  constexpr int reads = 20000000;
+  Scheme scheme;
+  typename Scheme::Worker worker(scheme);
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reads; ++i) {
+    sum += worker.Read(i % SLOTS);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  sink += sum;
+  std::cout << "  " << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(6) << seconds / reads * 1e9 << " ns per read\n";
+}
+
+constexpr int THREADS = 4;
+constexpr int OPS_PER_THREAD = 250000;
+constexpr int WRITE_PERCENT = 10;
+
+template <typename Scheme>
+void RunChurn(const std::string &name, Scheme &scheme) {
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < THREADS; ++t) {
+    workers.emplace_back([&scheme, t] {
+      typename Scheme::Worker worker(scheme);
+      std::mt19937 gen(t);
+      uint64_t sum = 0;
+      for (int i = 0; i < OPS_PER_THREAD; ++i) {
+        size_t slot = gen() % SLOTS;
+        if (static_cast<int>(gen() % 100) < WRITE_PERCENT) {
+          worker.Write(slot, i);
+        } else {
+          sum += worker.Read(slot);
+        }
+      }
+      sink += sum;
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(6) << THREADS * OPS_PER_THREAD / seconds / 1e6 << " Mops/s, ";
+  std::optional<uint64_t> high_water_mark = scheme.HighWaterMark();
+  if (high_water_mark.has_value()) {
+    std::cout << "at most " << std::setw(6) << *high_water_mark << " retired objects waiting ("
+              << *high_water_mark * sizeof(Node) / 1024 << " KB)\n";
+  } else {
+    std::cout << "nothing waits\n";
+  }
+}
+
+void RunBenchmark() {
+  // A hazard pointer costs a store and a full fence per protected pointer,
+  // and the fence (an mfence or locked instruction on x86) drains the store
+  // buffer. An epoch
+  // guard costs about the same, but one guard covers a whole operation, so
+  // a lookup that follows many pointers, like a skip list search, pays it
+  // once with EBR and once per pointer with hazard pointers.
+  std::cout << "Reading one of " << SLOTS << " objects, on one thread:\n";
+  MeasureReads<LeakScheme>("unprotected load (unsafe)");
+  MeasureReads<EpochScheme>("EBR, a guard per read");
+  MeasureReads<HazardScheme>("hazard pointer per read");
+  MeasureReads<SharedPtrScheme>("std::shared_ptr, atomic_load");
+
+  // The stalled reader enters a guard, or protects an object, before the
+  // workers start, and leaves after they're done. EBR can't free anything
+  // retired in between, while hazard pointers only keep the one object.
+  std::cout << THREADS << " threads, " << OPS_PER_THREAD << " operations each, " << WRITE_PERCENT
+            << "% replacements, " << std::thread::hardware_concurrency() << " hardware threads:\n";
+  {
+    LeakScheme scheme;
+    RunChurn("no reclamation (leak)", scheme);
+  }
+  {
+    SharedPtrScheme scheme;
+    RunChurn("std::shared_ptr, atomic_load/store", scheme);
+  }
+  {
+    EpochScheme scheme;
+    RunChurn("EBR", scheme);
+  }
+  {
+    EpochScheme scheme;
+    reclaim::Participant stalled = scheme.Domain().Register();
+    reclaim::EpochGuard guard(stalled);
+    RunChurn("EBR, a stalled reader", scheme);
+  }
+  {
+    HazardScheme scheme;
+    RunChurn("hazard pointers", scheme);
+  }
+  {
+    HazardScheme scheme;
+    reclaim::HazardParticipant stalled = scheme.Domain().Register();
+    reclaim::HazardGuard hazard(stalled);
+    hazard.Protect(scheme.Slot(0));
+    RunChurn("hazard pointers, a stalled reader", scheme);
+  }
+}
+
+int main() {
+  Demo();
+  RunBenchmark();
+  return 0;
+}
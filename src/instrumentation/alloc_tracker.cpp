@@ -0,0 +1,190 @@
+/**
+ * @file alloc_tracker.cpp
+ * @brief Counting replacements for the global operator new and operator delete.
+ */
+
+// A program can replace the global operator new and operator delete by
+// defining its own. Every new expression, std::make_unique, std::vector
+// growth, std::string longer than its inline buffer, and so on, then goes
+// through these definitions.
+
+// The unsized operator delete isn't told how big the allocation was, so
+// every allocation gets a small header in front of it that remembers its
+// size. The header is as big as the alignment we promise (16 bytes, or the
+// requested alignment for over-aligned types), so the pointer we hand out is
+// still properly aligned.
+
+#include "alloc_tracker.h"
+
+// Includes std::fprintf.
+#include <cstdio>
+// Includes std::malloc, std::free, std::aligned_alloc.
+#include <cstdlib>
+// Includes std::bad_alloc, std::align_val_t, std::nothrow_t.
+#include <new>
+
+namespace alloc_tracker {
+
+namespace {
+
+// Zero-initialized before any code runs, so they are safe to use from
+// allocations that happen during static initialization.
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> deallocations{0};
+std::atomic<uint64_t> bytes_allocated{0};
+std::atomic<uint64_t> bytes_freed{0};
+std::atomic<uint64_t> copies{0};
+std::atomic<uint64_t> moves{0};
+
+// Prints the totals when the program exits. By then std::cerr may already
+// have been torn down, so this uses std::fprintf.
+void PrintExitSummary() {
+  // Flush what the program printed first, so the summary comes last even
+  // when stdout and stderr go to the same pipe.
+  std::fflush(stdout);
+  Stats stats = Snapshot();
+  std::fprintf(stderr,
+               "[alloc_tracker] at exit: %llu allocations (%llu bytes), %llu frees (%llu bytes), "
+               "%llu bytes still live, %llu copies, %llu moves\n",
+               static_cast<unsigned long long>(stats.allocations_),
+               static_cast<unsigned long long>(stats.bytes_allocated_),
+               static_cast<unsigned long long>(stats.deallocations_),
+               static_cast<unsigned long long>(stats.bytes_freed_),
+               static_cast<unsigned long long>(stats.bytes_allocated_ - stats.bytes_freed_),
+               static_cast<unsigned long long>(stats.copies_), static_cast<unsigned long long>(stats.moves_));
+}
+
+// Functions registered with std::atexit run in the reverse order of
+// registration, interleaved with the destructors of static objects. We
+// register before any other static object is built (see Registrar below,
+// or the first allocation, whichever comes first), so the summary runs
+// after their destructors and sees what they free.
+std::atomic<bool> summary_registered{false};
+
+void RegisterExitSummary() {
+  if (!summary_registered.exchange(true, std::memory_order_relaxed)) {
+    std::atexit(PrintExitSummary);
+  }
+}
+
+constexpr size_t DEFAULT_HEADER = 16;
+
+// Allocates size bytes aligned to align, with the size stored right before
+// the returned pointer. Returns nullptr if the system is out of memory.
+void *Allocate(size_t size, size_t align) {
+  size_t header = align < DEFAULT_HEADER ? DEFAULT_HEADER : align;
+  size_t total = header + (size == 0 ? 1 : size);
+  void *base;
+  if (align <= DEFAULT_HEADER) {
+    base = std::malloc(total);
+  } else {
+    // std::aligned_alloc wants the size to be a multiple of the alignment.
+    base = std::aligned_alloc(align, (total + align - 1) / align * align);
+  }
+  if (base == nullptr) {
+    return nullptr;
+  }
+  RegisterExitSummary();
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+  char *user = static_cast<char *>(base) + header;
+  reinterpret_cast<size_t *>(user)[-1] = size;
+  return user;
+}
+
+void Free(void *ptr, size_t align) {
+  if (ptr == nullptr) {
+    return;
+  }
+  size_t header = align < DEFAULT_HEADER ? DEFAULT_HEADER : align;
+  deallocations.fetch_add(1, std::memory_order_relaxed);
+  bytes_freed.fetch_add(reinterpret_cast<size_t *>(ptr)[-1], std::memory_order_relaxed);
+  std::free(static_cast<char *>(ptr) - header);
+}
+
+void *AllocateOrThrow(size_t size, size_t align) {
+  // Like the standard operator new, we retry as long as there is a
+  // new_handler that might be able to free some memory.
+  while (true) {
+    if (void *ptr = Allocate(size, align)) {
+      return ptr;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+// Registers the summary before the static objects of the other source
+// files are built (init_priority runs it ahead of ordinary initializers),
+// in case they don't allocate in their constructors.
+struct Registrar {
+  Registrar() { RegisterExitSummary(); }
+};
+Registrar registrar __attribute__((init_priority(101)));
+
+}  // namespace
+
+Stats Snapshot() {
+  return {allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed),
+          bytes_allocated.load(std::memory_order_relaxed), bytes_freed.load(std::memory_order_relaxed),
+          copies.load(std::memory_order_relaxed),      moves.load(std::memory_order_relaxed)};
+}
+
+void Print(const std::string &label, const Stats &stats) {
+  std::fprintf(stderr, "[alloc_tracker] %s: %llu allocations (%llu bytes), %llu frees, %llu copies, %llu moves\n",
+               label.c_str(), static_cast<unsigned long long>(stats.allocations_),
+               static_cast<unsigned long long>(stats.bytes_allocated_),
+               static_cast<unsigned long long>(stats.deallocations_), static_cast<unsigned long long>(stats.copies_),
+               static_cast<unsigned long long>(stats.moves_));
+}
+
+void CountCopy() { copies.fetch_add(1, std::memory_order_relaxed); }
+void CountMove() { moves.fetch_add(1, std::memory_order_relaxed); }
+
+}  // namespace alloc_tracker
+
+using alloc_tracker::AllocateOrThrow;
+using alloc_tracker::Free;
+
+static constexpr size_t DEFAULT_ALIGN = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void *operator new(size_t size) { return AllocateOrThrow(size, DEFAULT_ALIGN); }
+void *operator new[](size_t size) { return AllocateOrThrow(size, DEFAULT_ALIGN); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return alloc_tracker::Allocate(size, DEFAULT_ALIGN);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return alloc_tracker::Allocate(size, DEFAULT_ALIGN);
+}
+void *operator new(size_t size, std::align_val_t align) { return AllocateOrThrow(size, static_cast<size_t>(align)); }
+void *operator new[](size_t size, std::align_val_t align) {
+  return AllocateOrThrow(size, static_cast<size_t>(align));
+}
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return alloc_tracker::Allocate(size, static_cast<size_t>(align));
+}
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t &) noexcept {
+  return alloc_tracker::Allocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void *ptr) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete[](void *ptr) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete(void *ptr, size_t) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete[](void *ptr, size_t) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { Free(ptr, DEFAULT_ALIGN); }
+void operator delete(void *ptr, std::align_val_t align) noexcept { Free(ptr, static_cast<size_t>(align)); }
+void operator delete[](void *ptr, std::align_val_t align) noexcept { Free(ptr, static_cast<size_t>(align)); }
+void operator delete(void *ptr, size_t, std::align_val_t align) noexcept { Free(ptr, static_cast<size_t>(align)); }
+void operator delete[](void *ptr, size_t, std::align_val_t align) noexcept {
+  Free(ptr, static_cast<size_t>(align));
+}
+void operator delete(void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept {
+  Free(ptr, static_cast<size_t>(align));
+}
+void operator delete[](void *ptr, std::align_val_t align, const std::nothrow_t &) noexcept {
+  Free(ptr, static_cast<size_t>(align));
+}
@@ -0,0 +1,146 @@
+/**
+ * @file alloc_tracker.h
+ * @brief Opt-in instrumentation that counts heap allocations, copies and moves.
+ */
+
+// alloc_tracker.cpp replaces the global operator new and operator delete
+// with versions that count every allocation and how many bytes it asked for.
+// This header exposes those counters, plus a few tools to look at them:
+// - alloc_tracker::Scope takes a snapshot when it is created, and prints
+//   how much was allocated (and copied and moved) by the time it goes out
+//   of scope.
+// - alloc_tracker::CopyMoveCounter is a member you can add to a class to
+//   count how often objects of that class are copied and moved.
+// - alloc_tracker::TrackingAllocator<T> is an allocator for the std
+//   containers that counts the allocations of one container (or a group of
+//   containers) separately from everything else.
+
+// The counters are shared by all threads, so a Scope also sees whatever the
+// other threads allocate while it is alive.
+
+#pragma once
+
+// Includes std::atomic.
+#include <atomic>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::size_t.
+#include <cstddef>
+// Includes std::string.
+#include <string>
+// Includes std::move.
+#include <utility>
+
+namespace alloc_tracker {
+
+// A point-in-time copy of the counters. Subtracting two snapshots tells you
+// what happened in between.
+struct Stats {
+  uint64_t allocations_{0};
+  uint64_t deallocations_{0};
+  uint64_t bytes_allocated_{0};
+  uint64_t bytes_freed_{0};
+  uint64_t copies_{0};
+  uint64_t moves_{0};
+
+  Stats operator-(const Stats &before) const {
+    return {allocations_ - before.allocations_, deallocations_ - before.deallocations_,
+            bytes_allocated_ - before.bytes_allocated_, bytes_freed_ - before.bytes_freed_,
+            copies_ - before.copies_, moves_ - before.moves_};
+  }
+};
+
+// Returns the counters for the whole program so far.
+Stats Snapshot();
+
+// Prints stats on one line to stderr, prefixed by label.
+void Print(const std::string &label, const Stats &stats);
+
+// Called by CopyMoveCounter, or by hand from a copy or move constructor.
+void CountCopy();
+void CountMove();
+
+// Prints what happened between its construction and destruction, like:
+//   [alloc_tracker] copy a Person: 3 allocations (76 bytes), ...
+class Scope {
+ public:
+  explicit Scope(std::string name) : name_(std::move(name)), start_(Snapshot()) {}
+  ~Scope() { Print(name_, Delta()); }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+  // What happened since this Scope was created.
+  Stats Delta() const { return Snapshot() - start_; }
+
+ private:
+  std::string name_;
+  Stats start_;
+};
+
+// Add a CopyMoveCounter member to a class, and the class's defaulted copy
+// and move constructors (and assignments) will count themselves. A
+// hand-written constructor has to pass the counter along explicitly, for
+// example `counter_(std::move(other.counter_))` in a move constructor.
+class CopyMoveCounter {
+ public:
+  CopyMoveCounter() = default;
+  CopyMoveCounter(const CopyMoveCounter &) { CountCopy(); }
+  CopyMoveCounter(CopyMoveCounter &&) noexcept { CountMove(); }
+  CopyMoveCounter &operator=(const CopyMoveCounter &) {
+    CountCopy();
+    return *this;
+  }
+  CopyMoveCounter &operator=(CopyMoveCounter &&) noexcept {
+    CountMove();
+    return *this;
+  }
+};
+
+// Counters for the allocations made through one or more TrackingAllocators.
+struct ContainerStats {
+  std::atomic<uint64_t> allocations_{0};
+  std::atomic<uint64_t> bytes_allocated_{0};
+  std::atomic<uint64_t> bytes_freed_{0};
+};
+
+// A std::allocator that also counts into a ContainerStats. Containers that
+// share a ContainerStats are counted together. The memory still comes from
+// the global operator new, so it shows up in Snapshot() too.
+template <typename T>
+class TrackingAllocator {
+ public:
+  using value_type = T;
+
+  explicit TrackingAllocator(ContainerStats *stats) : stats_(stats) {}
+  template <typename U>
+  TrackingAllocator(const TrackingAllocator<U> &other) : stats_(other.stats_) {}  // NOLINT
+
+  T *allocate(size_t n) {
+    stats_->allocations_.fetch_add(1, std::memory_order_relaxed);
+    stats_->bytes_allocated_.fetch_add(n * sizeof(T), std::memory_order_relaxed);
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    stats_->bytes_freed_.fetch_add(n * sizeof(T), std::memory_order_relaxed);
+    ::operator delete(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const TrackingAllocator<U> &other) const {
+    return stats_ == other.stats_;
+  }
+  template <typename U>
+  bool operator!=(const TrackingAllocator<U> &other) const {
+    return stats_ != other.stats_;
+  }
+
+ private:
+  template <typename U>
+  friend class TrackingAllocator;
+
+  ContainerStats *stats_;
+};
+
+}  // namespace alloc_tracker
@@ -0,0 +1,222 @@
+/**
+ * @file lru_cache.cpp
+ * @brief Tutorial code for O(1) LRU and LRU-K caches, built from the doubly
+ * linked list in iterator.cpp and a hash index, and a sharded version of
+ * them for many threads.
+ */
+
+// The caches themselves are in cache/lru_cache.h, so that later files can
+// reuse them. This file shows how to use them, and replays a skewed trace
+// (see cache/zipfian.h) against them to compare:
+// - LRUCache, with the intrusive list and preallocated entries.
+// - The textbook version, a std::list<std::pair<K, V>> plus an
+//   std::unordered_map<K, std::list<...>::iterator>, which allocates a list
+//   node and a hash node for every insert.
+// - LRUKCache with K = 2.
+// Then it runs a ShardedCache from several threads, with 1 and 16 shards.
+
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::list.
+#include <list>
+// Includes std::optional.
+#include <optional>
+// Includes std::string.
+#include <string>
+// Includes std::thread.
+#include <thread>
+// Includes std::unordered_map.
+#include <unordered_map>
+// Includes the vector container.
+#include <vector>
+
+// Includes LRUCache, LRUKCache and ShardedCache.
+#include "cache/lru_cache.h"
+// Includes ZipfianGenerator.
+#include "cache/zipfian.h"
+
+/* ======================================================================
+   === The textbook LRU cache ===========================================
+   ====================================================================== */
+
+// The usual way to write an LRU cache with the STL. It has the same O(1)
+// operations as LRUCache, but every new key allocates a list node (in
+// emplace_front) and a hash node (in operator[]), and frees the two nodes of
+// the evicted key.
+template <typename K, typename V>
+class ListLRUCache {
+ public:
+  explicit ListLRUCache(size_t capacity) : capacity_(capacity) { index_.reserve(capacity); }
+
+  const cache::CacheStats &Stats() const { return stats_; }
+
+  std::optional<V> Get(const K &key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      stats_.misses_ += 1;
+      return std::nullopt;
+    }
+    stats_.hits_ += 1;
+    // splice moves the node to the front without reallocating it.
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  void Put(const K &key, V value) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->second = std::move(value);
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return;
+    }
+    stats_.insertions_ += 1;
+    if (lru_.size() == capacity_) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+      stats_.evictions_ += 1;
+    }
+    lru_.emplace_front(key, std::move(value));
+    index_[key] = lru_.begin();
+  }
+
+ private:
+  size_t capacity_;
+  std::list<std::pair<K, V>> lru_;
+  std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index_;
+  cache::CacheStats stats_;
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// The YCSB setup: a million keys, with theta = 0.99.
+constexpr uint64_t KEYS = 1000000;
+constexpr double THETA = 0.99;
+constexpr size_t OPS = 4000000;
+
+// A read-through cache: look the key up, and on a miss, "load" the value
+// (here, compute it) and put it in the cache.
+template <typename Cache>
+void Replay(Cache &cache, const std::vector<uint64_t> &trace, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    uint64_t key = trace[i];
+    if (!cache.Get(key).has_value()) {
+      cache.Put(key, key * 2);
+    }
+  }
+}
+
+template <typename Cache>
+void MeasureCache(const char *name, Cache &cache, const std::vector<uint64_t> &trace) {
+  auto start = std::chrono::steady_clock::now();
+  Replay(cache, trace, 0, trace.size());
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  cache::CacheStats stats = cache.Stats();
+  std::cout << "    " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(6) << stats.HitRate() * 100 << "% hits, " << std::setw(6) << trace.size() / seconds / 1e6
+            << "M ops/sec\n";
+}
+
+using ShardedLRU = cache::ShardedCache<cache::LRUCache<uint64_t, uint64_t>, uint64_t, uint64_t>;
+
+void MeasureSharded(size_t threads, size_t shards, size_t capacity, const std::vector<uint64_t> &trace) {
+  ShardedLRU sharded(shards, capacity, [](size_t shard_capacity) {
+    return std::make_unique<cache::LRUCache<uint64_t, uint64_t>>(shard_capacity);
+  });
+  // Each thread replays its own slice of the trace.
+  std::vector<std::thread> workers;
+  size_t per_thread = trace.size() / threads;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] { Replay(sharded, trace, t * per_thread, (t + 1) * per_thread); });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "    " << threads << " threads, " << std::setw(2) << shards << " shards: " << std::fixed
+            << std::setprecision(1) << std::setw(5) << sharded.Stats().HitRate() * 100 << "% hits, " << std::setw(6)
+            << per_thread * threads / seconds / 1e6 << "M ops/sec\n";
+}
+
+void RunBenchmark() {
+  // The trace is generated once up front, so that generating keys isn't
+  // part of the measurement.
+  cache::ZipfianGenerator zipfian(KEYS, THETA, 445);
+  std::vector<uint64_t> trace(OPS);
+  for (uint64_t &key : trace) {
+    key = zipfian();
+  }
+
+  std::cout << "Read-through cache over " << KEYS << " Zipfian keys (theta = " << THETA << "), " << OPS
+            << " lookups:\n";
+  for (double fraction : {0.01, 0.05, 0.10}) {
+    size_t capacity = static_cast<size_t>(fraction * KEYS);
+    std::cout << "  Capacity " << capacity << " (" << static_cast<int>(fraction * 100) << "% of the keys):\n";
+    {
+      cache::LRUCache<uint64_t, uint64_t> lru(capacity);
+      MeasureCache("LRUCache", lru, trace);
+    }
+    {
+      ListLRUCache<uint64_t, uint64_t> list_lru(capacity);
+      MeasureCache("std::list + unordered_map", list_lru, trace);
+    }
+    {
+      cache::LRUKCache<uint64_t, uint64_t> lru_2(capacity, 2);
+      MeasureCache("LRUKCache, K = 2", lru_2, trace);
+    }
+  }
+
+  // With one shard, every lookup takes the same mutex. With 16, threads
+  // only wait for each other 1 time in 16. How much that matters depends on
+  // how many cores the threads actually run on.
+  std::cout << "ShardedCache<LRUCache>, capacity " << KEYS / 20 << ":\n";
+  for (size_t threads : {1, 2, 4, 8}) {
+    for (size_t shards : {1, 16}) {
+      MeasureSharded(threads, shards, KEYS / 20, trace);
+    }
+  }
+}
+
+int main() {
+  // A cache with room for 3 courses.
+  cache::LRUCache<int, std::string> courses(3);
+  courses.Put(445, "Database Systems");
+  courses.Put(721, "Advanced Database Systems");
+  courses.Put(213, "Computer Systems");
+
+  // Using 445 makes it the most recently used key, so 721 is now the least
+  // recently used one, and it's evicted to make room for 410.
+  std::cout << "445 is " << *courses.Get(445) << "\n";
+  courses.Put(410, "Operating Systems");
+  std::cout << "721 is " << (courses.Get(721).has_value() ? "still cached" : "evicted") << "\n";
+
+  // With K = 2, a key has to be used twice before it's protected. A scan
+  // over keys that are used once only evicts other keys that were used
+  // once, so the two courses that were used twice survive it.
+  cache::LRUKCache<int, std::string> lru_2(4, 2);
+  lru_2.Put(445, "Database Systems");
+  lru_2.Put(721, "Advanced Database Systems");
+  lru_2.Get(445);
+  lru_2.Get(721);
+  for (int scanned = 0; scanned < 100; ++scanned) {
+    lru_2.Put(scanned, "scanned");
+  }
+  std::cout << "After a scan, LRU-2 still has 445: " << std::boolalpha << lru_2.Get(445).has_value()
+            << ", and 721: " << lru_2.Get(721).has_value() << "\n";
+
+  cache::CacheStats stats = courses.Stats();
+  std::cout << "courses: " << stats.hits_ << " hits, " << stats.misses_ << " misses, " << stats.evictions_
+            << " evictions\n\n";
+
+  RunBenchmark();
+
+  return 0;
+}
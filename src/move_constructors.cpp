@@ -19,6 +19,8 @@
 #include <string>
 // Includes the header for uint32_t.
 #include <cstdint>
+// Includes std::is_nothrow_move_constructible.
+#include <type_traits>
 // Includes the header for std::vector. We'll cover vectors more in
 // containers.cpp, but what suffices to know for now is that vectors are
 // essentially dynamic arrays, and the type std::vector<std::string> is an array
@@ -54,7 +56,13 @@ public:
   // significant copying cost. Generally, for numeric types, it's okay to copy
   // them, but for other types, such as strings and object types, one should
   // move the class instance unless copying is necessary.
-  Person(Person &&person)
+  // The noexcept promises that moving a Person never throws, which is true:
+  // moving a std::vector only moves its pointers, and std::cout doesn't
+  // throw unless you ask it to. Containers check for this promise. When a
+  // std::vector<Person> grows, it can only move its elements to the new
+  // buffer in one pass, and still give them back unchanged if something
+  // goes wrong, if their move constructor can't throw.
+  Person(Person &&person) noexcept
       : age_(person.age_), nicknames_(std::move(person.nicknames_)),
         valid_(true) {
     std::cout << "Calling the move constructor for class Person.\n";
@@ -62,8 +70,8 @@ public:
     person.valid_ = false;
   }
 
-  // Move assignment operator for class Person.
-  Person &operator=(Person &&other) {
+  // Move assignment operator for class Person. It can't throw either.
+  Person &operator=(Person &&other) noexcept {
     std::cout << "Calling the move assignment operator for class Person.\n";
     age_ = other.age_;
     nicknames_ = std::move(other.nicknames_);
@@ -103,6 +111,12 @@ private:
   bool valid_;
 };
 
+// A static_assert checks a condition at compile time, so if someone removes
+// the noexcept above, this file stops compiling instead of silently getting
+// slower.
+static_assert(std::is_nothrow_move_constructible_v<Person>);
+static_assert(std::is_nothrow_move_assignable_v<Person>);
+
 int main() {
   // Let's see how move constructors and move assignment operators can be
   // implemented and used in a class. First, we create an instance of the class
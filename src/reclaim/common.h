@@ -0,0 +1,64 @@
+/**
+ * @file common.h
+ * @brief What the reclamation schemes in epoch.h and hazard.h share.
+ */
+
+#pragma once
+
+// Includes std::atomic.
+#include <atomic>
+// Includes the fixed-width integer types.
+#include <cstdint>
+
+namespace reclaim {
+
+// Counts of retired and freed objects, for tuning batch sizes.
+struct ReclaimStats {
+  uint64_t retired_{0};
+  uint64_t freed_{0};
+  // The most objects that were retired but not yet freed at any one time.
+  uint64_t high_water_mark_{0};
+
+  uint64_t Pending() const { return retired_ - freed_; }
+};
+
+// The counters behind ReclaimStats, shared by every thread of a domain.
+class ReclaimCounter {
+ public:
+  void Retired(uint64_t count) {
+    retired_.fetch_add(count, std::memory_order_relaxed);
+    // A separate pending count, since retired_ - freed_ can't be read at a
+    // single instant.
+    uint64_t pending = pending_.fetch_add(count, std::memory_order_relaxed) + count;
+    uint64_t high = high_water_mark_.load(std::memory_order_relaxed);
+    while (pending > high && !high_water_mark_.compare_exchange_weak(high, pending, std::memory_order_relaxed)) {
+    }
+  }
+
+  void Freed(uint64_t count) {
+    freed_.fetch_add(count, std::memory_order_relaxed);
+    pending_.fetch_sub(count, std::memory_order_relaxed);
+  }
+
+  ReclaimStats Stats() const {
+    ReclaimStats stats;
+    stats.freed_ = freed_.load(std::memory_order_relaxed);
+    stats.retired_ = retired_.load(std::memory_order_relaxed);
+    stats.high_water_mark_ = high_water_mark_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  std::atomic<uint64_t> retired_{0};
+  std::atomic<uint64_t> freed_{0};
+  std::atomic<uint64_t> pending_{0};
+  std::atomic<uint64_t> high_water_mark_{0};
+};
+
+// Type-erased deleters, so that one retire list can hold objects of any type.
+template <typename T>
+void DeleteAs(void *ptr) {
+  delete static_cast<T *>(ptr);
+}
+
+}  // namespace reclaim
@@ -0,0 +1,311 @@
+/**
+ * @file epoch.h
+ * @brief Epoch-based memory reclamation (EBR) for lock-free data structures:
+ * EpochDomain, per-thread Participants, and the RAII EpochGuard.
+ */
+
+// In a lock-free data structure, a thread can unlink a node while another
+// thread is still reading it: the reader took no lock, so the writer can't
+// know. Deleting the node right away, like the DLL in iterator.cpp or
+// Pointer<T> in s24_my_ptr.cpp would, makes the reader use freed memory.
+// Instead, the writer "retires" the node, and a reclamation scheme deletes
+// it once no reader can still have a pointer to it.
+
+// Epoch-based reclamation (Fraser, "Practical lock-freedom", 2004) is the
+// cheapest such scheme for readers:
+// - A global epoch counter slowly moves forward.
+// - Each registered thread has a slot where it publishes the epoch it saw
+//   when it entered an operation ("pinning" that epoch), and a flag that
+//   says whether it's inside one.
+// - A retired node is tagged with the global epoch at the time. The global
+//   epoch can only advance once every thread inside an operation has seen
+//   the current epoch, so once it's two steps past the tag, every thread
+//   that could have seen the node has left, and it can be deleted.
+// A reader only writes its own slot on entry and exit, with no
+// read-modify-write instructions, which is why EBR is so cheap. The price:
+// a thread that stalls inside an operation stops the epoch, and every
+// retired node waits for it. See hazard.h for a scheme without that
+// problem.
+
+// Checking every slot to advance the epoch costs O(threads), so a thread
+// only tries every batch_size retires. Each retire is then O(1) amortized,
+// and while every thread keeps making progress, a thread holds back a few
+// batches of its own retired nodes. A bigger batch means less
+// scanning, but more memory waiting to be freed.
+
+// Usage:
+//   reclaim::EpochDomain domain;
+//   // In each thread (Participants can't be shared between threads):
+//   auto &me = domain.Local();        // or: auto me = domain.Register();
+//   {
+//     reclaim::EpochGuard guard(me);  // enter
+//     Node *node = head.load();       // safe to use until the guard ends
+//     ...
+//     me.Retire(unlinked_node);       // deleted once nobody can see it
+//   }                                 // exit
+
+#pragma once
+
+// Includes std::atomic.
+#include <atomic>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::deque.
+#include <deque>
+// Includes std::terminate.
+#include <exception>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::exchange.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes ReclaimStats, ReclaimCounter and DeleteAs.
+#include "common.h"
+
+namespace reclaim {
+
+class Participant;
+
+/* ======================================================================
+   === EpochDomain ======================================================
+   ====================================================================== */
+
+// A global epoch and the slots of the threads that use it. Structures that
+// share a domain share its epoch, so a stalled thread in one of them holds
+// back reclamation in all of them.
+class EpochDomain {
+ public:
+  explicit EpochDomain(size_t batch_size = 64, size_t max_threads = 128)
+      : batch_size_(batch_size < 1 ? 1 : batch_size), slots_(max_threads) {}
+
+  // Every Participant must be destroyed first. Frees everything that's
+  // still retired.
+  ~EpochDomain();
+
+  EpochDomain(const EpochDomain &) = delete;
+  EpochDomain &operator=(const EpochDomain &) = delete;
+
+  // Claims a slot for the calling thread. Terminates the program if every
+  // slot is taken.
+  Participant Register();
+
+  // The calling thread's Participant in this domain, registered the first
+  // time it's used, and released when the thread exits. The domain must
+  // outlive every thread that uses Local (a global domain always does).
+  Participant &Local();
+
+  // The domain that's shared by everything that doesn't need its own.
+  static EpochDomain &Global() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  ReclaimStats Stats() const { return counter_.Stats(); }
+  uint64_t Epoch() const { return global_epoch_.load(); }
+  size_t BatchSize() const { return batch_size_; }
+
+ private:
+  friend class Participant;
+
+  // A retired object, and how to delete it.
+  struct Retired {
+    void *ptr_;
+    void (*deleter_)(void *);
+    uint64_t epoch_;
+  };
+
+  // Each slot gets its own cache lines, so that threads entering and
+  // exiting don't invalidate each other's caches.
+  struct alignas(64) Slot {
+    std::atomic<bool> in_use_{false};
+    std::atomic<bool> active_{false};
+    std::atomic<uint64_t> epoch_{0};
+    // Only the owning thread uses the rest.
+    int nesting_{0};
+    size_t retires_since_collect_{0};
+    // In the order they were retired, so their epochs never decrease.
+    std::deque<Retired> retired_;
+  };
+
+  // The global epoch may only advance once every active thread has seen the
+  // current one.
+  void TryAdvance() {
+    uint64_t epoch = global_epoch_.load();
+    size_t used = slots_used_.load();
+    for (size_t i = 0; i < used; ++i) {
+      const Slot &slot = slots_[i];
+      if (slot.active_.load() && slot.epoch_.load() != epoch) {
+        return;
+      }
+    }
+    global_epoch_.compare_exchange_strong(epoch, epoch + 1);
+  }
+
+  // Frees the slot's objects that were retired at least two epochs ago.
+  void Collect(Slot &slot);
+
+  size_t batch_size_;
+  // Starts at 2, so that epoch_ + 2 <= global never underflows.
+  std::atomic<uint64_t> global_epoch_{2};
+  ReclaimCounter counter_;
+  std::vector<Slot> slots_;
+  // Slots past this one were never claimed, so TryAdvance skips them.
+  std::atomic<size_t> slots_used_{0};
+};
+
+// One thread's registration with an EpochDomain. Move-only, like
+// IntPtrManager in wrapper_class.cpp: its destructor gives the slot back.
+// Objects that the thread retired but couldn't free yet stay in the slot,
+// and are freed by the slot's next owner, or by the domain's destructor.
+class Participant {
+ public:
+  Participant() = default;
+  ~Participant() { Release(); }
+  Participant(const Participant &) = delete;
+  Participant &operator=(const Participant &) = delete;
+  Participant(Participant &&other) noexcept
+      : domain_(std::exchange(other.domain_, nullptr)), slot_(std::exchange(other.slot_, nullptr)) {}
+  Participant &operator=(Participant &&other) noexcept {
+    if (this != &other) {
+      Release();
+      domain_ = std::exchange(other.domain_, nullptr);
+      slot_ = std::exchange(other.slot_, nullptr);
+    }
+    return *this;
+  }
+
+  // Enter and Exit nest: only the outermost pair pins and unpins an epoch.
+  void Enter() {
+    if (slot_->nesting_++ == 0) {
+      // A thread that sees active_ set also sees the epoch stored before it,
+      // thanks to the release store. Both stores must also be visible before
+      // the thread reads any shared pointer. A store, even a sequentially
+      // consistent one, doesn't keep later loads from being reordered before
+      // it (the "store buffering" pattern), so that takes a full fence.
+      slot_->epoch_.store(domain_->global_epoch_.load(), std::memory_order_relaxed);
+      slot_->active_.store(true, std::memory_order_release);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    if (--slot_->nesting_ == 0) {
+      slot_->active_.store(false, std::memory_order_release);
+    }
+  }
+
+  // ptr must already be unreachable for threads that enter from now on.
+  template <typename T>
+  void Retire(T *ptr) {
+    Retire(ptr, &DeleteAs<T>);
+  }
+
+  void Retire(void *ptr, void (*deleter)(void *)) {
+    slot_->retired_.push_back({ptr, deleter, domain_->global_epoch_.load()});
+    domain_->counter_.Retired(1);
+    if (++slot_->retires_since_collect_ >= domain_->batch_size_) {
+      Collect();
+    }
+  }
+
+  // Tries to advance the epoch and frees what it can, without waiting for
+  // a full batch.
+  void Collect() {
+    slot_->retires_since_collect_ = 0;
+    domain_->TryAdvance();
+    domain_->Collect(*slot_);
+  }
+
+  // The number of objects this thread retired that aren't freed yet.
+  size_t Pending() const { return slot_->retired_.size(); }
+
+ private:
+  friend class EpochDomain;
+  Participant(EpochDomain *domain, EpochDomain::Slot *slot) : domain_(domain), slot_(slot) {}
+
+  void Release() {
+    if (slot_ != nullptr) {
+      slot_->in_use_.store(false);
+    }
+  }
+
+  EpochDomain *domain_{nullptr};
+  EpochDomain::Slot *slot_{nullptr};
+};
+
+inline EpochDomain::~EpochDomain() {
+  for (Slot &slot : slots_) {
+    for (Retired &retired : slot.retired_) {
+      retired.deleter_(retired.ptr_);
+    }
+    counter_.Freed(slot.retired_.size());
+  }
+}
+
+inline Participant EpochDomain::Register() {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    bool expected = false;
+    if (slots_[i].in_use_.compare_exchange_strong(expected, true)) {
+      size_t used = slots_used_.load();
+      while (used < i + 1 && !slots_used_.compare_exchange_weak(used, i + 1)) {
+      }
+      return Participant(this, &slots_[i]);
+    }
+  }
+  std::terminate();
+}
+
+inline Participant &EpochDomain::Local() {
+  // One entry per domain that this thread used. Threads use few domains,
+  // so a linear search is fine.
+  struct Entry {
+    EpochDomain *domain_;
+    std::unique_ptr<Participant> participant_;
+  };
+  thread_local std::vector<Entry> entries;
+  for (Entry &entry : entries) {
+    if (entry.domain_ == this) {
+      return *entry.participant_;
+    }
+  }
+  entries.push_back({this, std::make_unique<Participant>(Register())});
+  return *entries.back().participant_;
+}
+
+inline void EpochDomain::Collect(Slot &slot) {
+  // Only the oldest objects can be freed, so we stop at the first one that
+  // can't. A collect costs O(freed objects), however many are still waiting.
+  uint64_t epoch = global_epoch_.load();
+  uint64_t freed = 0;
+  while (!slot.retired_.empty() && slot.retired_.front().epoch_ + 2 <= epoch) {
+    slot.retired_.front().deleter_(slot.retired_.front().ptr_);
+    slot.retired_.pop_front();
+    ++freed;
+  }
+  counter_.Freed(freed);
+}
+
+/* ======================================================================
+   === EpochGuard =======================================================
+   ====================================================================== */
+
+// An RAII wrapper (see wrapper_class.cpp) around Enter and Exit, so that a
+// thread can never forget to leave an epoch.
+class EpochGuard {
+ public:
+  explicit EpochGuard(Participant &participant) : participant_(participant) { participant_.Enter(); }
+  // Uses the calling thread's Participant in the global domain.
+  EpochGuard() : EpochGuard(EpochDomain::Global().Local()) {}
+  ~EpochGuard() { participant_.Exit(); }
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+
+ private:
+  Participant &participant_;
+};
+
+}  // namespace reclaim
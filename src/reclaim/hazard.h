@@ -0,0 +1,375 @@
+/**
+ * @file hazard.h
+ * @brief Hazard-pointer memory reclamation for lock-free data structures:
+ * HazardDomain, per-thread HazardParticipants, and the RAII HazardGuard.
+ */
+
+// Epoch-based reclamation (epoch.h) protects everything a reader might
+// touch at once, by pinning an epoch. That makes reads cheap, but a single
+// reader that stalls inside a guard keeps every object retired after that
+// from being freed, by any thread, so memory use has no bound.
+
+// Hazard pointers (Michael, "Hazard Pointers: Safe Memory Reclamation for
+// Lock-Free Objects", 2004) protect one object at a time instead:
+// - Each registered thread owns a few hazard pointers: shared slots where
+//   it publishes the address of each object it's about to use.
+// - To protect an object, a reader loads the pointer to it, publishes it in
+//   a hazard pointer, and loads the pointer again. If it didn't change, the
+//   object was still reachable after the hazard was visible, so any thread
+//   that retires it later will see the hazard. Otherwise it tries again.
+// - A retired object goes on its thread's retire list. A scan reads every
+//   hazard pointer, and frees the retired objects that none of them point
+//   to.
+// A stalled reader can now only hold back the few objects it protects. The
+// price is on the read side: every protected pointer costs a store and a
+// full fence, where EBR pays once per operation.
+
+// With T registered threads and K hazard pointers each, there are at most
+// H = T * K protected objects. A scan of R retired objects costs
+// O((H + R) log H), so a thread only scans once its retire list has
+// scan_factor * H objects (and at least MIN_SCAN). At least
+// (scan_factor - 1) * H of them are then unprotected and get freed, so each
+// retire is O(log H) amortized, and a thread never holds more than that
+// many retired objects, whatever the other threads do.
+
+// Usage:
+//   reclaim::HazardDomain domain;
+//   // In each thread (HazardParticipants can't be shared between threads):
+//   auto &me = domain.Local();              // or: auto me = domain.Register();
+//   {
+//     reclaim::HazardGuard hazard(me);
+//     Node *node = hazard.Protect(head);    // head is a std::atomic<Node *>
+//     ...                                   // node can't be freed until the
+//   }                                       // guard ends or protects another
+//   me.Retire(unlinked_node);
+// Retire also takes ownership handles, like std::unique_ptr<T> or
+// Pointer<T> from spring2024/s24_my_ptr.cpp, and destroys the handle once
+// the object it owns is no longer protected.
+
+#pragma once
+
+// Includes std::sort and std::binary_search.
+#include <algorithm>
+// Includes std::array.
+#include <array>
+// Includes std::atomic.
+#include <atomic>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::terminate.
+#include <exception>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::is_pointer_v.
+#include <type_traits>
+// Includes std::exchange.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+// Includes ReclaimStats, ReclaimCounter and DeleteAs.
+#include "common.h"
+
+namespace reclaim {
+
+class HazardParticipant;
+
+/* ======================================================================
+   === HazardDomain =====================================================
+   ====================================================================== */
+
+// The hazard pointers of the threads that use the domain. Objects retired
+// in a domain are only checked against the domain's own hazard pointers.
+class HazardDomain {
+ public:
+  // Scanning for every few retires wastes time when there are few threads.
+  static constexpr size_t MIN_SCAN = 64;
+  static constexpr size_t MAX_HAZARDS_PER_THREAD = 64;
+
+  // A thread can hold at most hazards_per_thread guards at once, and at most
+  // MAX_HAZARDS_PER_THREAD.
+  explicit HazardDomain(size_t hazards_per_thread = 2, size_t max_threads = 128, size_t scan_factor = 2)
+      : hazards_per_thread_(std::clamp<size_t>(hazards_per_thread, 1, MAX_HAZARDS_PER_THREAD)),
+        scan_factor_(scan_factor < 2 ? 2 : scan_factor),
+        slots_(max_threads) {
+    for (Slot &slot : slots_) {
+      for (std::atomic<const void *> &hazard : slot.hazards_) {
+        hazard.store(nullptr);
+      }
+    }
+  }
+
+  // Every HazardParticipant must be destroyed first. Frees everything
+  // that's still retired.
+  ~HazardDomain();
+
+  HazardDomain(const HazardDomain &) = delete;
+  HazardDomain &operator=(const HazardDomain &) = delete;
+
+  // Claims a slot for the calling thread. Terminates the program if every
+  // slot is taken.
+  HazardParticipant Register();
+
+  // The calling thread's HazardParticipant in this domain, registered the
+  // first time it's used, and released when the thread exits. The domain
+  // must outlive every thread that uses Local (a global domain always does).
+  HazardParticipant &Local();
+
+  // The domain that's shared by everything that doesn't need its own.
+  static HazardDomain &Global() {
+    static HazardDomain domain;
+    return domain;
+  }
+
+  ReclaimStats Stats() const { return counter_.Stats(); }
+  size_t HazardsPerThread() const { return hazards_per_thread_; }
+
+ private:
+  friend class HazardParticipant;
+  friend class HazardGuard;
+
+  // A retired object, and how to delete it. address_ is what readers
+  // protect. object_ is what gets deleted, which for a handle is a heap copy
+  // of the handle rather than the object it owns.
+  struct Retired {
+    const void *address_;
+    void *object_;
+    void (*deleter_)(void *);
+  };
+
+  // Each slot gets its own cache lines, so that publishing a hazard doesn't
+  // invalidate the other threads' caches. The hazards live inline for the
+  // same reason: separate small heap blocks would share cache lines. Only
+  // the owner writes to them, and only the first hazards_per_thread_ are
+  // used.
+  struct alignas(64) Slot {
+    std::atomic<bool> in_use_{false};
+    std::array<std::atomic<const void *>, MAX_HAZARDS_PER_THREAD> hazards_;
+    // Only the owning thread uses the rest.
+    uint64_t taken_{0};
+    std::vector<Retired> retired_;
+  };
+
+  // How long the retire lists get before a scan: scan_factor times the
+  // number of hazard pointers that can be in use, and at least MIN_SCAN.
+  size_t ScanThreshold() const { return std::max(MIN_SCAN, scan_factor_ * slots_used_.load() * hazards_per_thread_); }
+
+  // Frees the slot's retired objects that no hazard pointer points to.
+  void Scan(Slot &slot);
+
+  size_t hazards_per_thread_;
+  size_t scan_factor_;
+  ReclaimCounter counter_;
+  std::vector<Slot> slots_;
+  // Slots past this one were never claimed, so scans skip them.
+  std::atomic<size_t> slots_used_{0};
+};
+
+// One thread's registration with a HazardDomain. Move-only, like
+// IntPtrManager in wrapper_class.cpp: its destructor scans one last time and
+// gives the slot back. Objects that are still protected stay in the slot,
+// and are freed by the slot's next owner, or by the domain's destructor.
+class HazardParticipant {
+ public:
+  HazardParticipant() = default;
+  ~HazardParticipant() { Release(); }
+  HazardParticipant(const HazardParticipant &) = delete;
+  HazardParticipant &operator=(const HazardParticipant &) = delete;
+  HazardParticipant(HazardParticipant &&other) noexcept
+      : domain_(std::exchange(other.domain_, nullptr)), slot_(std::exchange(other.slot_, nullptr)) {}
+  HazardParticipant &operator=(HazardParticipant &&other) noexcept {
+    if (this != &other) {
+      Release();
+      domain_ = std::exchange(other.domain_, nullptr);
+      slot_ = std::exchange(other.slot_, nullptr);
+    }
+    return *this;
+  }
+
+  // ptr must already be unreachable for threads that protect it from now on.
+  template <typename T>
+  void Retire(T *ptr) {
+    Retire(ptr, ptr, &DeleteAs<T>);
+  }
+
+  template <typename T>
+  void Retire(std::unique_ptr<T> ptr) {
+    Retire(ptr.release());
+  }
+
+  // Takes ownership of a move-only handle, like Pointer<T>, whose
+  // operator* gives the object that readers protect. The handle is moved to
+  // the heap, and destroyed once that object is no longer protected.
+  template <typename Handle, typename = std::enable_if_t<!std::is_pointer_v<Handle>>>
+  void Retire(Handle handle) {
+    const void *address = &*handle;
+    Retire(address, new Handle(std::move(handle)), &DeleteAs<Handle>);
+  }
+
+  void Retire(const void *address, void *object, void (*deleter)(void *)) {
+    slot_->retired_.push_back({address, object, deleter});
+    domain_->counter_.Retired(1);
+    if (slot_->retired_.size() >= domain_->ScanThreshold()) {
+      Scan();
+    }
+  }
+
+  // Frees what it can now, without waiting for the retire list to fill up.
+  void Scan() { domain_->Scan(*slot_); }
+
+  // The number of objects this thread retired that aren't freed yet.
+  size_t Pending() const { return slot_->retired_.size(); }
+
+ private:
+  friend class HazardDomain;
+  friend class HazardGuard;
+  HazardParticipant(HazardDomain *domain, HazardDomain::Slot *slot) : domain_(domain), slot_(slot) {}
+
+  void Release() {
+    if (slot_ != nullptr) {
+      Scan();
+      slot_->in_use_.store(false);
+    }
+  }
+
+  HazardDomain *domain_{nullptr};
+  HazardDomain::Slot *slot_{nullptr};
+};
+
+inline HazardDomain::~HazardDomain() {
+  for (Slot &slot : slots_) {
+    for (Retired &retired : slot.retired_) {
+      retired.deleter_(retired.object_);
+    }
+    counter_.Freed(slot.retired_.size());
+  }
+}
+
+inline HazardParticipant HazardDomain::Register() {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    bool expected = false;
+    if (slots_[i].in_use_.compare_exchange_strong(expected, true)) {
+      size_t used = slots_used_.load();
+      while (used < i + 1 && !slots_used_.compare_exchange_weak(used, i + 1)) {
+      }
+      return HazardParticipant(this, &slots_[i]);
+    }
+  }
+  std::terminate();
+}
+
+inline HazardParticipant &HazardDomain::Local() {
+  // One entry per domain that this thread used. Threads use few domains,
+  // so a linear search is fine.
+  struct Entry {
+    HazardDomain *domain_;
+    std::unique_ptr<HazardParticipant> participant_;
+  };
+  thread_local std::vector<Entry> entries;
+  for (Entry &entry : entries) {
+    if (entry.domain_ == this) {
+      return *entry.participant_;
+    }
+  }
+  entries.push_back({this, std::make_unique<HazardParticipant>(Register())});
+  return *entries.back().participant_;
+}
+
+inline void HazardDomain::Scan(Slot &slot) {
+  // Pairs with the fence in HazardGuard::Protect. The unlinks of the
+  // retired objects can't move past it, so either the scan sees a reader's
+  // hazard, or the reader's second load sees the unlink and tries again.
+  // Without it, a structure that unlinks with a release or acq_rel CAS
+  // could have its unlink reordered after the hazard loads below.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // Sorting the hazards makes each lookup O(log H), so a scan is
+  // O(H log H + R log H) for R retired objects, instead of O(H * R).
+  std::vector<const void *> hazards;
+  size_t used = slots_used_.load();
+  for (size_t i = 0; i < used; ++i) {
+    for (size_t j = 0; j < hazards_per_thread_; ++j) {
+      const void *address = slots_[i].hazards_[j].load();
+      if (address != nullptr) {
+        hazards.push_back(address);
+      }
+    }
+  }
+  std::sort(hazards.begin(), hazards.end());
+
+  size_t kept = 0;
+  for (Retired &retired : slot.retired_) {
+    if (std::binary_search(hazards.begin(), hazards.end(), retired.address_)) {
+      slot.retired_[kept++] = retired;
+    } else {
+      retired.deleter_(retired.object_);
+    }
+  }
+  counter_.Freed(slot.retired_.size() - kept);
+  slot.retired_.resize(kept);
+}
+
+/* ======================================================================
+   === HazardGuard ======================================================
+   ====================================================================== */
+
+// Owns one of a thread's hazard pointers, in the RAII style of
+// wrapper_class.cpp: the destructor clears it and gives it back.
+class HazardGuard {
+ public:
+  explicit HazardGuard(HazardParticipant &participant) : participant_(participant) {
+    HazardDomain::Slot &slot = *participant_.slot_;
+    for (size_t i = 0; i < participant_.domain_->hazards_per_thread_; ++i) {
+      if ((slot.taken_ & (uint64_t{1} << i)) == 0) {
+        slot.taken_ |= uint64_t{1} << i;
+        index_ = i;
+        return;
+      }
+    }
+    // More guards than hazards_per_thread.
+    std::terminate();
+  }
+  // Uses the calling thread's HazardParticipant in the global domain.
+  HazardGuard() : HazardGuard(HazardDomain::Global().Local()) {}
+  ~HazardGuard() {
+    Reset();
+    participant_.slot_->taken_ &= ~(uint64_t{1} << index_);
+  }
+  HazardGuard(const HazardGuard &) = delete;
+  HazardGuard &operator=(const HazardGuard &) = delete;
+
+  // Loads source and protects the object it points to, which stays safe to
+  // use until the guard protects something else or ends. Replaces whatever
+  // the guard protected before.
+  template <typename T>
+  T *Protect(const std::atomic<T *> &source) {
+    T *ptr = source.load();
+    while (true) {
+      // The store has to be visible before the second load, which takes a
+      // full fence: a sequentially consistent store isn't one, and a later
+      // load can still pass it. The fence does all the ordering, so the
+      // store itself can be relaxed. Pairs with the fence in
+      // HazardDomain::Scan.
+      Hazard().store(ptr, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      T *again = source.load();
+      if (again == ptr) {
+        return ptr;
+      }
+      ptr = again;
+    }
+  }
+
+  // Stops protecting anything.
+  void Reset() { Hazard().store(nullptr, std::memory_order_release); }
+
+ private:
+  std::atomic<const void *> &Hazard() { return participant_.slot_->hazards_[index_]; }
+
+  HazardParticipant &participant_;
+  size_t index_{0};
+};
+
+}  // namespace reclaim
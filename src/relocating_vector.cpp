@@ -0,0 +1,456 @@
+/**
+ * @file relocating_vector.cpp
+ * @brief Tutorial code for trivially relocatable types, and a vector that
+ * grows with memcpy (or realloc) when its elements are.
+ */
+
+// When a std::vector grows, it moves every element to a new buffer. For an
+// IntPtrManager from wrapper_class.cpp, that means: call the move
+// constructor (copy ptr_ and set the old one to nullptr), then call the
+// destructor on the old element (check ptr_ against nullptr, which it now
+// always is). That's two function calls per element that, put together,
+// copy 8 bytes.
+
+// A type is "trivially relocatable" if moving it to a new address and
+// destroying the old one is the same as copying its bytes with memcpy and
+// forgetting about the old ones. IntPtrManager and Pointer<T> are, since
+// they only hold a pointer to somewhere else. Person is too: it holds an
+// integer, a bool, and a std::vector, which in turn only holds pointers to
+// its heap buffer. std::string is NOT, at least in libstdc++: a short
+// string is stored inside the std::string object, and the object has a
+// pointer to that buffer, that is, a pointer to itself. A memcpy'd
+// std::string would still point into the old object.
+
+// The compiler can't figure this out on its own (std::is_trivially_copyable
+// is false as soon as a class has its own move constructor or destructor),
+// so classes have to opt in. Here, that's a specialization of the
+// is_trivially_relocatable trait, which is false by default. There is a
+// proposal to add this to the language itself (P2786), and libraries like
+// folly and Abseil have their own versions of it.
+
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes std::size_t, std::max_align_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::malloc, std::realloc and std::free.
+#include <cstdlib>
+// Includes std::memcpy.
+#include <cstring>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::uninitialized_move, std::destroy.
+#include <memory>
+// Includes std::bad_alloc.
+#include <new>
+// Includes std::string.
+#include <string>
+// Includes the type traits.
+#include <type_traits>
+// Includes std::move, std::forward.
+#include <utility>
+// Includes the vector container we compare against.
+#include <vector>
+
+/* ======================================================================
+   === The trait ========================================================
+   ====================================================================== */
+
+// Types that are trivially copyable (ints, Point, raw pointers) are
+// trivially relocatable for free. Everything else has to opt in.
+template <typename T>
+struct is_trivially_relocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// Moves count elements from one buffer to another, uninitialized one, and
+// ends their lifetime in the old buffer. For trivially relocatable types,
+// that's one memcpy. Otherwise it's what std::vector does when its move
+// constructor can't throw: move construct each element, then destroy the
+// old one, in one pass.
+template <typename T>
+void Relocate(T *from, size_t count, T *to) {
+  if constexpr (is_trivially_relocatable_v<T>) {
+    if (count > 0) {
+      std::memcpy(static_cast<void *>(to), static_cast<const void *>(from), count * sizeof(T));
+    }
+  } else {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "a throw would leave both buffers half relocated");
+    for (size_t i = 0; i < count; ++i) {
+      new (to + i) T(std::move(from[i]));
+      from[i].~T();
+    }
+  }
+}
+
+/* ======================================================================
+   === The classes, from the other tutorial files =======================
+   ====================================================================== */
+
+// IntPtrManager from wrapper_class.cpp, Pointer<T> from
+// spring2024/s24_my_ptr.cpp and Person from move_constructors.cpp, minus
+// the print statements.
+
+class IntPtrManager {
+ public:
+  IntPtrManager(int val) : ptr_(new int(val)) {}
+  ~IntPtrManager() {
+    if (ptr_) {
+      delete ptr_;
+    }
+  }
+  IntPtrManager(IntPtrManager &&other) noexcept : ptr_(other.ptr_) { other.ptr_ = nullptr; }
+  IntPtrManager &operator=(IntPtrManager &&other) noexcept {
+    if (ptr_ == other.ptr_) {
+      return *this;
+    }
+    if (ptr_) {
+      delete ptr_;
+    }
+    ptr_ = other.ptr_;
+    other.ptr_ = nullptr;
+    return *this;
+  }
+  IntPtrManager(const IntPtrManager &) = delete;
+  IntPtrManager &operator=(const IntPtrManager &) = delete;
+
+  int GetVal() const { return *ptr_; }
+
+ private:
+  int *ptr_;
+};
+
+template <typename T>
+class Pointer {
+ public:
+  Pointer(T val) : ptr_(new T(val)) {}
+  ~Pointer() {
+    if (ptr_) {
+      delete ptr_;
+    }
+  }
+  Pointer(Pointer<T> &&another) noexcept : ptr_(another.ptr_) { another.ptr_ = nullptr; }
+  Pointer<T> &operator=(Pointer<T> &&another) noexcept {
+    if (ptr_ == another.ptr_) {
+      return *this;
+    }
+    if (ptr_) {
+      delete ptr_;
+    }
+    ptr_ = another.ptr_;
+    another.ptr_ = nullptr;
+    return *this;
+  }
+  Pointer(const Pointer<T> &) = delete;
+  Pointer<T> &operator=(const Pointer<T> &) = delete;
+
+  T get_val() { return *ptr_; }
+
+ private:
+  T *ptr_;
+};
+
+class Person {
+ public:
+  Person(uint32_t age, std::vector<std::string> &&nicknames) : age_(age), nicknames_(std::move(nicknames)) {}
+  Person(Person &&person) noexcept : age_(person.age_), nicknames_(std::move(person.nicknames_)), valid_(true) {
+    person.valid_ = false;
+  }
+  Person &operator=(Person &&other) noexcept {
+    age_ = other.age_;
+    nicknames_ = std::move(other.nicknames_);
+    valid_ = true;
+    other.valid_ = false;
+    return *this;
+  }
+  Person(const Person &) = delete;
+  Person &operator=(const Person &) = delete;
+
+  uint32_t GetAge() const { return age_; }
+  bool IsValid() const { return valid_; }
+
+ private:
+  uint32_t age_;
+  std::vector<std::string> nicknames_;
+  bool valid_{true};
+};
+
+// The opt-ins. Person relies on std::vector being trivially relocatable,
+// which it is in libstdc++, libc++ and the MSVC STL (it's three pointers).
+template <>
+struct is_trivially_relocatable<IntPtrManager> : std::true_type {};
+template <typename T>
+struct is_trivially_relocatable<Pointer<T>> : std::true_type {};
+template <>
+struct is_trivially_relocatable<Person> : std::true_type {};
+
+static_assert(is_trivially_relocatable_v<int>);
+static_assert(is_trivially_relocatable_v<IntPtrManager>);
+static_assert(is_trivially_relocatable_v<Pointer<int>>);
+static_assert(is_trivially_relocatable_v<Person>);
+static_assert(!is_trivially_relocatable_v<std::string>, "libstdc++'s std::string points into itself");
+
+/* ======================================================================
+   === RelocatingVector =================================================
+   ====================================================================== */
+
+// A growable array like std::vector, minus most of the interface. When T
+// is trivially relocatable, growing is a single std::realloc: the C library
+// either extends the buffer in place, or copies the bytes to a new one (for
+// large buffers, it can even move whole pages without copying them, with
+// mremap on Linux). No move constructor or destructor runs. Otherwise, it
+// moves the elements one by one, like std::vector.
+template <typename T>
+class RelocatingVector {
+  // std::realloc only promises alignment for the fundamental types.
+  static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types need an aligned allocator");
+
+ public:
+  RelocatingVector() = default;
+
+  ~RelocatingVector() {
+    clear();
+    std::free(data_);
+  }
+
+  RelocatingVector(RelocatingVector &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        capacity_(std::exchange(other.capacity_, 0)) {}
+
+  RelocatingVector &operator=(RelocatingVector &&other) noexcept {
+    if (this != &other) {
+      clear();
+      std::free(data_);
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+  }
+
+  RelocatingVector(const RelocatingVector &) = delete;
+  RelocatingVector &operator=(const RelocatingVector &) = delete;
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  T *data() { return data_; }
+  T *begin() { return data_; }
+  T *end() { return data_ + size_; }
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  template <typename... Args>
+  T &emplace_back(Args &&...args) {
+    if (size_ == capacity_) {
+      // The new element is built before growing, since args may refer to
+      // one of the elements (as in v.emplace_back(std::move(v[0]))).
+      T value(std::forward<Args>(args)...);
+      Grow(capacity_ == 0 ? 1 : capacity_ * 2);
+      return *new (data_ + size_++) T(std::move(value));
+    }
+    return *new (data_ + size_++) T(std::forward<Args>(args)...);
+  }
+
+  void pop_back() {
+    size_ -= 1;
+    data_[size_].~T();
+  }
+
+  void clear() {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_) {
+      Grow(capacity);
+    }
+  }
+
+ private:
+  void Grow(size_t capacity) {
+    if constexpr (is_trivially_relocatable_v<T>) {
+      // This is the relocation that the trait opts into: realloc may move
+      // the bytes to a new block, and the objects are used there without
+      // calling any constructor. The cast tells the compiler it's meant.
+      void *grown = std::realloc(static_cast<void *>(data_), capacity * sizeof(T));
+      if (grown == nullptr) {
+        throw std::bad_alloc();
+      }
+      data_ = static_cast<T *>(grown);
+    } else {
+      T *heap = static_cast<T *>(std::malloc(capacity * sizeof(T)));
+      if (heap == nullptr) {
+        throw std::bad_alloc();
+      }
+      // Like std::vector, copy instead of move if a move might throw and
+      // the type can be copied, so a throw leaves the old elements as they
+      // were.
+      if constexpr (std::is_nothrow_move_constructible_v<T>) {
+        Relocate(data_, size_, heap);
+      } else {
+        // The uninitialized algorithms destroy what they constructed before
+        // rethrowing, so only the new block is left to free.
+        try {
+          if constexpr (std::is_copy_constructible_v<T>) {
+            std::uninitialized_copy(data_, data_ + size_, heap);
+          } else {
+            std::uninitialized_move(data_, data_ + size_, heap);
+          }
+        } catch (...) {
+          std::free(heap);
+          throw;
+        }
+        std::destroy(data_, data_ + size_);
+      }
+      std::free(data_);
+      data_ = heap;
+    }
+    capacity_ = capacity;
+  }
+
+  T *data_{nullptr};
+  size_t size_{0};
+  size_t capacity_{0};
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// A wrapper with the same layout as T that doesn't opt in, so
+// RelocatingVector<NotRelocatable<T>> takes the element-by-element path.
+// This separates what the trait buys from what realloc buys.
+template <typename T>
+class NotRelocatable : public T {
+ public:
+  using T::T;
+};
+
+template <typename T>
+T MakeElement(size_t i) {
+  if constexpr (std::is_constructible_v<T, int>) {
+    return T(static_cast<int>(i));
+  } else {
+    return T(static_cast<uint32_t>(i), {"andy", "pavlo"});
+  }
+}
+
+// Keeps the compiler from deleting the loops below as dead code.
+static volatile size_t sink = 0;
+
+template <typename Fn>
+double TimeNs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Print(const char *name, double ns_per_element) {
+  std::cout << "  " << std::left << std::setw(44) << name << std::setw(8) << ns_per_element << " ns per element\n";
+}
+
+// Relocates count elements back and forth between two buffers, so that
+// only the relocation is timed: the buffers are allocated and touched
+// before the clock starts.
+template <typename T>
+double RelocateBackAndForth(size_t count, size_t rounds) {
+  T *a = static_cast<T *>(std::malloc(count * sizeof(T)));
+  T *b = static_cast<T *>(std::malloc(count * sizeof(T)));
+  for (size_t i = 0; i < count; ++i) {
+    new (a + i) T(MakeElement<T>(i));
+  }
+  Relocate(a, count, b);
+  Relocate(b, count, a);
+  double ns = TimeNs([&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      Relocate(a, count, b);
+      Relocate(b, count, a);
+    }
+  });
+  std::destroy(a, a + count);
+  std::free(a);
+  std::free(b);
+  return ns / (2 * rounds * count);
+}
+
+// push_back count elements into an empty vector, growing it ~log2(count)
+// times. This includes building every element, which allocates.
+template <typename Vec>
+double GrowTo(size_t count) {
+  using T = std::remove_reference_t<decltype(std::declval<Vec &>()[0])>;
+  Vec vec;
+  double ns = TimeNs([&] {
+    for (size_t i = 0; i < count; ++i) {
+      vec.push_back(MakeElement<T>(i));
+    }
+  });
+  sink = sink + vec.size();
+  return ns / count;
+}
+
+template <typename T>
+void BenchmarkType(const char *type_name) {
+  for (size_t count : {size_t{1} << 10, size_t{1} << 16, size_t{1} << 22}) {
+    size_t rounds = (size_t{1} << 24) / count;
+    std::cout << type_name << ", relocate " << count << " elements:\n";
+    Print("move and destroy each element", RelocateBackAndForth<NotRelocatable<T>>(count, rounds));
+    Print("memcpy (trivially relocatable)", RelocateBackAndForth<T>(count, rounds));
+  }
+
+  constexpr size_t count = 4 << 20;
+  std::cout << type_name << ", push_back " << count << " elements:\n";
+  Print("std::vector", GrowTo<std::vector<T>>(count));
+  Print("RelocatingVector, element by element", GrowTo<RelocatingVector<NotRelocatable<T>>>(count));
+  Print("RelocatingVector, trivially relocatable", GrowTo<RelocatingVector<T>>(count));
+}
+
+// What to expect: for IntPtrManager and Pointer<int>, the compiler can see
+// that a move followed by a destroy only copies a pointer, and turns the
+// element-by-element loop into a copy loop as fast as memcpy, so the trait
+// doesn't help there (it would if the move constructor or destructor were
+// in another file). For Person, the loop has to move a std::vector and
+// then run its destructor, and the memcpy is faster. Once the buffers are
+// far bigger than the caches, both are limited by memory bandwidth. When
+// growing with push_back, building each element (which allocates) costs
+// far more than relocating it.
+void RunBenchmark() {
+  BenchmarkType<IntPtrManager>("IntPtrManager");
+  BenchmarkType<Pointer<int>>("Pointer<int>");
+  BenchmarkType<Person>("Person");
+}
+
+int main() {
+  // A RelocatingVector of Persons. Every time it grows, the Persons are
+  // moved with realloc, and no move constructor runs, so every Person
+  // stays valid and keeps its nicknames.
+  RelocatingVector<Person> people;
+  for (uint32_t age = 0; age < 100; ++age) {
+    people.emplace_back(age, std::vector<std::string>{"andy", "pavlo"});
+  }
+  bool all_valid = true;
+  for (Person &person : people) {
+    all_valid = all_valid && person.IsValid();
+  }
+  std::cout << "people has " << people.size() << " Persons, capacity " << people.capacity()
+            << ", all valid: " << all_valid << ", age of the last one: " << people[99].GetAge() << "\n";
+
+  RelocatingVector<Pointer<int>> pointers;
+  for (int i = 0; i < 1000; ++i) {
+    pointers.emplace_back(i);
+  }
+  std::cout << "pointers[999] holds " << pointers[999].get_val() << "\n\n";
+
+  RunBenchmark();
+
+  return 0;
+}
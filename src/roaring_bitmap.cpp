@@ -0,0 +1,761 @@
+/**
+ * @file roaring_bitmap.cpp
+ * @brief Tutorial code for a compressed (Roaring-style) bitmap set.
+ */
+
+// The sets in sets.cpp hold the integers 1 through 10. In a database, sets
+// of integers are usually sets of row ids, and there are millions of them,
+// often packed close together (e.g. "all rows where age > 30"). A
+// std::set<uint32_t> spends 40 bytes of heap memory on every 4 byte id. A
+// plain bitmap with one bit per possible id is tiny for dense sets, but it
+// wastes a lot of space on sparse ones: a set containing only 0 and 4
+// billion would need 512MB.
+
+// A Roaring bitmap picks the best representation for every part of the set.
+// It splits the 32 bit id space into 65536 chunks of 65536 ids each. The
+// high 16 bits of an id select the chunk, and the low 16 bits are stored in
+// one of three kinds of containers:
+//  1. An array container is a sorted array of uint16_t, used when the chunk
+//     holds at most 4096 ids. It costs 2 bytes per id.
+//  2. A bitmap container is 65536 bits (8KB), used when the chunk holds more
+//     than 4096 ids. It costs at most 2 bytes per id, and often much less.
+//  3. A run container is a sorted list of [start, start + length] ranges,
+//     used when the ids come in long consecutive runs. A chunk that is
+//     completely full costs 4 bytes.
+// Chunks with no ids don't exist at all. The cardinality of a bitmap
+// container is computed with popcount, a single instruction that counts the
+// set bits in a 64 bit word, and is cached so size() stays cheap.
+
+// For more information, see https://roaringbitmap.org/ and the paper
+// "Better bitmap performance with Roaring bitmaps" by Chambi et al.
+
+// Includes std::lower_bound and std::set_intersection etc.
+#include <algorithm>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::back_inserter.
+#include <iterator>
+// Includes std::allocator.
+#include <memory>
+// Includes std::mt19937.
+#include <random>
+// Includes the set container we compare against.
+#include <set>
+// Includes std::pair.
+#include <utility>
+// Includes std::vector.
+#include <vector>
+
+// A chunk with more ids than this is stored as a bitmap rather than an array,
+// since at that point the 8KB bitmap is smaller.
+static constexpr uint32_t ARRAY_MAX_SIZE = 4096;
+static constexpr uint32_t BITMAP_WORDS = 65536 / 64;
+
+// Counts the set bits of a 64 bit word. GCC and Clang turn this into the
+// POPCNT instruction when the target supports it.
+inline uint32_t PopCount(uint64_t word) { return __builtin_popcountll(word); }
+
+// A Container stores the low 16 bits of the ids in one chunk. Only one of the
+// three vectors is in use at a time, depending on type_.
+class Container {
+ public:
+  enum class Type { ARRAY, BITMAP, RUN };
+
+  // A run covers the ids [start_, start_ + length_]. Storing length - 1
+  // lets a single run cover all 65536 ids of a chunk.
+  struct Run {
+    uint16_t start_;
+    uint16_t length_;
+  };
+
+  Type GetType() const { return type_; }
+  uint32_t Cardinality() const { return cardinality_; }
+  bool IsEmpty() const { return cardinality_ == 0; }
+
+  size_t SizeInBytes() const {
+    return array_.capacity() * sizeof(uint16_t) + bitmap_.capacity() * sizeof(uint64_t) +
+           runs_.capacity() * sizeof(Run) + sizeof(Container);
+  }
+
+  bool Contains(uint16_t low) const {
+    switch (type_) {
+      case Type::ARRAY:
+        return std::binary_search(array_.begin(), array_.end(), low);
+      case Type::BITMAP:
+        return (bitmap_[low >> 6] >> (low & 63) & 1) != 0;
+      case Type::RUN: {
+        // Find the last run that starts at or before low.
+        auto it = std::upper_bound(runs_.begin(), runs_.end(), low,
+                                   [](uint16_t value, const Run &run) { return value < run.start_; });
+        if (it == runs_.begin()) {
+          return false;
+        }
+        --it;
+        return low <= it->start_ + it->length_;
+      }
+    }
+    return false;
+  }
+
+  bool Add(uint16_t low) {
+    if (type_ == Type::RUN) {
+      Expand();
+    }
+    if (type_ == Type::ARRAY) {
+      auto it = std::lower_bound(array_.begin(), array_.end(), low);
+      if (it != array_.end() && *it == low) {
+        return false;
+      }
+      array_.insert(it, low);
+      cardinality_ += 1;
+      Normalize();
+      return true;
+    }
+    uint64_t bit = uint64_t{1} << (low & 63);
+    if ((bitmap_[low >> 6] & bit) != 0) {
+      return false;
+    }
+    bitmap_[low >> 6] |= bit;
+    cardinality_ += 1;
+    return true;
+  }
+
+  bool Remove(uint16_t low) {
+    if (type_ == Type::RUN) {
+      Expand();
+    }
+    if (type_ == Type::ARRAY) {
+      auto it = std::lower_bound(array_.begin(), array_.end(), low);
+      if (it == array_.end() || *it != low) {
+        return false;
+      }
+      array_.erase(it);
+      cardinality_ -= 1;
+      return true;
+    }
+    uint64_t bit = uint64_t{1} << (low & 63);
+    if ((bitmap_[low >> 6] & bit) == 0) {
+      return false;
+    }
+    bitmap_[low >> 6] &= ~bit;
+    cardinality_ -= 1;
+    Normalize();
+    return true;
+  }
+
+  // The three in-place set operations. Run containers take part by first
+  // being expanded into a bitmap; RunOptimize can compress the result again.
+  void And(const Container &other) {
+    if (type_ == Type::ARRAY && other.type_ == Type::ARRAY) {
+      std::vector<uint16_t> result;
+      std::set_intersection(array_.begin(), array_.end(), other.array_.begin(), other.array_.end(),
+                            std::back_inserter(result));
+      SetArray(std::move(result));
+      return;
+    }
+    if (type_ == Type::ARRAY) {
+      // An array ANDed with anything else stays an array: we keep the ids
+      // that the other container contains.
+      std::vector<uint16_t> result;
+      for (uint16_t low : array_) {
+        if (other.Contains(low)) {
+          result.push_back(low);
+        }
+      }
+      SetArray(std::move(result));
+      return;
+    }
+    if (other.type_ == Type::ARRAY) {
+      std::vector<uint16_t> result;
+      for (uint16_t low : other.array_) {
+        if (Contains(low)) {
+          result.push_back(low);
+        }
+      }
+      SetArray(std::move(result));
+      return;
+    }
+    BitwiseWithBitmap(other, [](uint64_t a, uint64_t b) { return a & b; });
+  }
+
+  void Or(const Container &other) {
+    if (type_ == Type::ARRAY && other.type_ == Type::ARRAY &&
+        array_.size() + other.array_.size() <= ARRAY_MAX_SIZE) {
+      std::vector<uint16_t> result;
+      std::set_union(array_.begin(), array_.end(), other.array_.begin(), other.array_.end(),
+                     std::back_inserter(result));
+      SetArray(std::move(result));
+      return;
+    }
+    if (other.type_ == Type::ARRAY) {
+      ToBitmap();
+      for (uint16_t low : other.array_) {
+        bitmap_[low >> 6] |= uint64_t{1} << (low & 63);
+      }
+      RecountBitmap();
+      Normalize();
+      return;
+    }
+    BitwiseWithBitmap(other, [](uint64_t a, uint64_t b) { return a | b; });
+  }
+
+  void Xor(const Container &other) {
+    if (type_ == Type::ARRAY && other.type_ == Type::ARRAY &&
+        array_.size() + other.array_.size() <= ARRAY_MAX_SIZE) {
+      std::vector<uint16_t> result;
+      std::set_symmetric_difference(array_.begin(), array_.end(), other.array_.begin(), other.array_.end(),
+                                    std::back_inserter(result));
+      SetArray(std::move(result));
+      return;
+    }
+    if (other.type_ == Type::ARRAY) {
+      ToBitmap();
+      for (uint16_t low : other.array_) {
+        bitmap_[low >> 6] ^= uint64_t{1} << (low & 63);
+      }
+      RecountBitmap();
+      Normalize();
+      return;
+    }
+    BitwiseWithBitmap(other, [](uint64_t a, uint64_t b) { return a ^ b; });
+  }
+
+  // Converts the container to a run container if that is smaller than its
+  // current representation.
+  void RunOptimize() {
+    if (type_ == Type::RUN) {
+      return;
+    }
+    std::vector<Run> runs;
+    ForEach([&](uint16_t low) {
+      if (!runs.empty() && runs.back().start_ + runs.back().length_ + 1 == low) {
+        runs.back().length_ += 1;
+      } else {
+        runs.push_back({low, 0});
+      }
+    });
+    size_t current_bytes = type_ == Type::ARRAY ? array_.size() * sizeof(uint16_t) : BITMAP_WORDS * sizeof(uint64_t);
+    if (runs.size() * sizeof(Run) < current_bytes) {
+      type_ = Type::RUN;
+      runs_ = std::move(runs);
+      runs_.shrink_to_fit();
+      array_ = std::vector<uint16_t>();
+      bitmap_ = std::vector<uint64_t>();
+    }
+  }
+
+  // Calls fn on every id in the container, in increasing order.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    switch (type_) {
+      case Type::ARRAY:
+        for (uint16_t low : array_) {
+          fn(low);
+        }
+        break;
+      case Type::BITMAP:
+        // Instead of testing every bit, we repeatedly find the lowest set bit
+        // of a word with count-trailing-zeros and clear it.
+        for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+          uint64_t word = bitmap_[w];
+          while (word != 0) {
+            fn(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+          }
+        }
+        break;
+      case Type::RUN:
+        for (const Run &run : runs_) {
+          for (uint32_t low = run.start_; low <= uint32_t{run.start_} + run.length_; ++low) {
+            fn(static_cast<uint16_t>(low));
+          }
+        }
+        break;
+    }
+  }
+
+  // Returns the smallest id in the container that is >= from, or 65536 if
+  // there is none. The iterator is built on top of this.
+  uint32_t NextAtLeast(uint32_t from) const {
+    if (from > 0xFFFF) {
+      return 0x10000;
+    }
+    switch (type_) {
+      case Type::ARRAY: {
+        auto it = std::lower_bound(array_.begin(), array_.end(), from);
+        return it == array_.end() ? 0x10000 : *it;
+      }
+      case Type::BITMAP: {
+        uint32_t w = from >> 6;
+        uint64_t word = bitmap_[w] & (~uint64_t{0} << (from & 63));
+        while (word == 0) {
+          if (++w == BITMAP_WORDS) {
+            return 0x10000;
+          }
+          word = bitmap_[w];
+        }
+        return w * 64 + __builtin_ctzll(word);
+      }
+      case Type::RUN: {
+        // The answer is either inside the last run starting at or before
+        // from, or at the start of the run after it.
+        auto it = std::upper_bound(runs_.begin(), runs_.end(), from,
+                                   [](uint32_t value, const Run &run) { return value < run.start_; });
+        if (it != runs_.begin() && from <= uint32_t{std::prev(it)->start_} + std::prev(it)->length_) {
+          return from;
+        }
+        return it == runs_.end() ? 0x10000 : it->start_;
+      }
+    }
+    return 0x10000;
+  }
+
+ private:
+  void SetArray(std::vector<uint16_t> array) {
+    type_ = Type::ARRAY;
+    array_ = std::move(array);
+    bitmap_ = std::vector<uint64_t>();
+    runs_ = std::vector<Run>();
+    cardinality_ = array_.size();
+    Normalize();
+  }
+
+  void ToBitmap() {
+    if (type_ == Type::BITMAP) {
+      return;
+    }
+    std::vector<uint64_t> bitmap(BITMAP_WORDS, 0);
+    ForEach([&](uint16_t low) { bitmap[low >> 6] |= uint64_t{1} << (low & 63); });
+    type_ = Type::BITMAP;
+    bitmap_ = std::move(bitmap);
+    array_ = std::vector<uint16_t>();
+    runs_ = std::vector<Run>();
+  }
+
+  // Turns a run container back into an array or bitmap container, so that it
+  // can be modified one id at a time.
+  void Expand() {
+    ToBitmap();
+    Normalize();
+  }
+
+  void RecountBitmap() {
+    cardinality_ = 0;
+    for (uint64_t word : bitmap_) {
+      cardinality_ += PopCount(word);
+    }
+  }
+
+  // Applies op word by word to this container and other, both as bitmaps.
+  // The cardinality falls out of the same loop through popcount.
+  template <typename Op>
+  void BitwiseWithBitmap(const Container &other, Op op) {
+    ToBitmap();
+    if (other.type_ == Type::BITMAP) {
+      cardinality_ = 0;
+      for (uint32_t w = 0; w < BITMAP_WORDS; ++w) {
+        bitmap_[w] = op(bitmap_[w], other.bitmap_[w]);
+        cardinality_ += PopCount(bitmap_[w]);
+      }
+    } else {
+      Container expanded = other;
+      expanded.ToBitmap();
+      BitwiseWithBitmap(expanded, op);
+      return;
+    }
+    Normalize();
+  }
+
+  // Keeps every container in its cheapest non-run representation.
+  void Normalize() {
+    if (type_ == Type::ARRAY && cardinality_ > ARRAY_MAX_SIZE) {
+      ToBitmap();
+    } else if (type_ == Type::BITMAP && cardinality_ <= ARRAY_MAX_SIZE) {
+      std::vector<uint16_t> array;
+      array.reserve(cardinality_);
+      ForEach([&](uint16_t low) { array.push_back(low); });
+      type_ = Type::ARRAY;
+      array_ = std::move(array);
+      bitmap_ = std::vector<uint64_t>();
+    }
+  }
+
+  Type type_{Type::ARRAY};
+  uint32_t cardinality_{0};
+  std::vector<uint16_t> array_;
+  std::vector<uint64_t> bitmap_;
+  std::vector<Run> runs_;
+};
+
+// The RoaringBitmap keeps its containers sorted by the high 16 bits of the
+// ids they hold, so both lookups (binary search) and set operations (a
+// merge of the two key lists) are simple.
+class RoaringBitmap {
+ public:
+  // The iterator remembers the container it is in and the low 16 bits of the
+  // current id, and asks the container for the next id after it.
+  class Iterator {
+   public:
+    Iterator(const RoaringBitmap *bitmap, size_t container, uint32_t low)
+        : bitmap_(bitmap), container_(container), low_(low) {}
+
+    uint32_t operator*() const { return uint32_t{bitmap_->keys_[container_]} << 16 | low_; }
+
+    Iterator &operator++() {
+      low_ = bitmap_->containers_[container_].NextAtLeast(low_ + 1);
+      while (low_ > 0xFFFF) {
+        container_ += 1;
+        if (container_ == bitmap_->keys_.size()) {
+          low_ = 0;
+          break;
+        }
+        low_ = bitmap_->containers_[container_].NextAtLeast(0);
+      }
+      return *this;
+    }
+
+    bool operator==(const Iterator &other) const { return container_ == other.container_ && low_ == other.low_; }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+   private:
+    const RoaringBitmap *bitmap_;
+    size_t container_;
+    uint32_t low_;
+  };
+
+  Iterator begin() const {
+    if (keys_.empty()) {
+      return end();
+    }
+    return Iterator(this, 0, containers_[0].NextAtLeast(0));
+  }
+  Iterator end() const { return Iterator(this, keys_.size(), 0); }
+
+  bool insert(uint32_t id) {
+    uint16_t high = id >> 16;
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), high);
+    size_t idx = it - keys_.begin();
+    if (it == keys_.end() || *it != high) {
+      keys_.insert(it, high);
+      containers_.insert(containers_.begin() + idx, Container());
+    }
+    return containers_[idx].Add(id & 0xFFFF);
+  }
+
+  size_t erase(uint32_t id) {
+    size_t idx = FindContainer(id >> 16);
+    if (idx == keys_.size() || !containers_[idx].Remove(id & 0xFFFF)) {
+      return 0;
+    }
+    if (containers_[idx].IsEmpty()) {
+      keys_.erase(keys_.begin() + idx);
+      containers_.erase(containers_.begin() + idx);
+    }
+    return 1;
+  }
+
+  bool contains(uint32_t id) const {
+    size_t idx = FindContainer(id >> 16);
+    return idx != keys_.size() && containers_[idx].Contains(id & 0xFFFF);
+  }
+
+  size_t count(uint32_t id) const { return contains(id) ? 1 : 0; }
+
+  // The cardinality is the sum of the cached container cardinalities.
+  size_t size() const {
+    size_t total = 0;
+    for (const Container &container : containers_) {
+      total += container.Cardinality();
+    }
+    return total;
+  }
+
+  size_t SizeInBytes() const {
+    size_t total = sizeof(RoaringBitmap) + keys_.capacity() * sizeof(uint16_t);
+    for (const Container &container : containers_) {
+      total += container.SizeInBytes();
+    }
+    return total;
+  }
+
+  // Calls fn on every id, in increasing order. This is faster than using the
+  // iterator, since each container can walk its own representation.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      uint32_t high = uint32_t{keys_[i]} << 16;
+      containers_[i].ForEach([&](uint16_t low) { fn(high | low); });
+    }
+  }
+
+  void RunOptimize() {
+    for (Container &container : containers_) {
+      container.RunOptimize();
+    }
+  }
+
+  // Intersection: only chunks present in both bitmaps can survive.
+  RoaringBitmap &operator&=(const RoaringBitmap &other) {
+    size_t out = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      while (j < other.keys_.size() && other.keys_[j] < keys_[i]) {
+        j++;
+      }
+      if (j == other.keys_.size() || other.keys_[j] != keys_[i]) {
+        continue;
+      }
+      containers_[i].And(other.containers_[j]);
+      if (!containers_[i].IsEmpty()) {
+        if (out != i) {
+          keys_[out] = keys_[i];
+          containers_[out] = std::move(containers_[i]);
+        }
+        out++;
+      }
+    }
+    keys_.resize(out);
+    containers_.resize(out);
+    return *this;
+  }
+
+  RoaringBitmap &operator|=(const RoaringBitmap &other) {
+    MergeWith(other, [](Container &a, const Container &b) { a.Or(b); });
+    return *this;
+  }
+
+  RoaringBitmap &operator^=(const RoaringBitmap &other) {
+    MergeWith(other, [](Container &a, const Container &b) { a.Xor(b); });
+    return *this;
+  }
+
+ private:
+  size_t FindContainer(uint16_t high) const {
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), high);
+    return it != keys_.end() && *it == high ? it - keys_.begin() : keys_.size();
+  }
+
+  // For OR and XOR, chunks present in only one bitmap are kept as they are,
+  // and chunks present in both are combined with op.
+  template <typename Op>
+  void MergeWith(const RoaringBitmap &other, Op op) {
+    std::vector<uint16_t> keys;
+    std::vector<Container> containers;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < keys_.size() || j < other.keys_.size()) {
+      if (j == other.keys_.size() || (i < keys_.size() && keys_[i] < other.keys_[j])) {
+        keys.push_back(keys_[i]);
+        containers.push_back(std::move(containers_[i++]));
+      } else if (i == keys_.size() || other.keys_[j] < keys_[i]) {
+        keys.push_back(other.keys_[j]);
+        containers.push_back(other.containers_[j++]);
+      } else {
+        op(containers_[i], other.containers_[j]);
+        if (!containers_[i].IsEmpty()) {
+          keys.push_back(keys_[i]);
+          containers.push_back(std::move(containers_[i]));
+        }
+        i++;
+        j++;
+      }
+    }
+    keys_ = std::move(keys);
+    containers_ = std::move(containers);
+  }
+
+  std::vector<uint16_t> keys_;
+  std::vector<Container> containers_;
+};
+
+// A minimal allocator that counts the bytes std::set allocates, so we can
+// compare memory per id.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+  size_t *bytes_;
+
+  explicit CountingAllocator(size_t *bytes) : bytes_(bytes) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : bytes_(other.bytes_) {}
+
+  T *allocate(size_t n) {
+    *bytes_ += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    *bytes_ -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U> &other) const {
+    return bytes_ == other.bytes_;
+  }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U> &other) const {
+    return bytes_ != other.bytes_;
+  }
+};
+
+template <typename Fn>
+double TimeMs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Builds the same set of ids both as a std::set and as a RoaringBitmap, and
+// compares memory use and the speed of the basic operations.
+void RunBenchmark(const char *name, const std::vector<uint32_t> &ids, const std::vector<uint32_t> &other_ids) {
+  size_t set_bytes = 0;
+  using CountingSet = std::set<uint32_t, std::less<uint32_t>, CountingAllocator<uint32_t>>;
+  CountingSet std_set{CountingAllocator<uint32_t>(&set_bytes)};
+  RoaringBitmap bitmap;
+
+  double set_build = TimeMs([&] {
+    for (uint32_t id : ids) {
+      std_set.insert(id);
+    }
+  });
+  double bitmap_build = TimeMs([&] {
+    for (uint32_t id : ids) {
+      bitmap.insert(id);
+    }
+    bitmap.RunOptimize();
+  });
+
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<uint32_t> dist(0, ids.back());
+  std::vector<uint32_t> probes(1000000);
+  for (uint32_t &probe : probes) {
+    probe = dist(gen);
+  }
+  size_t hits = 0;
+  double set_find = TimeMs([&] {
+    for (uint32_t probe : probes) {
+      hits += std_set.count(probe);
+    }
+  });
+  double bitmap_find = TimeMs([&] {
+    for (uint32_t probe : probes) {
+      hits += bitmap.count(probe);
+    }
+  });
+
+  uint64_t sum = 0;
+  double set_iterate = TimeMs([&] {
+    for (uint32_t id : std_set) {
+      sum += id;
+    }
+  });
+  double bitmap_iterate = TimeMs([&] { bitmap.ForEach([&](uint32_t id) { sum += id; }); });
+
+  // For the set operations we compare against std::set_intersection and
+  // std::set_union, writing into a vector.
+  std::set<uint32_t> other_set(other_ids.begin(), other_ids.end());
+  RoaringBitmap other_bitmap;
+  for (uint32_t id : other_ids) {
+    other_bitmap.insert(id);
+  }
+  std::vector<uint32_t> result;
+  double set_and = TimeMs([&] {
+    std::set_intersection(std_set.begin(), std_set.end(), other_set.begin(), other_set.end(),
+                          std::back_inserter(result));
+  });
+  size_t and_size = result.size();
+  result.clear();
+  double set_or = TimeMs([&] {
+    std::set_union(std_set.begin(), std_set.end(), other_set.begin(), other_set.end(), std::back_inserter(result));
+  });
+  RoaringBitmap and_bitmap;
+  and_bitmap |= bitmap;
+  double bitmap_and = TimeMs([&] { and_bitmap &= other_bitmap; });
+  RoaringBitmap or_bitmap;
+  or_bitmap |= bitmap;
+  double bitmap_or = TimeMs([&] { or_bitmap |= other_bitmap; });
+  if (and_bitmap.size() != and_size || or_bitmap.size() != result.size()) {
+    std::cout << "  !! RoaringBitmap and std::set disagree\n";
+  }
+
+  std::cout << name << ": " << ids.size() << " ids (checksum " << hits + sum << ")\n";
+  std::cout << "  bytes/id: std::set " << static_cast<double>(set_bytes) / ids.size() << ", RoaringBitmap "
+            << static_cast<double>(bitmap.SizeInBytes()) / ids.size() << "\n";
+  std::cout << "  build:    std::set " << set_build << " ms, RoaringBitmap " << bitmap_build << " ms\n";
+  std::cout << "  contains: std::set " << set_find << " ms, RoaringBitmap " << bitmap_find << " ms\n";
+  std::cout << "  iterate:  std::set " << set_iterate << " ms, RoaringBitmap " << bitmap_iterate << " ms\n";
+  std::cout << "  AND:      std::set " << set_and << " ms, RoaringBitmap " << bitmap_and << " ms\n";
+  std::cout << "  OR:       std::set " << set_or << " ms, RoaringBitmap " << bitmap_or << " ms\n";
+}
+
+int main() {
+  // A RoaringBitmap can be used like the std::set<int> in sets.cpp.
+  RoaringBitmap ids;
+  for (uint32_t i = 1; i <= 10; ++i) {
+    ids.insert(i);
+  }
+  if (ids.contains(2)) {
+    std::cout << "Element 2 is in ids.\n";
+  }
+  ids.erase(4);
+  if (ids.count(4) == 0) {
+    std::cout << "Element 4 is not in ids.\n";
+  }
+  std::cout << "Printing the elements of ids with a for-each loop:\n";
+  for (uint32_t id : ids) {
+    std::cout << id << " ";
+  }
+  std::cout << "\n";
+
+  // Sets that span several chunks and container types can be combined with
+  // the in-place &=, |= and ^= operators.
+  RoaringBitmap evens;
+  RoaringBitmap range;
+  for (uint32_t i = 0; i < 200000; i += 2) {
+    evens.insert(i);
+  }
+  for (uint32_t i = 65530; i < 65546; ++i) {
+    range.insert(i);
+  }
+  range.RunOptimize();
+  RoaringBitmap both = evens;
+  both &= range;
+  std::cout << "Even ids in [65530, 65546): ";
+  for (uint32_t id : both) {
+    std::cout << id << " ";
+  }
+  std::cout << "\n";
+  RoaringBitmap either = range;
+  either ^= evens;
+  std::cout << "Ids in exactly one of the sets: " << either.size() << "\n";
+
+  // Benchmarks. The dense set holds half of the ids below 4 million, the
+  // sparse one holds 1 in every 1000 ids, and the runs set is made of long
+  // consecutive ranges, like the row ids of a table after a range delete.
+  std::mt19937 gen(15445);
+  auto make_ids = [&](uint32_t n, uint32_t universe) {
+    std::uniform_int_distribution<uint32_t> dist(0, universe - 1);
+    std::set<uint32_t> values;
+    while (values.size() < n) {
+      values.insert(dist(gen));
+    }
+    return std::vector<uint32_t>(values.begin(), values.end());
+  };
+  RunBenchmark("dense", make_ids(2000000, 4000000), make_ids(2000000, 4000000));
+  RunBenchmark("sparse", make_ids(200000, 200000000), make_ids(200000, 200000000));
+  std::vector<uint32_t> runs;
+  std::vector<uint32_t> other_runs;
+  for (uint32_t start = 0; start < 8000000; start += 10000) {
+    for (uint32_t i = start; i < start + 5000; ++i) {
+      runs.push_back(i);
+      other_runs.push_back(i + 2500);
+    }
+  }
+  RunBenchmark("runs", runs, other_runs);
+
+  return 0;
+}
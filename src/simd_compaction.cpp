@@ -0,0 +1,425 @@
+/**
+ * @file simd_compaction.cpp
+ * @brief Tutorial code for SIMD stable compaction (a vectorized remove_if).
+ */
+
+// vectors.cpp erases points with the erase-remove idiom:
+//   point_vector.erase(std::remove_if(...), point_vector.end());
+// std::remove_if looks at one element at a time, and has a branch per element
+// for "do I keep this one?". When about half of the elements are removed in
+// a random order, the CPU guesses that branch wrong half the time, and every
+// wrong guess costs around 15 cycles.
+
+// This file shows two ways to do the same job (a "stable compaction", which
+// keeps the surviving elements in their original order) without that branch.
+// 1. A scalar version that always writes the element and only advances the
+//    output position when the element is kept.
+// 2. An AVX2 version that tests 8 ints at once, turns the result into an 8
+//    bit mask, looks up a precomputed shuffle for that mask that moves the
+//    kept lanes to the front, and writes all 8 lanes out in one store.
+
+// Instead of an arbitrary lambda, the kernels take a small predicate
+// descriptor like "x == 37" or "x < 50". A lambda is a black box, but a
+// descriptor tells the kernel exactly which comparison to do, so the kernel
+// can pick the matching SIMD instruction.
+
+// Includes std::remove_if.
+#include <algorithm>
+// Includes std::array.
+#include <array>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes offsetof.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::memcpy.
+#include <cstring>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::mt19937.
+#include <random>
+// Includes std::is_trivially_copyable.
+#include <type_traits>
+// Includes the vector container.
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOOTCAMP_X86 1
+// Includes the AVX2 and BMI2 intrinsics.
+#include <immintrin.h>
+#endif
+
+// The comparisons a predicate can make between a field and a constant.
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+// A predicate descriptor: "the int32 field at byte offset `offset` of the
+// element <op> value". Elements that match are removed, just like with
+// std::remove_if. For a std::vector<int>, the offset is 0.
+struct Predicate {
+  CompareOp op;
+  int32_t value;
+  size_t offset = 0;
+};
+
+// One element at a time, the way std::remove_if would ask. The benchmark
+// checks every kernel against std::remove_if with this.
+inline bool Matches(int32_t field, const Predicate &pred) {
+  switch (pred.op) {
+    case CompareOp::EQ:
+      return field == pred.value;
+    case CompareOp::NE:
+      return field != pred.value;
+    case CompareOp::LT:
+      return field < pred.value;
+    case CompareOp::LE:
+      return field <= pred.value;
+    case CompareOp::GT:
+      return field > pred.value;
+    case CompareOp::GE:
+      return field >= pred.value;
+  }
+  return false;
+}
+
+template <typename T>
+inline int32_t FieldOf(const T &element, size_t offset) {
+  int32_t field;
+  std::memcpy(&field, reinterpret_cast<const char *>(&element) + offset, sizeof(field));
+  return field;
+}
+
+/* ======================================================================
+   === Scalar kernel ====================================================
+   ====================================================================== */
+
+// Removes every element that matches pred, keeps the rest in order, and
+// returns how many are left. Every element is copied to data[k], but k only
+// advances for kept elements, so the next element overwrites the ones we
+// drop. The switch on the comparison is outside the loop, so each loop body
+// is a single comparison with no branch on the data.
+template <typename T, typename Test>
+size_t CompactScalarWith(T *data, size_t n, size_t offset, Test test) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; ++i) {
+    T element = data[i];
+    data[k] = element;
+    k += !test(FieldOf(element, offset));
+  }
+  return k;
+}
+
+template <typename T>
+size_t CompactScalar(T *data, size_t n, const Predicate &pred) {
+  int32_t c = pred.value;
+  switch (pred.op) {
+    case CompareOp::EQ:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x == c; });
+    case CompareOp::NE:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x != c; });
+    case CompareOp::LT:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x < c; });
+    case CompareOp::LE:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x <= c; });
+    case CompareOp::GT:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x > c; });
+    case CompareOp::GE:
+      return CompactScalarWith(data, n, pred.offset, [c](int32_t x) { return x >= c; });
+  }
+  return n;
+}
+
+/* ======================================================================
+   === AVX2 kernels =====================================================
+   ====================================================================== */
+
+#ifdef BOOTCAMP_X86
+
+// SHUFFLE_32[mask] lists the lanes whose bit is set in mask first, in order,
+// so that _mm256_permutevar8x32_epi32 packs the kept int32 lanes to the
+// front. The lanes after them are don't-cares, and get overwritten by the
+// next store.
+static constexpr std::array<std::array<int32_t, 8>, 256> MakeShuffle32() {
+  std::array<std::array<int32_t, 8>, 256> table{};
+  for (int mask = 0; mask < 256; ++mask) {
+    int k = 0;
+    for (int lane = 0; lane < 8; ++lane) {
+      if ((mask >> lane) & 1) {
+        table[mask][k++] = lane;
+      }
+    }
+  }
+  return table;
+}
+
+// SHUFFLE_64[mask] is the same for four 8 byte elements, which take up two
+// int32 lanes each.
+static constexpr std::array<std::array<int32_t, 8>, 16> MakeShuffle64() {
+  std::array<std::array<int32_t, 8>, 16> table{};
+  for (int mask = 0; mask < 16; ++mask) {
+    int k = 0;
+    for (int element = 0; element < 4; ++element) {
+      if ((mask >> element) & 1) {
+        table[mask][k++] = 2 * element;
+        table[mask][k++] = 2 * element + 1;
+      }
+    }
+  }
+  return table;
+}
+
+alignas(32) static constexpr auto SHUFFLE_32 = MakeShuffle32();
+alignas(32) static constexpr auto SHUFFLE_64 = MakeShuffle64();
+
+// Returns an 8 bit mask with a 1 for every int32 lane of v that matches.
+__attribute__((target("avx2"))) inline uint32_t MatchMask(__m256i v, __m256i c, CompareOp op) {
+  __m256i match;
+  bool negate = false;
+  switch (op) {
+    case CompareOp::EQ:
+      match = _mm256_cmpeq_epi32(v, c);
+      break;
+    case CompareOp::NE:
+      match = _mm256_cmpeq_epi32(v, c);
+      negate = true;
+      break;
+    case CompareOp::LT:
+      match = _mm256_cmpgt_epi32(c, v);
+      break;
+    case CompareOp::GE:
+      match = _mm256_cmpgt_epi32(c, v);
+      negate = true;
+      break;
+    case CompareOp::GT:
+      match = _mm256_cmpgt_epi32(v, c);
+      break;
+    case CompareOp::LE:
+    default:
+      match = _mm256_cmpgt_epi32(v, c);
+      negate = true;
+      break;
+  }
+  uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+  return negate ? ~mask & 0xFF : mask;
+}
+
+// Compaction for 4 byte elements (int). Every store writes all 8 lanes at
+// data + k, but only the first popcount(keep) of them are real. Since k <= i,
+// that store never reaches past the 8 elements we have already loaded, so
+// it is safe to compact in place.
+template <typename T>
+__attribute__((target("avx2,popcnt"))) size_t CompactAVX2x32(T *data, size_t n, const Predicate &pred) {
+  static_assert(sizeof(T) == 4);
+  auto *words = reinterpret_cast<int32_t *>(data);
+  __m256i c = _mm256_set1_epi32(pred.value);
+  size_t k = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+    uint32_t keep = ~MatchMask(v, c, pred.op) & 0xFF;
+    __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i *>(SHUFFLE_32[keep].data()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(words + k), _mm256_permutevar8x32_epi32(v, shuffle));
+    k += _mm_popcnt_u32(keep);
+  }
+  // The last few elements go through the scalar kernel.
+  if (i == n) {
+    return k;
+  }
+  std::memmove(data + k, data + i, (n - i) * sizeof(T));
+  return k + CompactScalar(data + k, n - i, pred);
+}
+
+// Compaction for 8 byte elements (like Point, which is two ints). Four
+// elements fit in a register. The comparison is done on all 8 int32 lanes,
+// and then _pext_u32 picks out the lanes that hold the field we care about
+// (the even lanes for offset 0, the odd lanes for offset 4).
+template <typename T>
+__attribute__((target("avx2,bmi2,popcnt"))) size_t CompactAVX2x64(T *data, size_t n, const Predicate &pred) {
+  static_assert(sizeof(T) == 8);
+  auto *words = reinterpret_cast<int32_t *>(data);
+  __m256i c = _mm256_set1_epi32(pred.value);
+  uint32_t field_lanes = pred.offset == 0 ? 0x55 : 0xAA;
+  size_t k = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // Two registers at a time, so that the second load is already in flight
+    // while the first one is being compared.
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + 2 * i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + 2 * i + 8));
+    uint32_t keep_a = ~_pext_u32(MatchMask(a, c, pred.op), field_lanes) & 0xF;
+    uint32_t keep_b = ~_pext_u32(MatchMask(b, c, pred.op), field_lanes) & 0xF;
+    __m256i shuffle_a = _mm256_load_si256(reinterpret_cast<const __m256i *>(SHUFFLE_64[keep_a].data()));
+    __m256i shuffle_b = _mm256_load_si256(reinterpret_cast<const __m256i *>(SHUFFLE_64[keep_b].data()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(words + 2 * k), _mm256_permutevar8x32_epi32(a, shuffle_a));
+    k += _mm_popcnt_u32(keep_a);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(words + 2 * k), _mm256_permutevar8x32_epi32(b, shuffle_b));
+    k += _mm_popcnt_u32(keep_b);
+  }
+  if (i == n) {
+    return k;
+  }
+  std::memmove(data + k, data + i, (n - i) * sizeof(T));
+  return k + CompactScalar(data + k, n - i, pred);
+}
+
+#endif  // BOOTCAMP_X86
+
+static bool HasAVX2() {
+#ifdef BOOTCAMP_X86
+  static const bool has_avx2 =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+/* ======================================================================
+   === Public interface =================================================
+   ====================================================================== */
+
+// Removes every element of data[0, n) that matches pred, keeps the rest in
+// their original order, and returns the new size. Elements past the new
+// size are left in an unspecified (but valid) state, like after
+// std::remove_if.
+template <typename T>
+size_t Compact(T *data, size_t n, const Predicate &pred) {
+  static_assert(std::is_trivially_copyable_v<T>, "elements are moved around as raw bytes");
+  if (pred.offset + sizeof(int32_t) > sizeof(T)) {
+    // There's no such field. Like a predicate that never matches.
+    return n;
+  }
+#ifdef BOOTCAMP_X86
+  if (HasAVX2()) {
+    if constexpr (sizeof(T) == 4) {
+      return CompactAVX2x32(data, n, pred);
+    } else if constexpr (sizeof(T) == 8) {
+      if (pred.offset % sizeof(int32_t) == 0) {
+        return CompactAVX2x64(data, n, pred);
+      }
+    }
+  }
+#endif
+  return CompactScalar(data, n, pred);
+}
+
+// The same thing as vec.erase(std::remove_if(...), vec.end()).
+template <typename T>
+void EraseIf(std::vector<T> &vec, const Predicate &pred) {
+  size_t new_size = Compact(vec.data(), vec.size(), pred);
+  vec.erase(vec.begin() + new_size, vec.end());
+}
+
+/* ======================================================================
+   === Demo and benchmark ===============================================
+   ====================================================================== */
+
+// The Point class from vectors.cpp, without the print statements in the
+// constructors. The kernels need to know where x_ lives, which offsetof can
+// tell us from inside the class (where x_ is visible).
+class Point {
+ public:
+  Point() : x_(0), y_(0) {}
+  Point(int x, int y) : x_(x), y_(y) {}
+  inline int GetX() const { return x_; }
+  inline int GetY() const { return y_; }
+  void PrintPoint() const { std::cout << "Point value is (" << x_ << ", " << y_ << ")\n"; }
+  static size_t XOffset() { return offsetof(Point, x_); }
+  static size_t YOffset() { return offsetof(Point, y_); }
+
+ private:
+  int x_;
+  int y_;
+};
+
+template <typename Fn>
+double TimeMs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Times one compaction of a fresh copy of source, and checks the result
+// against std::remove_if.
+template <typename T, typename Fn>
+double TimeCompaction(const std::vector<T> &source, const std::vector<T> &expected, Fn compact, bool *ok) {
+  std::vector<T> copy = source;
+  double ms = TimeMs([&] { compact(copy); });
+  *ok = *ok && copy.size() == expected.size() &&
+        std::memcmp(copy.data(), expected.data(), copy.size() * sizeof(T)) == 0;
+  return ms;
+}
+
+template <typename T, typename MakeElement>
+void RunBenchmark(const char *name, size_t n, size_t field_offset, MakeElement make) {
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int> dist(0, 99);
+  std::vector<T> source;
+  source.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    source.push_back(make(dist(gen), dist(gen)));
+  }
+
+  std::cout << "Erasing " << n << " " << name << " with x < s (AVX2 " << (HasAVX2() ? "on" : "off") << "):\n";
+  for (int32_t s : {1, 5, 10, 25, 50, 75, 90, 95, 99}) {
+    Predicate pred{CompareOp::LT, s, field_offset};
+    auto matches = [&](const T &element) { return Matches(FieldOf(element, field_offset), pred); };
+
+    std::vector<T> expected = source;
+    expected.erase(std::remove_if(expected.begin(), expected.end(), matches), expected.end());
+
+    bool ok = true;
+    double remove_if_ms = TimeCompaction(
+        source, expected, [&](std::vector<T> &v) { v.erase(std::remove_if(v.begin(), v.end(), matches), v.end()); },
+        &ok);
+    double scalar_ms = TimeCompaction(
+        source, expected, [&](std::vector<T> &v) { v.erase(v.begin() + CompactScalar(v.data(), v.size(), pred), v.end()); },
+        &ok);
+    double simd_ms = TimeCompaction(source, expected, [&](std::vector<T> &v) { EraseIf(v, pred); }, &ok);
+
+    std::cout << "  " << s << "% removed: std::remove_if " << remove_if_ms << " ms, branch-free " << scalar_ms
+              << " ms, Compact " << simd_ms << " ms" << (ok ? "" : " (MISMATCH)") << "\n";
+  }
+}
+
+int main() {
+  // The same points as in vectors.cpp.
+  std::vector<Point> point_vector;
+  point_vector.emplace_back(35, 36);
+  point_vector.emplace_back(37, 38);
+  point_vector.emplace_back(39, 40);
+  point_vector.emplace_back(41, 42);
+
+  // In vectors.cpp, this was
+  //   point_vector.erase(std::remove_if(point_vector.begin(), point_vector.end(),
+  //       [](const Point &point) { return point.GetX() == 37; }), point_vector.end());
+  // With a descriptor, we spell out the comparison instead of hiding it in a
+  // lambda.
+  EraseIf(point_vector, Predicate{CompareOp::EQ, 37, Point::XOffset()});
+  std::cout << "Printing out point_vector after (37, 38) is erased:\n";
+  for (const Point &point : point_vector) {
+    point.PrintPoint();
+  }
+
+  // Any int32 field works, so we can filter on y too.
+  EraseIf(point_vector, Predicate{CompareOp::GT, 40, Point::YOffset()});
+  std::cout << "Printing out point_vector after points with y > 40 are erased:\n";
+  for (const Point &point : point_vector) {
+    point.PrintPoint();
+  }
+
+  // The int_vector from vectors.cpp, and the same erase at index 2, this
+  // time phrased as a filter.
+  std::vector<int> int_vector = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  EraseIf(int_vector, Predicate{CompareOp::GE, 6});
+  std::cout << "Printing the elements of int_vector after removing everything >= 6:\n";
+  for (int elem : int_vector) {
+    std::cout << elem << " ";
+  }
+  std::cout << "\n";
+
+  RunBenchmark<int>("ints", 10000000, 0, [](int x, int) { return x; });
+  RunBenchmark<Point>("points", 10000000, Point::XOffset(), [](int x, int y) { return Point(x, y); });
+
+  return 0;
+}
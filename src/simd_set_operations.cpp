@@ -0,0 +1,683 @@
+/**
+ * @file simd_set_operations.cpp
+ * @brief Tutorial code for SIMD set intersection, union and difference over
+ * sorted integer vectors.
+ */
+
+// sets.cpp works with a std::set<int> one element at a time, through find()
+// and count(). A query engine, on the other hand, spends a lot of its time
+// combining whole sets: intersecting the row ids that match two predicates,
+// or taking the union of two posting lists. Doing that on a std::set means
+// chasing a pointer per element. If we instead keep the integers packed in a
+// sorted std::vector, we can compare several of them at once with SIMD
+// (single instruction, multiple data) instructions.
+
+// The idea behind the SIMD intersection is simple. We load 4 (SSE4.1) or 8
+// (AVX2) integers from each input into a vector register, and compare every
+// element of the first register with every element of the second one by
+// rotating the second register and comparing lane by lane. The lanes that
+// matched are packed together with a shuffle and written out. Then we move
+// forward in whichever input has the smaller largest element, exactly like
+// the scalar merge in std::set_intersection, just a block at a time.
+
+// Not every machine has AVX2, so the program picks the best kernels at
+// runtime (runtime CPU dispatch). The SIMD kernels are compiled with
+// per-function target attributes, so the rest of the program still runs on
+// a CPU without them, and non-x86 machines (like Apple Silicon) simply use
+// the scalar kernels.
+
+// When one set is much smaller than the other, comparing blocks is wasteful,
+// since almost every block of the large set has no match. In that case we
+// use galloping search instead: for every element of the small set, we jump
+// ahead in the large set by 1, 2, 4, 8... elements and then binary search.
+
+// Includes std::lower_bound, std::set_intersection and std::sort.
+#include <algorithm>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::back_inserter.
+#include <iterator>
+// Includes std::mt19937.
+#include <random>
+// Includes the set container we compare against.
+#include <set>
+// Includes std::vector.
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOOTCAMP_X86 1
+// Includes the SSE and AVX intrinsics.
+#include <immintrin.h>
+#endif
+
+// Every kernel takes two sorted arrays of unique integers and writes the
+// result to out, returning the number of integers written. The SIMD kernels
+// always store whole vectors, so out must have room for OUTPUT_SLACK extra
+// integers past the end of the result.
+static constexpr size_t OUTPUT_SLACK = 8;
+using SetKernel = size_t (*)(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out);
+
+/* ======================================================================
+   === Scalar kernels ===================================================
+   ====================================================================== */
+
+size_t IntersectScalar(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      i++;
+    } else if (b[j] < a[i]) {
+      j++;
+    } else {
+      out[k++] = a[i];
+      i++;
+      j++;
+    }
+  }
+  return k;
+}
+
+size_t UnionScalar(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      out[k++] = a[i++];
+    } else if (b[j] < a[i]) {
+      out[k++] = b[j++];
+    } else {
+      out[k++] = a[i];
+      i++;
+      j++;
+    }
+  }
+  while (i < na) {
+    out[k++] = a[i++];
+  }
+  while (j < nb) {
+    out[k++] = b[j++];
+  }
+  return k;
+}
+
+size_t DifferenceScalar(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  while (i < na && j < nb) {
+    if (a[i] < b[j]) {
+      out[k++] = a[i++];
+    } else if (b[j] < a[i]) {
+      j++;
+    } else {
+      i++;
+      j++;
+    }
+  }
+  while (i < na) {
+    out[k++] = a[i++];
+  }
+  return k;
+}
+
+// Returns the position of the first element >= target in arr[pos, n), by
+// galloping forward from pos and then binary searching the last jump.
+size_t Gallop(const int32_t *arr, size_t pos, size_t n, int32_t target) {
+  size_t step = 1;
+  size_t low = pos;
+  size_t high = pos;
+  while (high < n && arr[high] < target) {
+    low = high + 1;
+    high = pos + step;
+    step *= 2;
+  }
+  high = std::min(high, n);
+  return std::lower_bound(arr + low, arr + high, target) - arr;
+}
+
+// Intersects a small set with a much larger one in O(small * log(large)).
+size_t IntersectGalloping(const int32_t *small, size_t n_small, const int32_t *large, size_t n_large, int32_t *out) {
+  size_t k = 0;
+  size_t pos = 0;
+  for (size_t i = 0; i < n_small && pos < n_large; ++i) {
+    pos = Gallop(large, pos, n_large, small[i]);
+    if (pos < n_large && large[pos] == small[i]) {
+      out[k++] = small[i];
+    }
+  }
+  return k;
+}
+
+// Removes the elements of a small set b from a much larger set a.
+size_t DifferenceGalloping(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out) {
+  size_t k = 0;
+  size_t pos = 0;
+  for (size_t j = 0; j < nb && pos < na; ++j) {
+    size_t next = Gallop(a, pos, na, b[j]);
+    std::copy(a + pos, a + next, out + k);
+    k += next - pos;
+    pos = next < na && a[next] == b[j] ? next + 1 : next;
+  }
+  std::copy(a + pos, a + na, out + k);
+  return k + (na - pos);
+}
+
+// Finishes a difference with the scalar algorithm, starting with a block of
+// a whose lanes in matched_mask already found a match earlier in b.
+size_t DifferenceTail(const int32_t *a, size_t na, const int32_t *b, size_t nb, int32_t *out, size_t i, size_t j,
+                      uint32_t matched_mask) {
+  size_t k = 0;
+  size_t block_start = i;
+  while (i < na) {
+    if (i - block_start < 32 && (matched_mask >> (i - block_start) & 1) != 0) {
+      i++;
+      continue;
+    }
+    while (j < nb && b[j] < a[i]) {
+      j++;
+    }
+    if (j == nb || a[i] != b[j]) {
+      out[k++] = a[i];
+    }
+    i++;
+  }
+  return k;
+}
+
+#ifdef BOOTCAMP_X86
+
+/* ======================================================================
+   === SSE4.1 kernels (4 x 32-bit lanes) ================================
+   ====================================================================== */
+
+// For every 4-bit mask of "lanes to keep", a byte shuffle that moves those
+// lanes to the front of the register. The table is built once at startup.
+struct SSEShuffleTable {
+  alignas(16) uint8_t masks_[16][16];
+  SSEShuffleTable() {
+    for (int mask = 0; mask < 16; ++mask) {
+      int out_lane = 0;
+      for (int lane = 0; lane < 4; ++lane) {
+        if ((mask >> lane & 1) != 0) {
+          for (int byte = 0; byte < 4; ++byte) {
+            masks_[mask][out_lane * 4 + byte] = lane * 4 + byte;
+          }
+          out_lane++;
+        }
+      }
+      for (int byte = out_lane * 4; byte < 16; ++byte) {
+        masks_[mask][byte] = 0x80;
+      }
+    }
+  }
+};
+static const SSEShuffleTable SSE_SHUFFLE;
+
+// Returns a 4-bit mask of the lanes of va that are equal to any lane of vb.
+__attribute__((target("sse4.1"))) static inline uint32_t MatchMaskSSE(__m128i va, __m128i vb) {
+  __m128i eq = _mm_cmpeq_epi32(va, vb);
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+  eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+  return _mm_movemask_ps(_mm_castsi128_ps(eq));
+}
+
+// Writes the lanes of v selected by mask to out, and returns how many.
+__attribute__((target("sse4.1"))) static inline size_t CompressStoreSSE(__m128i v, uint32_t mask, int32_t *out) {
+  __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i *>(SSE_SHUFFLE.masks_[mask]));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(v, shuffle));
+  return __builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.1"))) size_t IntersectSSE(const int32_t *a, size_t na, const int32_t *b, size_t nb,
+                                                      int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  size_t na4 = na & ~size_t{3};
+  size_t nb4 = nb & ~size_t{3};
+  while (i < na4 && j < nb4) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+    k += CompressStoreSSE(va, MatchMaskSSE(va, vb), out + k);
+    int32_t a_max = a[i + 3];
+    int32_t b_max = b[j + 3];
+    i += a_max <= b_max ? 4 : 0;
+    j += b_max <= a_max ? 4 : 0;
+  }
+  return k + IntersectScalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+__attribute__((target("sse4.1"))) size_t DifferenceSSE(const int32_t *a, size_t na, const int32_t *b, size_t nb,
+                                                       int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  size_t na4 = na & ~size_t{3};
+  size_t nb4 = nb & ~size_t{3};
+  // The lanes of the current block of a that matched some block of b so
+  // far. A block is only written out once we move past it.
+  uint32_t matched = 0;
+  while (i < na4 && j < nb4) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+    matched |= MatchMaskSSE(va, vb);
+    int32_t a_max = a[i + 3];
+    int32_t b_max = b[j + 3];
+    if (a_max <= b_max) {
+      k += CompressStoreSSE(va, ~matched & 0xF, out + k);
+      matched = 0;
+      i += 4;
+    }
+    if (b_max <= a_max) {
+      j += 4;
+    }
+  }
+  return k + DifferenceTail(a, na, b, nb, out + k, i, j, matched);
+}
+
+// Merges two sorted registers into the four smallest (min) and four largest
+// (max) elements, both sorted, with a small min/max sorting network.
+__attribute__((target("sse4.1"))) static inline void MergeSSE(__m128i a, __m128i b, __m128i *min, __m128i *max) {
+  __m128i tmp = _mm_min_epi32(a, b);
+  *max = _mm_max_epi32(a, b);
+  for (int round = 0; round < 3; ++round) {
+    tmp = _mm_alignr_epi8(tmp, tmp, 4);
+    __m128i lo = _mm_min_epi32(tmp, *max);
+    *max = _mm_max_epi32(tmp, *max);
+    tmp = lo;
+  }
+  *min = _mm_alignr_epi8(tmp, tmp, 4);
+}
+
+// Writes the lanes of v that differ from the lane before them (the lane
+// before lane 0 is the last lane of prev), so duplicates are dropped.
+__attribute__((target("sse4.1"))) static inline size_t StoreUniqueSSE(__m128i prev, __m128i v, int32_t *out) {
+  __m128i shifted = _mm_alignr_epi8(v, prev, 12);
+  uint32_t dup = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(shifted, v)));
+  return CompressStoreSSE(v, ~dup & 0xF, out);
+}
+
+// The SIMD union keeps a register of the four largest elements seen so far,
+// merges it with the next block from whichever input has the smaller next
+// element, and writes out the four smallest. Since the inputs are sets, the
+// only duplicates are equal neighbors, which StoreUniqueSSE removes.
+__attribute__((target("sse4.1"))) size_t UnionSSE(const int32_t *a, size_t na, const int32_t *b, size_t nb,
+                                                  int32_t *out) {
+  size_t na4 = na & ~size_t{3};
+  size_t nb4 = nb & ~size_t{3};
+  if (na4 == 0 || nb4 == 0) {
+    return UnionScalar(a, na, b, nb, out);
+  }
+  size_t i = 4;
+  size_t j = 4;
+  size_t k = 0;
+  __m128i min;
+  __m128i max;
+  MergeSSE(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a)),
+           _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)), &min, &max);
+  // Any value other than the smallest element works as the "previous" lane.
+  __m128i last = _mm_set1_epi32(_mm_cvtsi128_si32(min) ^ 1);
+  k += StoreUniqueSSE(last, min, out + k);
+  last = min;
+  while (i < na4 && j < nb4) {
+    __m128i next;
+    if (a[i] <= b[j]) {
+      next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+      i += 4;
+    } else {
+      next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+      j += 4;
+    }
+    MergeSSE(next, max, &min, &max);
+    k += StoreUniqueSSE(last, min, out + k);
+    last = min;
+  }
+
+  // The register of largest elements and the partial block of the input we
+  // ran out of are sorted together, and then merged with the rest of the
+  // other input by the scalar kernel.
+  int32_t buffer[4 + 3 + OUTPUT_SLACK];
+  size_t buffer_size = StoreUniqueSSE(last, max, buffer);
+  const int32_t *rest;
+  size_t rest_size;
+  if (i == na4) {
+    std::copy(a + i, a + na, buffer + buffer_size);
+    buffer_size += na - i;
+    rest = b + j;
+    rest_size = nb - j;
+  } else {
+    std::copy(b + j, b + nb, buffer + buffer_size);
+    buffer_size += nb - j;
+    rest = a + i;
+    rest_size = na - i;
+  }
+  // At most 7 elements, so an insertion sort. std::sort would also work,
+  // but it's unrolled for ranges of 16 and more, which GCC then warns
+  // would overrun the buffer.
+  for (size_t m = 1; m < buffer_size; ++m) {
+    int32_t value = buffer[m];
+    size_t p = m;
+    for (; p > 0 && buffer[p - 1] > value; --p) {
+      buffer[p] = buffer[p - 1];
+    }
+    buffer[p] = value;
+  }
+  buffer_size = std::unique(buffer, buffer + buffer_size) - buffer;
+  size_t tail = UnionScalar(buffer, buffer_size, rest, rest_size, out + k);
+  // The tail may start with a copy of the last element we already wrote.
+  if (k > 0 && tail > 0 && out[k] == out[k - 1]) {
+    std::copy(out + k + 1, out + k + tail, out + k);
+    tail -= 1;
+  }
+  return k + tail;
+}
+
+/* ======================================================================
+   === AVX2 kernels (8 x 32-bit lanes) ==================================
+   ====================================================================== */
+
+// For every 8-bit mask of "lanes to keep", a lane permutation that moves
+// those lanes to the front of the register.
+struct AVX2PermuteTable {
+  alignas(32) uint32_t masks_[256][8];
+  AVX2PermuteTable() {
+    for (int mask = 0; mask < 256; ++mask) {
+      int out_lane = 0;
+      for (int lane = 0; lane < 8; ++lane) {
+        if ((mask >> lane & 1) != 0) {
+          masks_[mask][out_lane++] = lane;
+        }
+      }
+      while (out_lane < 8) {
+        masks_[mask][out_lane++] = 0;
+      }
+    }
+  }
+};
+static const AVX2PermuteTable AVX2_PERMUTE;
+
+// Returns an 8-bit mask of the lanes of va that are equal to any lane of vb,
+// by comparing va against all 8 rotations of vb.
+__attribute__((target("avx2"))) static inline uint32_t MatchMaskAVX2(__m256i va, __m256i vb) {
+  const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+  __m256i eq = _mm256_cmpeq_epi32(va, vb);
+  for (int r = 1; r < 8; ++r) {
+    vb = _mm256_permutevar8x32_epi32(vb, rotate);
+    eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+  }
+  return _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+}
+
+__attribute__((target("avx2"))) static inline size_t CompressStoreAVX2(__m256i v, uint32_t mask, int32_t *out) {
+  __m256i permute = _mm256_load_si256(reinterpret_cast<const __m256i *>(AVX2_PERMUTE.masks_[mask]));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_permutevar8x32_epi32(v, permute));
+  return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2"))) size_t IntersectAVX2(const int32_t *a, size_t na, const int32_t *b, size_t nb,
+                                                     int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  size_t na8 = na & ~size_t{7};
+  size_t nb8 = nb & ~size_t{7};
+  while (i < na8 && j < nb8) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+    k += CompressStoreAVX2(va, MatchMaskAVX2(va, vb), out + k);
+    int32_t a_max = a[i + 7];
+    int32_t b_max = b[j + 7];
+    i += a_max <= b_max ? 8 : 0;
+    j += b_max <= a_max ? 8 : 0;
+  }
+  return k + IntersectScalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+__attribute__((target("avx2"))) size_t DifferenceAVX2(const int32_t *a, size_t na, const int32_t *b, size_t nb,
+                                                      int32_t *out) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t k = 0;
+  size_t na8 = na & ~size_t{7};
+  size_t nb8 = nb & ~size_t{7};
+  uint32_t matched = 0;
+  while (i < na8 && j < nb8) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+    matched |= MatchMaskAVX2(va, vb);
+    int32_t a_max = a[i + 7];
+    int32_t b_max = b[j + 7];
+    if (a_max <= b_max) {
+      k += CompressStoreAVX2(va, ~matched & 0xFF, out + k);
+      matched = 0;
+      i += 8;
+    }
+    if (b_max <= a_max) {
+      j += 8;
+    }
+  }
+  return k + DifferenceTail(a, na, b, nb, out + k, i, j, matched);
+}
+
+#endif  // BOOTCAMP_X86
+
+/* ======================================================================
+   === Runtime dispatch =================================================
+   ====================================================================== */
+
+struct SetKernels {
+  const char *name_;
+  SetKernel intersect_;
+  SetKernel union_;
+  SetKernel difference_;
+};
+
+static const SetKernels SCALAR_KERNELS{"scalar", IntersectScalar, UnionScalar, DifferenceScalar};
+
+// Returns every kernel set this CPU can run, from slowest to fastest. AVX2
+// doesn't have a faster union than the SSE4.1 merge network, so it reuses it.
+std::vector<SetKernels> SupportedKernels() {
+  std::vector<SetKernels> kernels{SCALAR_KERNELS};
+#ifdef BOOTCAMP_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.1")) {
+    kernels.push_back({"sse4.1", IntersectSSE, UnionSSE, DifferenceSSE});
+    if (__builtin_cpu_supports("avx2")) {
+      kernels.push_back({"avx2", IntersectAVX2, UnionSSE, DifferenceAVX2});
+    }
+  }
+#endif
+  return kernels;
+}
+
+// The kernels used by SortedIntSet, picked once on first use.
+const SetKernels &BestKernels() {
+  static const SetKernels best = SupportedKernels().back();
+  return best;
+}
+
+// If one input is this many times larger than the other, galloping beats a
+// linear merge.
+static constexpr size_t GALLOP_RATIO = 32;
+
+/* ======================================================================
+   === SortedIntSet =====================================================
+   ====================================================================== */
+
+// SortedIntSet is a set of int32_t stored as a sorted, duplicate-free
+// std::vector. Point operations are binary searches, and whole-set
+// operations use the fastest kernels this CPU supports.
+class SortedIntSet {
+ public:
+  SortedIntSet() = default;
+
+  // Builds a set from values in any order, possibly with duplicates.
+  explicit SortedIntSet(std::vector<int32_t> values) : values_(std::move(values)) {
+    std::sort(values_.begin(), values_.end());
+    values_.erase(std::unique(values_.begin(), values_.end()), values_.end());
+  }
+
+  bool insert(int32_t value) {
+    auto it = std::lower_bound(values_.begin(), values_.end(), value);
+    if (it != values_.end() && *it == value) {
+      return false;
+    }
+    values_.insert(it, value);
+    return true;
+  }
+
+  size_t erase(int32_t value) {
+    auto it = std::lower_bound(values_.begin(), values_.end(), value);
+    if (it == values_.end() || *it != value) {
+      return 0;
+    }
+    values_.erase(it);
+    return 1;
+  }
+
+  size_t count(int32_t value) const { return std::binary_search(values_.begin(), values_.end(), value) ? 1 : 0; }
+  size_t size() const { return values_.size(); }
+  const int32_t *data() const { return values_.data(); }
+  std::vector<int32_t>::const_iterator begin() const { return values_.begin(); }
+  std::vector<int32_t>::const_iterator end() const { return values_.end(); }
+
+  friend SortedIntSet Intersect(const SortedIntSet &a, const SortedIntSet &b) {
+    const SortedIntSet &small = a.size() <= b.size() ? a : b;
+    const SortedIntSet &large = a.size() <= b.size() ? b : a;
+    std::vector<int32_t> out(small.size() + OUTPUT_SLACK);
+    size_t n;
+    if (small.size() * GALLOP_RATIO < large.size()) {
+      n = IntersectGalloping(small.data(), small.size(), large.data(), large.size(), out.data());
+    } else {
+      n = BestKernels().intersect_(a.data(), a.size(), b.data(), b.size(), out.data());
+    }
+    return FromKernelOutput(std::move(out), n);
+  }
+
+  friend SortedIntSet Union(const SortedIntSet &a, const SortedIntSet &b) {
+    std::vector<int32_t> out(a.size() + b.size() + OUTPUT_SLACK);
+    size_t n = BestKernels().union_(a.data(), a.size(), b.data(), b.size(), out.data());
+    return FromKernelOutput(std::move(out), n);
+  }
+
+  friend SortedIntSet Difference(const SortedIntSet &a, const SortedIntSet &b) {
+    std::vector<int32_t> out(a.size() + OUTPUT_SLACK);
+    size_t n;
+    if (b.size() * GALLOP_RATIO < a.size()) {
+      n = DifferenceGalloping(a.data(), a.size(), b.data(), b.size(), out.data());
+    } else {
+      n = BestKernels().difference_(a.data(), a.size(), b.data(), b.size(), out.data());
+    }
+    return FromKernelOutput(std::move(out), n);
+  }
+
+ private:
+  // The kernel output is already sorted and unique, so we skip the
+  // constructor's sort and just trim the slack.
+  static SortedIntSet FromKernelOutput(std::vector<int32_t> out, size_t n) {
+    out.resize(n);
+    SortedIntSet result;
+    result.values_ = std::move(out);
+    return result;
+  }
+
+  std::vector<int32_t> values_;
+};
+
+void PrintSet(const char *name, const SortedIntSet &set) {
+  std::cout << name << ": ";
+  for (int32_t value : set) {
+    std::cout << value << " ";
+  }
+  std::cout << "\n";
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+template <typename Fn>
+double TimeMs(Fn fn, int reps) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    fn();
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+// Draws n distinct values from [0, universe).
+std::vector<int32_t> RandomSet(size_t n, int32_t universe, std::mt19937 &gen) {
+  std::uniform_int_distribution<int32_t> dist(0, universe - 1);
+  std::set<int32_t> values;
+  while (values.size() < n) {
+    values.insert(dist(gen));
+  }
+  return std::vector<int32_t>(values.begin(), values.end());
+}
+
+void RunBenchmark(size_t na, size_t nb, int32_t universe, std::mt19937 &gen) {
+  std::vector<int32_t> a = RandomSet(na, universe, gen);
+  std::vector<int32_t> b = RandomSet(nb, universe, gen);
+  std::set<int32_t> set_a(a.begin(), a.end());
+  std::set<int32_t> set_b(b.begin(), b.end());
+  std::vector<int32_t> out(na + nb + OUTPUT_SLACK);
+  constexpr int reps = 5;
+
+  std::cout << "|a| = " << na << ", |b| = " << nb << ", universe = " << universe << "\n";
+  size_t n = 0;
+  double std_set_ms = TimeMs(
+      [&] {
+        std::vector<int32_t> result;
+        std::set_intersection(set_a.begin(), set_a.end(), set_b.begin(), set_b.end(), std::back_inserter(result));
+        n = result.size();
+      },
+      reps);
+  std::cout << "  intersect std::set + std::set_intersection: " << std_set_ms << " ms (" << n << " results)\n";
+
+  for (const SetKernels &kernels : SupportedKernels()) {
+    double intersect_ms = TimeMs([&] { n = kernels.intersect_(a.data(), na, b.data(), nb, out.data()); }, reps);
+    double union_ms = TimeMs([&] { kernels.union_(a.data(), na, b.data(), nb, out.data()); }, reps);
+    double difference_ms = TimeMs([&] { kernels.difference_(a.data(), na, b.data(), nb, out.data()); }, reps);
+    std::cout << "  " << kernels.name_ << ": intersect " << intersect_ms << " ms, union " << union_ms
+              << " ms, difference " << difference_ms << " ms\n";
+  }
+  if (na * GALLOP_RATIO < nb) {
+    double gallop_ms = TimeMs([&] { IntersectGalloping(a.data(), na, b.data(), nb, out.data()); }, reps);
+    std::cout << "  galloping: intersect " << gallop_ms << " ms\n";
+  }
+}
+
+int main() {
+  // A SortedIntSet supports the same point operations as the set in
+  // sets.cpp...
+  SortedIntSet evens;
+  for (int32_t i = 0; i <= 20; i += 2) {
+    evens.insert(i);
+  }
+  SortedIntSet threes(std::vector<int32_t>{21, 3, 9, 0, 6, 18, 12, 15, 3});
+  if (evens.count(4) == 1 && threes.count(4) == 0) {
+    std::cout << "4 is in evens but not in threes.\n";
+  }
+
+  // ...but its real strength is combining whole sets at once.
+  std::cout << "Using the " << BestKernels().name_ << " kernels.\n";
+  PrintSet("evens", evens);
+  PrintSet("threes", threes);
+  PrintSet("evens & threes", Intersect(evens, threes));
+  PrintSet("evens | threes", Union(evens, threes));
+  PrintSet("evens - threes", Difference(evens, threes));
+
+  std::mt19937 gen(15445);
+  RunBenchmark(1000000, 1000000, 4000000, gen);
+  RunBenchmark(1000, 1000000, 4000000, gen);
+
+  return 0;
+}
@@ -0,0 +1,415 @@
+/**
+ * @file small_vector.cpp
+ * @brief Tutorial code for a vector with inline storage (a "small vector").
+ */
+
+// Most of the vectors in this repository are tiny. The int_vector in
+// vectors.cpp holds a handful of ints, and a Person in move_constructors.cpp
+// has two nicknames. Still, every std::vector that holds even one element
+// asks the heap for memory, and gives it back when the vector is destroyed.
+// Heap allocations are not free: a call to operator new costs tens of
+// nanoseconds, and the memory it returns is somewhere else in memory, which
+// usually means another cache miss.
+
+// SmallVector<T, N> keeps room for N elements inside the object itself
+// ("inline storage"). As long as the vector has at most N elements, it never
+// touches the heap. Past N, it "spills" to a heap buffer, just like a
+// std::vector. This is the same idea as LLVM's SmallVector and the "small
+// string optimization" that std::string already does for short strings.
+
+// The trade-off shows up with moves. Moving a std::vector only steals its
+// pointer. Moving a SmallVector whose elements are inline has to move the
+// elements one by one, since they live inside the object being moved from.
+// For small N, that is still much cheaper than an allocation.
+
+// Includes std::move, std::copy.
+#include <algorithm>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::malloc and std::free.
+#include <cstdlib>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::initializer_list.
+#include <initializer_list>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::uninitialized_move, std::destroy.
+#include <memory>
+// Includes operator new and std::bad_alloc.
+#include <new>
+// Includes std::string.
+#include <string>
+// Includes std::is_nothrow_move_constructible.
+#include <type_traits>
+// Includes std::move, std::forward.
+#include <utility>
+// Includes the vector container we compare against.
+#include <vector>
+
+template <typename T, size_t N>
+class SmallVector {
+  static_assert(N > 0, "use std::vector if you don't want inline storage");
+
+ public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  SmallVector() = default;
+
+  // No destructor runs for a constructor that throws, so if a copy throws,
+  // the constructors clean up the copies and the heap buffer themselves.
+  SmallVector(std::initializer_list<T> init) {
+    reserve(init.size());
+    try {
+      for (const T &value : init) {
+        new (data_ + size_) T(value);
+        size_ += 1;
+      }
+    } catch (...) {
+      clear();
+      FreeHeap();
+      throw;
+    }
+  }
+
+  ~SmallVector() {
+    clear();
+    FreeHeap();
+  }
+
+  SmallVector(const SmallVector &other) {
+    reserve(other.size_);
+    try {
+      std::uninitialized_copy(other.begin(), other.end(), data_);
+    } catch (...) {
+      FreeHeap();
+      throw;
+    }
+    size_ = other.size_;
+  }
+
+  SmallVector &operator=(const SmallVector &other) {
+    if (this != &other) {
+      clear();
+      reserve(other.size_);
+      std::uninitialized_copy(other.begin(), other.end(), data_);
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  // If other is on the heap, we steal its buffer, just like std::vector.
+  // Otherwise its elements live inside other, so we have to move them over
+  // one at a time.
+  SmallVector(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) { TakeFrom(other); }
+
+  SmallVector &operator=(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      FreeHeap();
+      TakeFrom(other);
+    }
+    return *this;
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns true while the elements still live in the inline storage.
+  bool IsInline() const { return data_ == InlineData(); }
+
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+  T &front() { return data_[0]; }
+  T &back() { return data_[size_ - 1]; }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  template <typename... Args>
+  T &emplace_back(Args &&...args) {
+    if (size_ == capacity_) {
+      return GrowAndEmplaceBack(std::forward<Args>(args)...);
+    }
+    T *slot = new (data_ + size_) T(std::forward<Args>(args)...);
+    size_ += 1;
+    return *slot;
+  }
+
+  void pop_back() {
+    size_ -= 1;
+    data_[size_].~T();
+  }
+
+  // Erases the element at pos by moving everything after it one slot to the
+  // left, and returns an iterator to the element that took its place.
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    iterator to = data_ + (first - data_);
+    iterator from = data_ + (last - data_);
+    if (from == to) {
+      // Nothing to erase. Without this, std::move would move-assign every
+      // element after first to itself.
+      return to;
+    }
+    iterator new_end = std::move(from, end(), to);
+    std::destroy(new_end, end());
+    size_ = new_end - data_;
+    return to;
+  }
+
+  void clear() {
+    std::destroy(begin(), end());
+    size_ = 0;
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity > capacity_) {
+      MoveToHeap(capacity);
+    }
+  }
+
+ private:
+  T *InlineData() { return reinterpret_cast<T *>(inline_); }
+  const T *InlineData() const { return reinterpret_cast<const T *>(inline_); }
+
+  // Moves the elements if that can't throw, and copies them otherwise, the
+  // same rule std::vector uses (std::move_if_noexcept) to keep the strong
+  // exception guarantee when it grows.
+  static void Relocate(T *from, size_t count, T *to) {
+    if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+      std::uninitialized_move(from, from + count, to);
+    } else {
+      std::uninitialized_copy(from, from + count, to);
+    }
+    std::destroy(from, from + count);
+  }
+
+  void MoveToHeap(size_t capacity) {
+    T *heap = std::allocator<T>().allocate(capacity);
+    try {
+      Relocate(data_, size_, heap);
+    } catch (...) {
+      std::allocator<T>().deallocate(heap, capacity);
+      throw;
+    }
+    FreeHeap();
+    data_ = heap;
+    capacity_ = capacity;
+  }
+
+  // The new element is built in the new buffer before the old elements are
+  // moved, since args may refer to one of them (as in v.push_back(v[0])).
+  template <typename... Args>
+  T &GrowAndEmplaceBack(Args &&...args) {
+    size_t capacity = capacity_ * 2;
+    T *heap = std::allocator<T>().allocate(capacity);
+    T *slot;
+    try {
+      slot = new (heap + size_) T(std::forward<Args>(args)...);
+    } catch (...) {
+      std::allocator<T>().deallocate(heap, capacity);
+      throw;
+    }
+    // If a copy throws, Relocate has already destroyed the copies it made,
+    // and the old elements are untouched.
+    try {
+      Relocate(data_, size_, heap);
+    } catch (...) {
+      slot->~T();
+      std::allocator<T>().deallocate(heap, capacity);
+      throw;
+    }
+    FreeHeap();
+    data_ = heap;
+    capacity_ = capacity;
+    size_ += 1;
+    return *slot;
+  }
+
+  void FreeHeap() {
+    if (!IsInline()) {
+      std::allocator<T>().deallocate(data_, capacity_);
+      data_ = InlineData();
+      capacity_ = N;
+    }
+  }
+
+  // Expects this to be empty and inline.
+  void TakeFrom(SmallVector &other) {
+    if (other.IsInline()) {
+      std::uninitialized_move(other.begin(), other.end(), data_);
+      size_ = other.size_;
+      other.clear();
+      return;
+    }
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = other.InlineData();
+    other.size_ = 0;
+    other.capacity_ = N;
+  }
+
+  T *data_{InlineData()};
+  size_t size_{0};
+  size_t capacity_{N};
+  alignas(T) unsigned char inline_[N * sizeof(T)];
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// To see how many heap allocations each container makes, we replace the
+// global operator new and operator delete with versions that count calls.
+// Every new expression and every std::allocator in this program goes
+// through them.
+static size_t allocation_count = 0;
+
+void *operator new(size_t size) {
+  allocation_count += 1;
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// Keeps the compiler from deleting the loops below as dead code.
+static volatile size_t sink = 0;
+
+template <typename Fn>
+void Measure(const char *name, size_t iterations, Fn fn) {
+  size_t allocations_before = allocation_count;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    fn(i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  double allocations = static_cast<double>(allocation_count - allocations_before) / iterations;
+  std::cout << "  " << std::left << std::setw(28) << name << ns / iterations << " ns, " << allocations << " allocations per iteration\n";
+}
+
+template <typename Vec>
+size_t BuildInts(size_t count, size_t seed) {
+  Vec vec;
+  for (size_t i = 0; i < count; ++i) {
+    vec.push_back(static_cast<int>(seed + i));
+  }
+  // Like vectors.cpp, we erase one element and then iterate.
+  vec.erase(vec.begin() + 1);
+  size_t sum = 0;
+  for (int value : vec) {
+    sum += value;
+  }
+  return sum;
+}
+
+// A Person from move_constructors.cpp, minus the print statements, with
+// the type of nicknames_ as a template parameter.
+template <typename Nicknames>
+class Person {
+ public:
+  Person(uint32_t age, Nicknames &&nicknames) : age_(age), nicknames_(std::move(nicknames)) {}
+  Person(Person &&person) noexcept = default;
+  Person &operator=(Person &&other) noexcept = default;
+  size_t NicknameCount() const { return nicknames_.size() + age_ % 2; }
+
+ private:
+  uint32_t age_;
+  Nicknames nicknames_;
+};
+
+template <typename Nicknames>
+size_t BuildAndMovePeople(size_t seed) {
+  Nicknames nicknames;
+  nicknames.emplace_back("andy");
+  nicknames.emplace_back("pavlo");
+  Person<Nicknames> andy(static_cast<uint32_t>(seed), std::move(nicknames));
+  Person<Nicknames> andy1(std::move(andy));
+  Person<Nicknames> andy2 = std::move(andy1);
+  return andy2.NicknameCount();
+}
+
+void RunBenchmark() {
+  constexpr size_t iterations = 1000000;
+
+  std::cout << "Build a vector of 4 ints, erase one, and sum it:\n";
+  Measure("std::vector<int>", iterations, [](size_t i) { sink = sink + BuildInts<std::vector<int>>(4, i); });
+  Measure("SmallVector<int, 8>", iterations,
+          [](size_t i) { sink = sink + BuildInts<SmallVector<int, 8>>(4, i); });
+
+  std::cout << "Build a vector of 20 ints (SmallVector spills to the heap):\n";
+  Measure("std::vector<int>", iterations, [](size_t i) { sink = sink + BuildInts<std::vector<int>>(20, i); });
+  Measure("SmallVector<int, 8>", iterations,
+          [](size_t i) { sink = sink + BuildInts<SmallVector<int, 8>>(20, i); });
+
+  // Here both sides pay for something: std::vector allocates, and
+  // SmallVector moves the two strings one at a time on every Person move.
+  std::cout << "Build a Person with two nicknames and move it twice:\n";
+  Measure("std::vector<std::string>", iterations,
+          [](size_t i) { sink = sink + BuildAndMovePeople<std::vector<std::string>>(i); });
+  Measure("SmallVector<std::string, 4>", iterations,
+          [](size_t i) { sink = sink + BuildAndMovePeople<SmallVector<std::string, 4>>(i); });
+}
+
+int main() {
+  // A SmallVector can be used just like the int_vector in vectors.cpp.
+  SmallVector<int, 4> int_vector = {0, 1, 2, 3};
+  std::cout << "int_vector is inline: " << int_vector.IsInline() << ", capacity " << int_vector.capacity() << "\n";
+
+  // The fifth element doesn't fit in the inline storage, so int_vector
+  // spills to the heap.
+  size_t allocations_before = allocation_count;
+  int_vector.push_back(4);
+  int_vector.emplace_back(5);
+  std::cout << "After pushing 2 more: inline " << int_vector.IsInline() << ", capacity " << int_vector.capacity()
+            << ", heap allocations " << allocation_count - allocations_before << "\n";
+
+  int_vector.erase(int_vector.begin() + 2);
+  std::cout << "Printing the elements of int_vector after erasing the element at index 2:\n";
+  for (const int &elem : int_vector) {
+    std::cout << elem << " ";
+  }
+  std::cout << "\n";
+
+  // Moving a heap-backed SmallVector steals the buffer, just like a
+  // std::vector, so no allocation happens.
+  allocations_before = allocation_count;
+  SmallVector<int, 4> stolen = std::move(int_vector);
+  std::cout << "Moving a spilled vector: " << allocation_count - allocations_before << " allocations, "
+            << "int_vector is empty: " << int_vector.empty() << "\n";
+
+  // Nicknames like in move_constructors.cpp. Short strings also live
+  // inline (in std::string's own small string buffer), so building this
+  // makes no heap allocations at all.
+  allocations_before = allocation_count;
+  SmallVector<std::string, 4> nicknames;
+  nicknames.emplace_back("andy");
+  nicknames.emplace_back("pavlo");
+  SmallVector<std::string, 4> moved_nicknames = std::move(nicknames);
+  std::cout << "Nicknames: " << moved_nicknames[0] << ", " << moved_nicknames[1] << " ("
+            << allocation_count - allocations_before << " heap allocations)\n";
+
+  RunBenchmark();
+
+  return 0;
+}
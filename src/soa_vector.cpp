@@ -0,0 +1,587 @@
+/**
+ * @file soa_vector.cpp
+ * @brief Tutorial code for a structure-of-arrays (SoA) container.
+ */
+
+// vectors.cpp stores its points in a std::vector<Point>. In memory, that
+// looks like x0 y0 x1 y1 x2 y2 ..., which is called an array of structures
+// (AoS). When vectors.cpp erases every point with GetX() == 37, it only
+// needs the x coordinates, but since the y coordinates sit right next to
+// them, every cache line that the filter loads is half full of data that it
+// never looks at.
+
+// A structure of arrays (SoA) stores every field in its own array instead:
+// x0 x1 x2 ... and y0 y1 y2 .... A loop over x alone now reads only x
+// values, so it moves half as much memory, and since the x values are
+// packed next to each other, the compiler (or we) can process 8 of them at
+// once with SIMD instructions. This is the same idea that column stores
+// (like the ones you learn about in 15-445/645) use for whole tables.
+
+// The catch is that there is no Point object in memory anymore, so we can't
+// hand out a Point&. Instead, the container hands out a small proxy object
+// that remembers the container and an index, and looks like a Point: it has
+// GetX, SetX, GetY, SetY and PrintPoint, and reads and writes go straight
+// to the columns.
+
+// Includes std::remove_if.
+#include <algorithm>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::memcpy.
+#include <cstring>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::align_val_t and the aligned operator new.
+#include <new>
+// Includes std::mt19937.
+#include <random>
+// Includes std::tuple and std::apply.
+#include <tuple>
+// Includes std::is_trivially_copyable.
+#include <type_traits>
+// Includes std::index_sequence.
+#include <utility>
+// Includes the vector container we compare against.
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOOTCAMP_X86 1
+// Includes the AVX2 intrinsics.
+#include <immintrin.h>
+#endif
+
+// Every column starts on a 64 byte boundary, which is both a cache line and
+// enough for the widest (AVX-512) vector loads.
+static constexpr size_t COLUMN_ALIGNMENT = 64;
+
+// SoAVector<Ts...> stores rows of (Ts...) as one aligned array per field.
+// Column I can be accessed as a plain pointer with Column<I>(), which is what
+// the kernels below use.
+template <typename... Ts>
+class SoAVector {
+  static_assert((std::is_trivially_copyable_v<Ts> && ...), "columns are moved around with memcpy");
+  static constexpr size_t NUM_COLUMNS = sizeof...(Ts);
+
+ public:
+  SoAVector() = default;
+
+  ~SoAVector() { FreeColumns(columns_); }
+
+  // Columns are owned memory, so like the wrapper classes in
+  // wrapper_class.cpp, we allow moving but not (implicit) copying.
+  SoAVector(const SoAVector &) = delete;
+  SoAVector &operator=(const SoAVector &) = delete;
+  SoAVector(SoAVector &&other) noexcept
+      : columns_(other.columns_), size_(other.size_), capacity_(other.capacity_) {
+    other.columns_ = {};
+    other.size_ = 0;
+    other.capacity_ = 0;
+  }
+  SoAVector &operator=(SoAVector &&other) noexcept {
+    std::swap(columns_, other.columns_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    return *this;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  template <size_t I>
+  auto *Column() {
+    return std::get<I>(columns_);
+  }
+  template <size_t I>
+  const auto *Column() const {
+    return std::get<I>(columns_);
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    Columns bigger = AllocateColumns(capacity, std::index_sequence_for<Ts...>{});
+    if (size_ > 0) {
+      CopyColumns(bigger, columns_, size_, std::index_sequence_for<Ts...>{});
+    }
+    FreeColumns(columns_);
+    columns_ = bigger;
+    capacity_ = capacity;
+  }
+
+  // Appends one row. Each value goes to the end of its own column.
+  void emplace_back(Ts... values) {
+    if (size_ == capacity_) {
+      reserve(capacity_ == 0 ? 16 : capacity_ * 2);
+    }
+    Store(size_, std::index_sequence_for<Ts...>{}, values...);
+    size_ += 1;
+  }
+
+  void push_back(const std::tuple<Ts...> &row) {
+    std::apply([this](const Ts &...values) { emplace_back(values...); }, row);
+  }
+
+  std::tuple<Ts...> Row(size_t i) const { return LoadRow(i, std::index_sequence_for<Ts...>{}); }
+
+  // Keeps only the rows for which keep[i] is nonzero, in order. This is the
+  // column-at-a-time version of an erase: fill_keep(begin, count, keep)
+  // computes the mask for rows [begin, begin + count) from whichever
+  // columns the predicate needs, and then the mask is applied to every
+  // column. We go in chunks small enough that the mask and the rows we just
+  // read are still in the L1 cache when we write them back.
+  template <typename FillKeep>
+  void Compact(FillKeep fill_keep) {
+    uint8_t keep[COMPACT_CHUNK];
+    size_t out = 0;
+    for (size_t begin = 0; begin < size_; begin += COMPACT_CHUNK) {
+      size_t count = std::min(COMPACT_CHUNK, size_ - begin);
+      fill_keep(begin, count, keep);
+      size_t kept = 0;
+      std::apply([&](auto *...column) { ((kept = CompactColumn(column, begin, count, out, keep)), ...); },
+                 columns_);
+      out += kept;
+    }
+    size_ = out;
+  }
+
+  void resize_down(size_t new_size) { size_ = std::min(size_, new_size); }
+
+ private:
+  using Columns = std::tuple<Ts *...>;
+
+  // A branch-free stable compaction. Every element is written to
+  // column[out + k], but k only advances for the elements we keep, so the
+  // ones we drop are overwritten by the next element. There is no branch to
+  // mispredict, no matter how the kept and dropped elements are mixed.
+  // Since out <= begin, we never overwrite a row we haven't read yet.
+  template <typename T>
+  static size_t CompactColumn(T *column, size_t begin, size_t count, size_t out, const uint8_t *keep) {
+    const T *in = column + begin;
+    T *to = column + out;
+    size_t k = 0;
+    size_t i = 0;
+    // Most filters keep long stretches of rows, so when the next 8 rows are
+    // all kept, we move them with one (vectorized) copy instead.
+    for (; i + 8 <= count; i += 8) {
+      uint64_t mask;
+      std::memcpy(&mask, keep + i, 8);
+      if (mask == ALL_KEPT) {
+        std::memmove(to + k, in + i, 8 * sizeof(T));
+        k += 8;
+        continue;
+      }
+      for (size_t j = i; j < i + 8; ++j) {
+        to[k] = in[j];
+        k += keep[j];
+      }
+    }
+    for (; i < count; ++i) {
+      to[k] = in[i];
+      k += keep[i];
+    }
+    return k;
+  }
+
+  static constexpr size_t COMPACT_CHUNK = 2048;
+  static constexpr uint64_t ALL_KEPT = 0x0101010101010101ULL;
+
+  struct ColumnDeleter {
+    void operator()(void *column) const { ::operator delete(column, std::align_val_t{COLUMN_ALIGNMENT}); }
+  };
+  template <typename T>
+  using ColumnPtr = std::unique_ptr<T[], ColumnDeleter>;
+
+  template <typename T>
+  static ColumnPtr<T> AllocateColumn(size_t capacity) {
+    return ColumnPtr<T>(static_cast<T *>(::operator new(capacity * sizeof(T), std::align_val_t{COLUMN_ALIGNMENT})));
+  }
+
+  // Each column is owned by a ColumnPtr until all of them are allocated, so
+  // if one allocation throws, the columns before it are freed.
+  template <size_t... Is>
+  static Columns AllocateColumns(size_t capacity, std::index_sequence<Is...>) {
+    std::tuple<ColumnPtr<Ts>...> owned{AllocateColumn<Ts>(capacity)...};
+    return Columns{std::get<Is>(owned).release()...};
+  }
+
+  template <size_t... Is>
+  static void CopyColumns(Columns &to, const Columns &from, size_t n, std::index_sequence<Is...>) {
+    (std::memcpy(std::get<Is>(to), std::get<Is>(from), n * sizeof(Ts)), ...);
+  }
+
+  static void FreeColumns(Columns &columns) {
+    std::apply(
+        [](auto *...column) {
+          ((column != nullptr ? ::operator delete(column, std::align_val_t{COLUMN_ALIGNMENT}) : void()), ...);
+        },
+        columns);
+  }
+
+  template <size_t... Is>
+  void Store(size_t i, std::index_sequence<Is...>, Ts... values) {
+    ((std::get<Is>(columns_)[i] = values), ...);
+  }
+
+  template <size_t... Is>
+  std::tuple<Ts...> LoadRow(size_t i, std::index_sequence<Is...>) const {
+    return {std::get<Is>(columns_)[i]...};
+  }
+
+  Columns columns_{};
+  size_t size_{0};
+  size_t capacity_{0};
+};
+
+/* ======================================================================
+   === Points stored as columns =========================================
+   ====================================================================== */
+
+// PointColumns stores the x_ and y_ fields of the Point class from
+// vectors.cpp as two columns.
+class PointColumns {
+ public:
+  // PointRef is the proxy that stands in for a Point&. It is cheap to copy
+  // (a pointer and an index), and every getter and setter reads or writes
+  // the underlying column.
+  class PointRef {
+   public:
+    PointRef(PointColumns *points, size_t i) : points_(points), i_(i) {}
+    int GetX() const { return points_->xs()[i_]; }
+    int GetY() const { return points_->ys()[i_]; }
+    void SetX(int x) { points_->xs()[i_] = x; }
+    void SetY(int y) { points_->ys()[i_] = y; }
+    void PrintPoint() const { std::cout << "Point value is (" << GetX() << ", " << GetY() << ")\n"; }
+
+   private:
+    PointColumns *points_;
+    size_t i_;
+  };
+
+  // The iterator dereferences to a PointRef by value, which is why range
+  // loops over PointColumns use `auto point` or `PointRef point` rather
+  // than `Point &point`.
+  class Iterator {
+   public:
+    Iterator(PointColumns *points, size_t i) : points_(points), i_(i) {}
+    PointRef operator*() const { return PointRef(points_, i_); }
+    Iterator &operator++() {
+      i_ += 1;
+      return *this;
+    }
+    bool operator!=(const Iterator &other) const { return i_ != other.i_; }
+    bool operator==(const Iterator &other) const { return i_ == other.i_; }
+
+   private:
+    PointColumns *points_;
+    size_t i_;
+  };
+
+  void emplace_back(int x, int y) { columns_.emplace_back(x, y); }
+  void reserve(size_t capacity) { columns_.reserve(capacity); }
+  size_t size() const { return columns_.size(); }
+  PointRef operator[](size_t i) { return PointRef(this, i); }
+  Iterator begin() { return Iterator(this, 0); }
+  Iterator end() { return Iterator(this, size()); }
+
+  int *xs() { return columns_.Column<0>(); }
+  int *ys() { return columns_.Column<1>(); }
+  const int *xs() const { return columns_.Column<0>(); }
+  const int *ys() const { return columns_.Column<1>(); }
+
+  // Erase every point whose x is equal to (or less than) value, keeping the
+  // order of the rest. Only the x column is read to decide, and the mask is
+  // computed 8 lanes at a time when the CPU supports AVX2.
+  void EraseIfXEquals(int value);
+  void EraseIfXLess(int value);
+
+  SoAVector<int, int> &Columns() { return columns_; }
+
+ private:
+  SoAVector<int, int> columns_;
+};
+
+/* ======================================================================
+   === Kernels ==========================================================
+   ====================================================================== */
+
+// Every kernel has a scalar version, written so the compiler can vectorize
+// it, and an explicit AVX2 version that is picked at runtime.
+
+// The comparisons that the erase kernels know about.
+enum class Compare { EQUAL, LESS };
+
+// Writes keep[i] = 1 for the values that do NOT match the comparison, since
+// those are the ones an erase keeps.
+template <Compare CMP>
+void KeepMaskScalar(const int *xs, size_t n, int value, uint8_t *keep) {
+  for (size_t i = 0; i < n; ++i) {
+    keep[i] = CMP == Compare::EQUAL ? xs[i] != value : xs[i] >= value;
+  }
+}
+
+int64_t SumScalar(const int *xs, size_t n) {
+  int64_t sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += xs[i];
+  }
+  return sum;
+}
+
+size_t CountLessScalar(const int *xs, size_t n, int value) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    count += xs[i] < value;
+  }
+  return count;
+}
+
+#ifdef BOOTCAMP_X86
+
+// The same mask, 8 values at a time. The comparison gives us one bit per
+// lane, and _pdep_u64 deposits those 8 bits into the low bit of 8 bytes.
+template <Compare CMP>
+__attribute__((target("avx2,bmi2"))) void KeepMaskAVX2(const int *xs, size_t n, int value, uint8_t *keep) {
+  __m256i needle = _mm256_set1_epi32(value);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xs + i));
+    __m256i match = CMP == Compare::EQUAL ? _mm256_cmpeq_epi32(v, needle) : _mm256_cmpgt_epi32(needle, v);
+    uint32_t matched = _mm256_movemask_ps(_mm256_castsi256_ps(match));
+    uint64_t bytes = _pdep_u64(~matched & 0xFF, 0x0101010101010101ULL);
+    std::memcpy(keep + i, &bytes, 8);
+  }
+  KeepMaskScalar<CMP>(xs + i, n - i, value, keep + i);
+}
+
+// Sums 8 lanes at a time. We widen to 64 bit lanes, so that a sum of
+// millions of ints can't overflow.
+__attribute__((target("avx2"))) int64_t SumAVX2(const int *xs, size_t n) {
+  __m256i acc_lo = _mm256_setzero_si256();
+  __m256i acc_hi = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xs + i));
+    acc_lo = _mm256_add_epi64(acc_lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    acc_hi = _mm256_add_epi64(acc_hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc_lo, acc_hi));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar(xs + i, n - i);
+}
+
+// Counts 8 lanes at a time. A true comparison is all ones (-1), so
+// subtracting the comparison result adds 1 to every matching lane.
+__attribute__((target("avx2"))) size_t CountLessAVX2(const int *xs, size_t n, int value) {
+  __m256i needle = _mm256_set1_epi32(value);
+  __m256i counts = _mm256_setzero_si256();
+  size_t total = 0;
+  size_t i = 0;
+  while (i + 8 <= n) {
+    // Each 32 bit lane counter is flushed well before it could overflow.
+    size_t block_end = std::min(n - (n - i) % 8, i + (size_t{1} << 30));
+    for (; i < block_end; i += 8) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xs + i));
+      counts = _mm256_sub_epi32(counts, _mm256_cmpgt_epi32(needle, v));
+    }
+    alignas(32) uint32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), counts);
+    for (uint32_t lane : lanes) {
+      total += lane;
+    }
+    counts = _mm256_setzero_si256();
+  }
+  return total + CountLessScalar(xs + i, n - i, value);
+}
+
+#endif  // BOOTCAMP_X86
+
+static bool HasAVX2() {
+#ifdef BOOTCAMP_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+template <Compare CMP>
+void KeepMask(const int *xs, size_t n, int value, uint8_t *keep) {
+#ifdef BOOTCAMP_X86
+  if (HasAVX2()) {
+    KeepMaskAVX2<CMP>(xs, n, value, keep);
+    return;
+  }
+#endif
+  KeepMaskScalar<CMP>(xs, n, value, keep);
+}
+
+int64_t Sum(const int *xs, size_t n) {
+#ifdef BOOTCAMP_X86
+  if (HasAVX2()) {
+    return SumAVX2(xs, n);
+  }
+#endif
+  return SumScalar(xs, n);
+}
+
+size_t CountLess(const int *xs, size_t n, int value) {
+#ifdef BOOTCAMP_X86
+  if (HasAVX2()) {
+    return CountLessAVX2(xs, n, value);
+  }
+#endif
+  return CountLessScalar(xs, n, value);
+}
+
+void PointColumns::EraseIfXEquals(int value) {
+  const int *x = xs();
+  columns_.Compact(
+      [x, value](size_t begin, size_t count, uint8_t *keep) { KeepMask<Compare::EQUAL>(x + begin, count, value, keep); });
+}
+
+void PointColumns::EraseIfXLess(int value) {
+  const int *x = xs();
+  columns_.Compact(
+      [x, value](size_t begin, size_t count, uint8_t *keep) { KeepMask<Compare::LESS>(x + begin, count, value, keep); });
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// The Point class from vectors.cpp, without the print statements in the
+// constructors (we're about to make ten million of them).
+class Point {
+ public:
+  Point() : x_(0), y_(0) {}
+  Point(int x, int y) : x_(x), y_(y) {}
+  inline int GetX() const { return x_; }
+  inline int GetY() const { return y_; }
+
+ private:
+  int x_;
+  int y_;
+};
+
+template <typename Fn>
+double TimeMs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RunBenchmark() {
+  constexpr size_t n = 10000000;
+  std::mt19937 gen(15445);
+  std::uniform_int_distribution<int> dist(0, 99);
+
+  std::vector<Point> aos;
+  PointColumns soa;
+  aos.reserve(n);
+  soa.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    int x = dist(gen);
+    int y = dist(gen);
+    aos.emplace_back(x, y);
+    soa.emplace_back(x, y);
+  }
+
+  int64_t aos_sum = 0;
+  int64_t soa_sum = 0;
+  double aos_sum_ms = TimeMs([&] {
+    for (const Point &point : aos) {
+      aos_sum += point.GetX();
+    }
+  });
+  double soa_sum_ms = TimeMs([&] { soa_sum = Sum(soa.xs(), soa.size()); });
+
+  size_t aos_count = 0;
+  size_t soa_count = 0;
+  double aos_count_ms = TimeMs([&] {
+    for (const Point &point : aos) {
+      aos_count += point.GetX() < 50;
+    }
+  });
+  double soa_count_ms = TimeMs([&] { soa_count = CountLess(soa.xs(), soa.size(), 50); });
+
+  // The filter from vectors.cpp. About 1% of the points have x == 37. An
+  // erase has to move every column, not just x, so SoA has no memory
+  // advantage here, and the branch in std::remove_if is almost never taken,
+  // so it predicts perfectly. Expect the two layouts to be about even.
+  double aos_erase_ms = TimeMs([&] {
+    aos.erase(std::remove_if(aos.begin(), aos.end(), [](const Point &point) { return point.GetX() == 37; }),
+              aos.end());
+  });
+  double soa_erase_ms = TimeMs([&] { soa.EraseIfXEquals(37); });
+  bool erase_matches = aos.size() == soa.size();
+
+  // About half of the points have x < 50, in random order, so the branch in
+  // std::remove_if is a coin flip. The SoA compaction has no such branch.
+  double aos_half_ms = TimeMs([&] {
+    aos.erase(std::remove_if(aos.begin(), aos.end(), [](const Point &point) { return point.GetX() < 50; }),
+              aos.end());
+  });
+  double soa_half_ms = TimeMs([&] { soa.EraseIfXLess(50); });
+  bool half_matches = aos.size() == soa.size();
+  for (size_t i = 0; half_matches && i < aos.size(); ++i) {
+    half_matches = aos[i].GetX() == soa[i].GetX() && aos[i].GetY() == soa[i].GetY();
+  }
+
+  std::cout << "Benchmark over " << n << " points (AVX2 " << (HasAVX2() ? "on" : "off") << "):\n";
+  std::cout << "  sum of x:       AoS " << aos_sum_ms << " ms, SoA " << soa_sum_ms << " ms"
+            << (aos_sum == soa_sum ? "" : " (MISMATCH)") << "\n";
+  std::cout << "  count x < 50:   AoS " << aos_count_ms << " ms, SoA " << soa_count_ms << " ms"
+            << (aos_count == soa_count ? "" : " (MISMATCH)") << "\n";
+  std::cout << "  erase x == 37:  AoS " << aos_erase_ms << " ms, SoA " << soa_erase_ms << " ms"
+            << (erase_matches ? "" : " (MISMATCH)") << "\n";
+  std::cout << "  erase x < 50:   AoS " << aos_half_ms << " ms, SoA " << soa_half_ms << " ms"
+            << (half_matches ? "" : " (MISMATCH)") << "\n";
+}
+
+int main() {
+  // We can use PointColumns much like the point_vector in vectors.cpp.
+  PointColumns points;
+  points.emplace_back(35, 36);
+  points.emplace_back(37, 38);
+  points.emplace_back(39, 40);
+  points.emplace_back(41, 42);
+
+  std::cout << "Printing the items in points:\n";
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i].PrintPoint();
+  }
+
+  // The range-based for loop hands us PointRef proxies by value. Writing
+  // through a proxy writes to the column, so this really changes points.
+  for (PointColumns::PointRef point : points) {
+    point.SetY(445);
+  }
+
+  // The same filter as in vectors.cpp, but it only ever reads the x column.
+  points.EraseIfXEquals(37);
+  std::cout << "Printing points after (37, 445) is erased:\n";
+  for (auto point : points) {
+    point.PrintPoint();
+  }
+
+  // The columns are plain arrays, so the aggregate kernels can run over
+  // them directly.
+  std::cout << "Sum of x: " << Sum(points.xs(), points.size())
+            << ", points with x < 40: " << CountLess(points.xs(), points.size(), 40) << "\n";
+
+  // SoAVector works for any mix of trivially copyable fields.
+  SoAVector<int, double, char> rows;
+  rows.emplace_back(1, 2.5, 'a');
+  rows.emplace_back(2, 3.5, 'b');
+  auto [id, score, grade] = rows.Row(1);
+  std::cout << "Row 1 of rows is (" << id << ", " << score << ", " << grade << ")\n";
+
+  RunBenchmark();
+
+  return 0;
+}
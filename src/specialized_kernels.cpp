@@ -0,0 +1,465 @@
+/**
+ * @file specialized_kernels.cpp
+ * @brief Tutorial code for operator kernels that are specialized at compile
+ * time on their type and flags, like add3<bool> in templated_functions.cpp.
+ */
+
+// templated_functions.cpp has this contrived function:
+//   template <bool T> int add3(int a) { if (T) { return a + 3; } return a; }
+// Since T is known at compile time, add3<true> and add3<false> are two
+// separate functions, and neither of them has a branch left in it. That's
+// not very useful for one addition, but it is for a loop over millions of
+// values, where a branch that's re-checked for every value costs time even
+// when it always goes the same way.
+
+// A database evaluates expressions like "a + b" or "x < 50" one column (a
+// vector of values) at a time. How an operator handles a column depends on
+// things that don't change while it runs:
+// - The type of the values (int32_t, int64_t, double).
+// - Whether a column can have NULLs. If it can, every value has a validity
+//   flag, and the result of "a + b" is NULL if either a or b is.
+// - Whether integer overflow has to be detected (SQL says INT_MAX + 1 is an
+//   error, not a negative number).
+// - Which comparison to do (<, =, ...).
+// A kernel written with runtime flags re-checks all of these for every
+// value. Here, each kernel takes them as template parameters, and uses
+// `if constexpr` inside the loop, so that every combination is compiled into
+// its own loop with nothing but the work left in it. The runtime flags are
+// checked once per column, to pick which of those loops to call. Passing a
+// flag as a type (std::true_type or std::false_type) so that a function can
+// be chosen at compile time is called "tag dispatch".
+
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::numeric_limits.
+#include <limits>
+// Includes std::mt19937.
+#include <random>
+// Includes std::overflow_error.
+#include <stdexcept>
+// Includes std::true_type, std::false_type, std::integral_constant.
+#include <type_traits>
+// Includes the vector container.
+#include <vector>
+
+/* ======================================================================
+   === Columns ==========================================================
+   ====================================================================== */
+
+// A column of values. If the column can hold NULLs, valid_ has one byte per
+// value, 1 if the value is there and 0 if it's NULL. Otherwise valid_ is
+// empty. (Real systems use one bit per value, but a byte is easier to read
+// here.)
+template <typename T>
+struct Column {
+  std::vector<T> values_;
+  std::vector<uint8_t> valid_;
+
+  size_t Size() const { return values_.size(); }
+  bool IsNullable() const { return !valid_.empty(); }
+  bool IsNull(size_t i) const { return IsNullable() && valid_[i] == 0; }
+};
+
+// A selection vector: the positions of the rows that passed a filter.
+using SelectionVector = std::vector<uint32_t>;
+
+// The comparisons a filter can make between a column and a constant, like
+// in simd_compaction.cpp.
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+/* ======================================================================
+   === Tag dispatch =====================================================
+   ====================================================================== */
+
+// Turns a runtime bool into a compile-time one: calls fn(std::true_type{})
+// or fn(std::false_type{}). Inside fn, decltype(flag)::value is a constant
+// that can be used as a template argument or in `if constexpr`.
+template <typename Fn>
+void DispatchFlag(bool flag, Fn &&fn) {
+  if (flag) {
+    fn(std::true_type{});
+  } else {
+    fn(std::false_type{});
+  }
+}
+
+// The same for a CompareOp: calls fn(std::integral_constant<CompareOp, OP>{}).
+template <typename Fn>
+void DispatchCompareOp(CompareOp op, Fn &&fn) {
+  switch (op) {
+    case CompareOp::EQ:
+      return fn(std::integral_constant<CompareOp, CompareOp::EQ>{});
+    case CompareOp::NE:
+      return fn(std::integral_constant<CompareOp, CompareOp::NE>{});
+    case CompareOp::LT:
+      return fn(std::integral_constant<CompareOp, CompareOp::LT>{});
+    case CompareOp::LE:
+      return fn(std::integral_constant<CompareOp, CompareOp::LE>{});
+    case CompareOp::GT:
+      return fn(std::integral_constant<CompareOp, CompareOp::GT>{});
+    case CompareOp::GE:
+      return fn(std::integral_constant<CompareOp, CompareOp::GE>{});
+  }
+}
+
+template <CompareOp OP, typename T>
+inline bool Compare(T a, T b) {
+  if constexpr (OP == CompareOp::EQ) {
+    return a == b;
+  } else if constexpr (OP == CompareOp::NE) {
+    return a != b;
+  } else if constexpr (OP == CompareOp::LT) {
+    return a < b;
+  } else if constexpr (OP == CompareOp::LE) {
+    return a <= b;
+  } else if constexpr (OP == CompareOp::GT) {
+    return a > b;
+  } else {
+    return a >= b;
+  }
+}
+
+/* ======================================================================
+   === The specialized kernels ==========================================
+   ====================================================================== */
+
+// out = a + b. Each of the eight combinations of the three flags is its own
+// loop. Overflow is only checked for integers: floating point overflow
+// gives infinity, which SQL allows.
+template <typename T, bool LEFT_NULLABLE, bool RIGHT_NULLABLE, bool CHECK_OVERFLOW>
+void AddKernel(const Column<T> &a, const Column<T> &b, Column<T> *out) {
+  constexpr bool NULLABLE = LEFT_NULLABLE || RIGHT_NULLABLE;
+  constexpr bool CHECK = CHECK_OVERFLOW && std::is_integral_v<T>;
+  size_t n = a.Size();
+  out->values_.resize(n);
+  if constexpr (NULLABLE) {
+    out->valid_.resize(n);
+  } else {
+    out->valid_.clear();
+  }
+
+  // Instead of stopping at the first overflow, which would be a branch, we
+  // remember whether any row overflowed and check once after the loop.
+  bool overflow = false;
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t valid = 1;
+    if constexpr (LEFT_NULLABLE) {
+      valid &= a.valid_[i];
+    }
+    if constexpr (RIGHT_NULLABLE) {
+      valid &= b.valid_[i];
+    }
+    if constexpr (CHECK) {
+      // The sum of two NULLs can overflow, but it's still just NULL.
+      T sum;
+      overflow |= __builtin_add_overflow(a.values_[i], b.values_[i], &sum) & valid;
+      out->values_[i] = sum;
+    } else if constexpr (std::is_integral_v<T>) {
+      // Wraps around instead of being undefined behavior like signed
+      // overflow normally is.
+      using U = std::make_unsigned_t<T>;
+      out->values_[i] = static_cast<T>(static_cast<U>(a.values_[i]) + static_cast<U>(b.values_[i]));
+    } else {
+      out->values_[i] = a.values_[i] + b.values_[i];
+    }
+    if constexpr (NULLABLE) {
+      out->valid_[i] = valid;
+    }
+  }
+  if (overflow) {
+    throw std::overflow_error("integer overflow in +");
+  }
+}
+
+// Appends the positions of the rows where column OP constant holds to sel.
+// A NULL never matches (in SQL, NULL < 50 is NULL, which isn't true). The
+// position is always written, and the output only moves forward when the
+// row matches, so there is no branch on the data either (see
+// simd_compaction.cpp for why that matters).
+template <typename T, CompareOp OP, bool NULLABLE>
+void FilterKernel(const Column<T> &column, T constant, SelectionVector *sel) {
+  size_t n = column.Size();
+  sel->resize(n);
+  uint32_t *out = sel->data();
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    bool match = Compare<OP>(column.values_[i], constant);
+    if constexpr (NULLABLE) {
+      match = match & (column.valid_[i] != 0);
+    }
+    out[count] = static_cast<uint32_t>(i);
+    count += match;
+  }
+  sel->resize(count);
+}
+
+// Sums the selected rows, skipping NULLs. The aggregate after a filter.
+template <typename T, bool NULLABLE>
+T SumKernel(const Column<T> &column, const SelectionVector &sel) {
+  T sum = 0;
+  for (uint32_t i : sel) {
+    if constexpr (NULLABLE) {
+      // Multiplying by 0 or 1 instead of branching on it.
+      sum += column.values_[i] * static_cast<T>(column.valid_[i]);
+    } else {
+      sum += column.values_[i];
+    }
+  }
+  return sum;
+}
+
+/* ======================================================================
+   === Entry points =====================================================
+   ====================================================================== */
+
+// These are what the rest of a database would call. They look at the
+// columns and the flags at runtime, once, and then run the one kernel that
+// was compiled for exactly that case.
+
+template <typename T>
+void Add(const Column<T> &a, const Column<T> &b, bool check_overflow, Column<T> *out) {
+  DispatchFlag(a.IsNullable(), [&](auto left_nullable) {
+    DispatchFlag(b.IsNullable(), [&](auto right_nullable) {
+      DispatchFlag(check_overflow, [&](auto check) {
+        AddKernel<T, decltype(left_nullable)::value, decltype(right_nullable)::value, decltype(check)::value>(a, b,
+                                                                                                             out);
+      });
+    });
+  });
+}
+
+template <typename T>
+void Filter(const Column<T> &column, CompareOp op, T constant, SelectionVector *sel) {
+  DispatchCompareOp(op, [&](auto op_tag) {
+    DispatchFlag(column.IsNullable(), [&](auto nullable) {
+      FilterKernel<T, decltype(op_tag)::value, decltype(nullable)::value>(column, constant, sel);
+    });
+  });
+}
+
+template <typename T>
+T Sum(const Column<T> &column, const SelectionVector &sel) {
+  T sum = 0;
+  DispatchFlag(column.IsNullable(), [&](auto nullable) { sum = SumKernel<T, decltype(nullable)::value>(column, sel); });
+  return sum;
+}
+
+/* ======================================================================
+   === The same kernels with runtime branches ===========================
+   ====================================================================== */
+
+// These do exactly the same work, but check the flags for every value, like
+// add3 would if it took its bool as an argument. They're noinline so that
+// the compiler can't see the flags' values at the call site and specialize
+// them by itself.
+
+template <typename T>
+__attribute__((noinline)) void AddRuntime(const Column<T> &a, const Column<T> &b, bool check_overflow, Column<T> *out) {
+  size_t n = a.Size();
+  bool nullable = a.IsNullable() || b.IsNullable();
+  out->values_.resize(n);
+  out->valid_.resize(nullable ? n : 0);
+  bool overflow = false;
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t valid = 1;
+    if (a.IsNullable()) {
+      valid &= a.valid_[i];
+    }
+    if (b.IsNullable()) {
+      valid &= b.valid_[i];
+    }
+    // The type is still a template parameter here: a database with a
+    // runtime type would switch on that too.
+    if constexpr (std::is_integral_v<T>) {
+      if (check_overflow) {
+        T sum;
+        overflow |= __builtin_add_overflow(a.values_[i], b.values_[i], &sum) & valid;
+        out->values_[i] = sum;
+      } else {
+        using U = std::make_unsigned_t<T>;
+        out->values_[i] = static_cast<T>(static_cast<U>(a.values_[i]) + static_cast<U>(b.values_[i]));
+      }
+    } else {
+      out->values_[i] = a.values_[i] + b.values_[i];
+    }
+    if (nullable) {
+      out->valid_[i] = valid;
+    }
+  }
+  if (overflow) {
+    throw std::overflow_error("integer overflow in +");
+  }
+}
+
+template <typename T>
+__attribute__((noinline)) void FilterRuntime(const Column<T> &column, CompareOp op, T constant, SelectionVector *sel) {
+  size_t n = column.Size();
+  sel->resize(n);
+  uint32_t *out = sel->data();
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i) {
+    T value = column.values_[i];
+    bool match = false;
+    switch (op) {
+      case CompareOp::EQ:
+        match = value == constant;
+        break;
+      case CompareOp::NE:
+        match = value != constant;
+        break;
+      case CompareOp::LT:
+        match = value < constant;
+        break;
+      case CompareOp::LE:
+        match = value <= constant;
+        break;
+      case CompareOp::GT:
+        match = value > constant;
+        break;
+      case CompareOp::GE:
+        match = value >= constant;
+        break;
+    }
+    if (column.IsNullable()) {
+      match = match & (column.valid_[i] != 0);
+    }
+    out[count] = static_cast<uint32_t>(i);
+    count += match;
+  }
+  sel->resize(count);
+}
+
+template <typename T>
+__attribute__((noinline)) T SumRuntime(const Column<T> &column, const SelectionVector &sel) {
+  T sum = 0;
+  for (uint32_t i : sel) {
+    if (column.IsNullable()) {
+      sum += column.values_[i] * static_cast<T>(column.valid_[i]);
+    } else {
+      sum += column.values_[i];
+    }
+  }
+  return sum;
+}
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+template <typename Fn>
+double TimeMs(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs fn a few times and returns the fastest run.
+template <typename Fn>
+double BestOfMs(Fn fn) {
+  double best = TimeMs(fn);
+  for (int run = 1; run < 5; ++run) {
+    double ms = TimeMs(fn);
+    best = ms < best ? ms : best;
+  }
+  return best;
+}
+
+// Values from 0 to 99, and every tenth value NULL if nullable.
+template <typename T>
+Column<T> MakeColumn(size_t n, bool nullable, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 99);
+  Column<T> column;
+  column.values_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    column.values_[i] = static_cast<T>(dist(gen));
+  }
+  if (nullable) {
+    column.valid_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      column.valid_[i] = gen() % 10 != 0;
+    }
+  }
+  return column;
+}
+
+void PrintRow(const char *name, double specialized_ms, double runtime_ms, bool ok) {
+  std::cout << "  " << name << ": specialized " << specialized_ms << " ms, runtime flags " << runtime_ms << " ms ("
+            << runtime_ms / specialized_ms << "x)" << (ok ? "" : " (MISMATCH)") << "\n";
+}
+
+template <typename T>
+void RunBenchmark(const char *type_name, size_t n) {
+  for (bool nullable : {false, true}) {
+    std::cout << n << " " << type_name << " values, " << (nullable ? "10% NULL" : "no NULLs") << ":\n";
+    Column<T> a = MakeColumn<T>(n, nullable, 15445);
+    Column<T> b = MakeColumn<T>(n, nullable, 15645);
+
+    for (bool check_overflow : {false, true}) {
+      Column<T> specialized_out;
+      Column<T> runtime_out;
+      double specialized_ms = BestOfMs([&] { Add(a, b, check_overflow, &specialized_out); });
+      double runtime_ms = BestOfMs([&] { AddRuntime(a, b, check_overflow, &runtime_out); });
+      bool ok = specialized_out.values_ == runtime_out.values_ && specialized_out.valid_ == runtime_out.valid_;
+      PrintRow(check_overflow ? "a + b, overflow checked" : "a + b", specialized_ms, runtime_ms, ok);
+    }
+
+    SelectionVector specialized_sel;
+    SelectionVector runtime_sel;
+    double specialized_ms = BestOfMs([&] { Filter(a, CompareOp::LT, static_cast<T>(50), &specialized_sel); });
+    double runtime_ms = BestOfMs([&] { FilterRuntime(a, CompareOp::LT, static_cast<T>(50), &runtime_sel); });
+    PrintRow("a < 50", specialized_ms, runtime_ms, specialized_sel == runtime_sel);
+
+    // The sums go to a volatile, or the compiler may notice that the five
+    // runs compute the same thing and only keep one.
+    volatile T specialized_sum = 0;
+    volatile T runtime_sum = 0;
+    specialized_ms = BestOfMs([&] { specialized_sum = Sum(b, specialized_sel); });
+    runtime_ms = BestOfMs([&] { runtime_sum = SumRuntime(b, runtime_sel); });
+    PrintRow("sum(b) where a < 50", specialized_ms, runtime_ms, specialized_sum == runtime_sum);
+  }
+}
+
+int main() {
+  // The add from templated_functions.cpp, on whole columns. b has a NULL in
+  // the middle, so the result does too.
+  Column<int32_t> a{{1, 2, 3, 4}, {}};
+  Column<int32_t> b{{10, 20, 30, 40}, {1, 1, 0, 1}};
+  Column<int32_t> sum;
+  Add(a, b, true, &sum);
+  std::cout << "Printing a + b: ";
+  for (size_t i = 0; i < sum.Size(); ++i) {
+    if (sum.IsNull(i)) {
+      std::cout << "NULL ";
+    } else {
+      std::cout << sum.values_[i] << " ";
+    }
+  }
+  std::cout << "\n";
+
+  // Overflow checking is a flag too. With it, INT_MAX + 1 is an error.
+  Column<int32_t> big{{std::numeric_limits<int32_t>::max()}, {}};
+  Column<int32_t> one{{1}, {}};
+  try {
+    Add(big, one, true, &sum);
+  } catch (const std::overflow_error &e) {
+    std::cout << "Adding 1 to INT_MAX with overflow checking: " << e.what() << "\n";
+  }
+  Add(big, one, false, &sum);
+  std::cout << "Adding 1 to INT_MAX without it wraps around to " << sum.values_[0] << "\n";
+
+  // Filter and aggregate: SELECT SUM(b) WHERE a >= 2.
+  SelectionVector sel;
+  Filter(a, CompareOp::GE, 2, &sel);
+  std::cout << "SUM(b) WHERE a >= 2: " << Sum(b, sel) << " (the NULL is skipped)\n\n";
+
+  RunBenchmark<int32_t>("int32_t", 16 << 20);
+  RunBenchmark<int64_t>("int64_t", 16 << 20);
+  RunBenchmark<double>("double", 16 << 20);
+
+  return 0;
+}
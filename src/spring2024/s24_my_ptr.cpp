@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <type_traits>
 #include <utility>
 
 // This file contains the code used in the Spring2024 15-445/645 C++ bootcamp.
@@ -39,9 +40,11 @@ class Pointer {
   Pointer<T> &operator=(const Pointer<T> &) = delete;
 
   // Add move constructor: useful when we need to EXTEND the lifetime of an object!
-  Pointer<T>(Pointer<T> &&another) : ptr_(another.ptr_) { another.ptr_ = nullptr; }
+  // Moving only steals a pointer and never throws, so we say so with noexcept: std::vector<Pointer<T>> checks it
+  // before it decides how to move its elements when it grows.
+  Pointer(Pointer<T> &&another) noexcept : ptr_(another.ptr_) { another.ptr_ = nullptr; }
   // Add move assign operator: useful when we need to EXTEND the lifetime of an object!
-  Pointer<T> &operator=(Pointer<T> &&another) {
+  Pointer<T> &operator=(Pointer<T> &&another) noexcept {
     if (ptr_ == another.ptr_) {  // In case `p = std::move(p);`
       return *this;
     }
@@ -65,6 +68,10 @@ class Pointer {
   T *ptr_;
 };
 
+// Checked at compile time, like a test that runs while compiling.
+static_assert(std::is_nothrow_move_constructible_v<Pointer<int>>);
+static_assert(std::is_nothrow_move_assignable_v<Pointer<int>>);
+
 // INCORRECT version of smart_generator
 template <typename T>
 Pointer<int> &dumb_generator(T init) {
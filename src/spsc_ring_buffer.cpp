@@ -0,0 +1,462 @@
+/**
+ * @file spsc_ring_buffer.cpp
+ * @brief Tutorial code for a wait-free single-producer single-consumer ring
+ * buffer, which hands ownership of move-only objects from one thread to
+ * another.
+ */
+
+// spring2024/s24_my_ptr.cpp says we need move semantics to "pass down one
+// element from a thread to another": a std::unique_ptr or Pointer<T> can't
+// be copied, so the only way to give the object to another thread is to
+// move the handle over. The usual way to do that is a std::queue guarded by
+// a mutex (see mutex.cpp), which every push and pop has to take.
+
+// When there's exactly one producer thread and one consumer thread, a ring
+// buffer needs no lock at all:
+// - The producer is the only thread that writes tail_, the index of the
+//   next free slot, and the consumer is the only thread that writes head_,
+//   the index of the next full slot. Each just reads the other's index to
+//   see if the buffer is full or empty.
+// - The producer moves an element into its slot and then stores tail_ with
+//   release ordering, so a consumer that loads tail_ with acquire ordering
+//   sees the element. Popping works the same way in the other direction.
+// Every operation takes a bounded number of steps, whatever the other
+// thread does, which makes it wait-free.
+
+// Two details make it fast:
+// - head_ and tail_ live on separate cache lines. Otherwise every push
+//   would invalidate the line the consumer reads, even when the buffer is
+//   nowhere near empty ("false sharing").
+// - Each side keeps a private copy of the other side's index, and only
+//   reloads it when the copy says the buffer is full (or empty). Reading
+//   the other thread's index means taking its cache line, so most
+//   operations now touch no shared cache line besides the slot itself.
+// TryPushN and TryPopN move up to n elements with one index update, which
+// amortizes even that.
+
+// Includes std::min.
+#include <algorithm>
+// Includes std::atomic.
+#include <atomic>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::back_inserter.
+#include <iterator>
+// Includes std::unique_ptr.
+#include <memory>
+// Includes std::mutex and std::scoped_lock.
+#include <mutex>
+// Includes std::launder.
+#include <new>
+// Includes std::optional.
+#include <optional>
+// Includes the queue container we compare against.
+#include <queue>
+// Includes std::thread.
+#include <thread>
+// Includes std::is_nothrow_move_constructible_v.
+#include <type_traits>
+// Includes std::move.
+#include <utility>
+// Includes the vector container.
+#include <vector>
+
+/* ======================================================================
+   === The ring buffer ==================================================
+   ====================================================================== */
+
+// Holds up to capacity elements of a move-only (or movable) type T. Exactly
+// one thread may push, and exactly one other thread may pop.
+template <typename T>
+class SpscRingBuffer {
+  static_assert(std::is_nothrow_move_constructible_v<T>, "a failed move would lose the element");
+
+ public:
+  // The capacity is rounded up to a power of two, so that an index maps to
+  // its slot with a mask instead of a division.
+  explicit SpscRingBuffer(size_t capacity) : mask_(RoundUp(capacity) - 1), slots_(new Slot[mask_ + 1]) {}
+
+  // Destroys the elements that were never popped. No thread may use the
+  // buffer anymore.
+  ~SpscRingBuffer() {
+    for (size_t i = head_.load(); i != tail_.load(); ++i) {
+      At(i).~T();
+    }
+  }
+
+  SpscRingBuffer(const SpscRingBuffer &) = delete;
+  SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+  size_t Capacity() const { return mask_ + 1; }
+
+  /* === Producer ==================================================== */
+
+  // Moves value into the buffer. If the buffer is full, returns false and
+  // leaves value alone, so the caller still owns it.
+  bool TryPush(T &&value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == Capacity()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == Capacity()) {
+        return false;
+      }
+    }
+    new (&slots_[tail & mask_]) T(std::move(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves up to n elements, starting at first, into the buffer, and returns
+  // how many it moved.
+  template <typename InputIt>
+  size_t TryPushN(InputIt first, size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (Capacity() - (tail - cached_head_) < n) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    size_t count = std::min(n, Capacity() - (tail - cached_head_));
+    size_t i = 0;
+    try {
+      for (; i < count; ++i, ++first) {
+        new (&slots_[(tail + i) & mask_]) T(std::move(*first));
+      }
+    } catch (...) {
+      // Publishes the elements that were built, so that they get destroyed.
+      tail_.store(tail + i, std::memory_order_release);
+      throw;
+    }
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  /* === Consumer ==================================================== */
+
+  // Moves the oldest element out of the buffer, or returns nullopt if it's
+  // empty.
+  std::optional<T> TryPop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return std::nullopt;
+      }
+    }
+    std::optional<T> value(std::move(At(head)));
+    At(head).~T();
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  // Moves up to n of the oldest elements to out, and returns how many it
+  // moved.
+  template <typename OutputIt>
+  size_t TryPopN(OutputIt out, size_t n) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < n) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    size_t count = std::min(n, cached_tail_ - head);
+    size_t i = 0;
+    try {
+      for (; i < count; ++i, ++out) {
+        T &value = At(head + i);
+        *out = std::move(value);
+        value.~T();
+      }
+    } catch (...) {
+      // The elements before i are already destroyed, so they must not stay
+      // in the buffer. The one that failed still is.
+      head_.store(head + i, std::memory_order_release);
+      throw;
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  // Uninitialized memory for one element, so that T needs no default
+  // constructor, and empty slots don't own anything.
+  struct Slot {
+    alignas(T) unsigned char bytes_[sizeof(T)];
+  };
+
+  static size_t RoundUp(size_t capacity) {
+    size_t power = 1;
+    while (power < capacity) {
+      power *= 2;
+    }
+    return power;
+  }
+
+  T &At(size_t index) { return *std::launder(reinterpret_cast<T *>(&slots_[index & mask_])); }
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+
+  // Indices only ever grow, and are masked when used. The number of
+  // elements is always tail_ - head_, which unsigned arithmetic keeps right
+  // even after the indices wrap around.
+
+  // Written by the consumer, read by the producer.
+  alignas(64) std::atomic<size_t> head_{0};
+  // The consumer's copy of tail_.
+  size_t cached_tail_{0};
+
+  // Written by the producer, read by the consumer.
+  alignas(64) std::atomic<size_t> tail_{0};
+  // The producer's copy of head_.
+  size_t cached_head_{0};
+
+  // Keeps whatever comes after the buffer off the producer's cache line.
+  alignas(64) char padding_[1]{};
+};
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// The final version of Pointer<T> from spring2024/s24_my_ptr.cpp, which is
+// a program of its own, so we can't include it. It doesn't print, since we
+// move millions of them.
+template <typename T>
+class Pointer {
+ public:
+  explicit Pointer(T val) : ptr_(new T(val)) {}
+  ~Pointer() { delete ptr_; }
+  Pointer(const Pointer<T> &) = delete;
+  Pointer<T> &operator=(const Pointer<T> &) = delete;
+  Pointer(Pointer<T> &&another) noexcept : ptr_(another.ptr_) { another.ptr_ = nullptr; }
+  Pointer<T> &operator=(Pointer<T> &&another) noexcept {
+    if (ptr_ == another.ptr_) {
+      return *this;
+    }
+    delete ptr_;
+    ptr_ = another.ptr_;
+    another.ptr_ = nullptr;
+    return *this;
+  }
+  T &operator*() { return *ptr_; }
+
+ private:
+  T *ptr_;
+};
+
+// The baseline: a std::queue guarded by a mutex, with the same interface.
+template <typename T>
+class LockedQueue {
+ public:
+  explicit LockedQueue(size_t capacity) : capacity_(capacity) {}
+
+  bool TryPush(T &&value) {
+    std::scoped_lock lock(m_);
+    if (queue_.size() == capacity_) {
+      return false;
+    }
+    queue_.push(std::move(value));
+    return true;
+  }
+
+  std::optional<T> TryPop() {
+    std::scoped_lock lock(m_);
+    if (queue_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> value(std::move(queue_.front()));
+    queue_.pop();
+    return value;
+  }
+
+ private:
+  size_t capacity_;
+  std::mutex m_;
+  std::queue<T> queue_;
+};
+
+constexpr size_t CAPACITY = 1024;
+constexpr int ITEMS = 2000000;
+constexpr size_t BATCH = 32;
+constexpr int ROUND_TRIPS = 20000;
+
+// Keeps the compiler from optimizing the transfers away.
+std::atomic<int64_t> sink{0};
+
+// Makes the int that the producer sends.
+template <typename Handle>
+Handle Make(int value);
+template <>
+std::unique_ptr<int> Make(int value) {
+  return std::make_unique<int>(value);
+}
+template <>
+Pointer<int> Make(int value) {
+  return Pointer<int>(value);
+}
+
+// When the other side isn't ready, the waiting side yields its core rather
+// than spin: on a machine with fewer cores than threads, spinning would
+// only keep the other side from running.
+
+// The producer allocates ITEMS objects and hands them over, and the consumer
+// reads and frees them. Returns millions of items per second.
+template <typename Handle, typename Queue>
+double MeasureThroughput() {
+  Queue queue(CAPACITY);
+  auto start = std::chrono::steady_clock::now();
+  std::thread consumer([&queue] {
+    int64_t sum = 0;
+    for (int received = 0; received < ITEMS;) {
+      std::optional<Handle> value = queue.TryPop();
+      if (value.has_value()) {
+        sum += **value;
+        ++received;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    sink += sum;
+  });
+  for (int i = 0; i < ITEMS; ++i) {
+    Handle value = Make<Handle>(i);
+    while (!queue.TryPush(std::move(value))) {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return ITEMS / seconds / 1e6;
+}
+
+// The same, moving BATCH elements at a time.
+template <typename Handle>
+double MeasureBatchThroughput() {
+  SpscRingBuffer<Handle> queue(CAPACITY);
+  auto start = std::chrono::steady_clock::now();
+  std::thread consumer([&queue] {
+    std::vector<Handle> batch;
+    batch.reserve(BATCH);
+    int64_t sum = 0;
+    for (int received = 0; received < ITEMS;) {
+      batch.clear();
+      size_t count = queue.TryPopN(std::back_inserter(batch), BATCH);
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+      for (Handle &value : batch) {
+        sum += *value;
+      }
+      received += static_cast<int>(count);
+    }
+    sink += sum;
+  });
+  std::vector<Handle> batch;
+  batch.reserve(BATCH);
+  for (int i = 0; i < ITEMS;) {
+    batch.clear();
+    for (int j = i; j < ITEMS && batch.size() < BATCH; ++j) {
+      batch.push_back(Make<Handle>(j));
+    }
+    // Elements that didn't fit stay in the batch, and go out next time.
+    size_t sent = 0;
+    while (sent < batch.size()) {
+      size_t count = queue.TryPushN(batch.begin() + sent, batch.size() - sent);
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+      sent += count;
+    }
+    i += static_cast<int>(batch.size());
+  }
+  consumer.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return ITEMS / seconds / 1e6;
+}
+
+// One object bounces between two threads through a pair of queues. Returns
+// the average round trip in microseconds, which is two handoffs.
+template <typename Handle, typename Queue>
+double MeasureRoundTrip() {
+  Queue ping(CAPACITY);
+  Queue pong(CAPACITY);
+  std::thread echo([&ping, &pong] {
+    for (int i = 0; i < ROUND_TRIPS; ++i) {
+      std::optional<Handle> value;
+      while (!(value = ping.TryPop()).has_value()) {
+        std::this_thread::yield();
+      }
+      pong.TryPush(std::move(*value));
+    }
+  });
+  Handle value = Make<Handle>(445);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUND_TRIPS; ++i) {
+    ping.TryPush(std::move(value));
+    std::optional<Handle> back;
+    while (!(back = pong.TryPop()).has_value()) {
+      std::this_thread::yield();
+    }
+    value = std::move(*back);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  echo.join();
+  return seconds / ROUND_TRIPS * 1e6;
+}
+
+template <typename Handle>
+void RunBenchmark(const char *name) {
+  std::cout << "  " << name << ":\n" << std::fixed << std::setprecision(2);
+  std::cout << "    mutex + std::queue:       " << std::setw(6) << MeasureThroughput<Handle, LockedQueue<Handle>>()
+            << "M items/s, " << std::setw(6) << MeasureRoundTrip<Handle, LockedQueue<Handle>>()
+            << " us per round trip\n";
+  std::cout << "    SpscRingBuffer:           " << std::setw(6) << MeasureThroughput<Handle, SpscRingBuffer<Handle>>()
+            << "M items/s, " << std::setw(6) << MeasureRoundTrip<Handle, SpscRingBuffer<Handle>>()
+            << " us per round trip\n";
+  std::cout << "    SpscRingBuffer, batch " << BATCH << ": " << std::setw(6) << MeasureBatchThroughput<Handle>()
+            << "M items/s\n";
+}
+
+int main() {
+  // One thread hands a Pointer<int> to another, like s24_my_ptr.cpp wants.
+  // The consumer ends up owning it, and frees it.
+  SpscRingBuffer<Pointer<int>> ring(4);
+  std::thread consumer([&ring] {
+    std::optional<Pointer<int>> received;
+    while (!(received = ring.TryPop()).has_value()) {
+      std::this_thread::yield();
+    }
+    std::cout << "The consumer got " << **received << ".\n";
+  });
+  Pointer<int> p(15445);
+  ring.TryPush(std::move(p));
+  consumer.join();
+
+  // A full buffer refuses the element, and the caller keeps it.
+  SpscRingBuffer<std::unique_ptr<int>> small(2);
+  std::vector<std::unique_ptr<int>> values;
+  for (int i = 0; i < 3; ++i) {
+    values.push_back(std::make_unique<int>(i));
+  }
+  size_t pushed = small.TryPushN(values.begin(), values.size());
+  std::cout << "Pushed " << pushed << " of 3 into a buffer of " << small.Capacity() << ", and still own "
+            << *values[2] << ".\n";
+  std::vector<std::unique_ptr<int>> popped;
+  small.TryPopN(std::back_inserter(popped), 8);
+  std::cout << "Popped " << popped.size() << ": " << *popped[0] << " and " << *popped[1] << ".\n\n";
+
+  // The threads aren't pinned, so the scheduler decides where they run.
+  // On two cores, a handoff is a cache line transfer, a few dozen
+  // nanoseconds. Sharing one core, the threads take turns, and a round trip
+  // is two context switches.
+  std::cout << "Moving " << ITEMS << " objects from one thread to another (" << std::thread::hardware_concurrency()
+            << " hardware threads), and " << ROUND_TRIPS << " round trips:\n";
+  RunBenchmark<std::unique_ptr<int>>("std::unique_ptr<int>");
+  RunBenchmark<Pointer<int>>("Pointer<int>");
+  return 0;
+}
@@ -0,0 +1,557 @@
+/**
+ * @file static_containers.cpp
+ * @brief Tutorial code for fixed-capacity containers whose capacity is a
+ * non-type template parameter, like Bar<int T> in templated_classes.cpp.
+ */
+
+// templated_classes.cpp ends with `template<int T> class Bar`, whose
+// template parameter is a value instead of a type. Bar<150> and Bar<445> are
+// different types, and inside each of them T is a compile-time constant.
+
+// This file uses that to build containers with a capacity that's fixed at
+// compile time:
+// - StaticVector<T, N>: a vector that holds at most N elements.
+// - StaticString<N>: a string of at most N chars.
+// - StaticHashMap<K, V, N>: a hash map that holds at most N entries.
+// All of their storage is inside the object: a StaticVector<int, 16> is an
+// array of 16 ints plus a size, wherever it lives (on the stack, inside
+// another object, or in the program's read-only data). None of them ever
+// touches the heap. Since the compiler knows their exact size, it can also
+// unroll loops over them, and keep small ones in registers.
+
+// They're also usable in constexpr code, so a table can be built while
+// compiling and looked up for free at runtime (or checked with
+// static_assert, which is how this file tests them). That's why the storage
+// is a plain std::array instead of raw memory: C++17 doesn't allow
+// placement new in constexpr functions. The price is that T has to be
+// default constructible, and all N elements are constructed up front.
+
+// Includes std::array.
+#include <array>
+// Includes std::chrono for the benchmark.
+#include <chrono>
+// Includes std::size_t.
+#include <cstddef>
+// Includes the fixed-width integer types.
+#include <cstdint>
+// Includes std::setw.
+#include <iomanip>
+// Includes std::initializer_list.
+#include <initializer_list>
+// Includes std::cout (printing) for demo purposes.
+#include <iostream>
+// Includes std::length_error.
+#include <stdexcept>
+// Includes std::string.
+#include <string>
+// Includes std::string_view.
+#include <string_view>
+// Includes std::is_integral.
+#include <type_traits>
+// Includes std::unordered_map, the dynamic equivalent of StaticHashMap.
+#include <unordered_map>
+// Includes std::move.
+#include <utility>
+// Includes the vector container, the dynamic equivalent of StaticVector.
+#include <vector>
+
+/* ======================================================================
+   === StaticVector =====================================================
+   ====================================================================== */
+
+// Pushing past the capacity is a bug, just like indexing past the end of a
+// std::array. In a constexpr evaluation, reaching the throw makes the
+// compiler reject the program.
+template <typename T, size_t N>
+class StaticVector {
+ public:
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  constexpr StaticVector() = default;
+
+  constexpr StaticVector(std::initializer_list<T> init) {
+    for (const T &value : init) {
+      push_back(value);
+    }
+  }
+
+  static constexpr size_t capacity() { return N; }
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr bool full() const { return size_ == N; }
+
+  constexpr T &operator[](size_t i) { return data_[i]; }
+  constexpr const T &operator[](size_t i) const { return data_[i]; }
+  constexpr T &back() { return data_[size_ - 1]; }
+  constexpr const T &back() const { return data_[size_ - 1]; }
+
+  constexpr iterator begin() { return data_.data(); }
+  constexpr iterator end() { return data_.data() + size_; }
+  constexpr const_iterator begin() const { return data_.data(); }
+  constexpr const_iterator end() const { return data_.data() + size_; }
+
+  constexpr void push_back(const T &value) {
+    CheckRoom();
+    data_[size_++] = value;
+  }
+
+  constexpr void push_back(T &&value) {
+    CheckRoom();
+    data_[size_++] = std::move(value);
+  }
+
+  // Elements are assigned into existing slots, so emplace_back builds a T
+  // and moves it in.
+  template <typename... Args>
+  constexpr T &emplace_back(Args &&...args) {
+    push_back(T(std::forward<Args>(args)...));
+    return back();
+  }
+
+  // The slot is reset to a default T, so that a popped std::string gives its
+  // memory back right away instead of when the StaticVector is destroyed.
+  constexpr void pop_back() { data_[--size_] = T(); }
+
+  constexpr void clear() {
+    while (size_ > 0) {
+      pop_back();
+    }
+  }
+
+ private:
+  constexpr void CheckRoom() const {
+    if (size_ == N) {
+      throw std::length_error("StaticVector is full");
+    }
+  }
+
+  std::array<T, N> data_{};
+  size_t size_{0};
+};
+
+/* ======================================================================
+   === StaticString =====================================================
+   ====================================================================== */
+
+// A string of up to N chars, stored inline and always null-terminated.
+// Unlike std::string, which only stores strings of up to 15 chars inline
+// (in libstdc++), it never allocates, however long N is.
+template <size_t N>
+class StaticString {
+ public:
+  constexpr StaticString() = default;
+
+  // From a string literal. A literal that's too long is a compile error,
+  // since the length of a literal is part of its type.
+  template <size_t M>
+  constexpr StaticString(const char (&literal)[M]) {
+    static_assert(M - 1 <= N, "string literal doesn't fit");
+    Append(std::string_view(literal, M - 1));
+  }
+
+  constexpr explicit StaticString(std::string_view view) { Append(view); }
+
+  static constexpr size_t capacity() { return N; }
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr const char *c_str() const { return chars_.data(); }
+  constexpr char operator[](size_t i) const { return chars_[i]; }
+  constexpr operator std::string_view() const { return std::string_view(chars_.data(), size_); }
+
+  constexpr StaticString &Append(std::string_view view) {
+    if (view.size() > N - size_) {
+      throw std::length_error("StaticString is full");
+    }
+    for (char c : view) {
+      chars_[size_++] = c;
+    }
+    chars_[size_] = '\0';
+    return *this;
+  }
+
+  constexpr StaticString &operator+=(std::string_view view) { return Append(view); }
+
+  constexpr bool operator==(const StaticString &other) const {
+    return std::string_view(*this) == std::string_view(other);
+  }
+  constexpr bool operator!=(const StaticString &other) const { return !(*this == other); }
+
+ private:
+  std::array<char, N + 1> chars_{};
+  size_t size_{0};
+};
+
+template <size_t N>
+std::ostream &operator<<(std::ostream &os, const StaticString<N> &str) {
+  return os << std::string_view(str);
+}
+
+/* ======================================================================
+   === StaticHashMap ====================================================
+   ====================================================================== */
+
+// A hash function that can run at compile time (std::hash can't).
+template <typename K, typename = void>
+struct StaticHash;
+
+// Integers: the finalizer from MurmurHash3, which mixes every input bit
+// into every output bit.
+template <typename K>
+struct StaticHash<K, std::enable_if_t<std::is_integral_v<K>>> {
+  constexpr uint64_t operator()(K key) const {
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+};
+
+// Strings: FNV-1a.
+template <size_t N>
+struct StaticHash<StaticString<N>> {
+  constexpr uint64_t operator()(const StaticString<N> &key) const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : std::string_view(key)) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+};
+
+// The smallest power of two that is at least n.
+constexpr size_t NextPowerOfTwo(size_t n) {
+  size_t power = 1;
+  while (power < n) {
+    power *= 2;
+  }
+  return power;
+}
+
+// An open addressing hash map with linear probing: all entries live in one
+// array of SLOTS slots, and an entry whose slot is taken goes into the next
+// free one. SLOTS is at least twice N, so the array is never more than half
+// full and probe sequences stay short. Since SLOTS is a power of two known
+// at compile time, "hash % SLOTS" compiles to a single AND.
+template <typename K, typename V, size_t N, typename Hash = StaticHash<K>>
+class StaticHashMap {
+ public:
+  static constexpr size_t SLOTS = NextPowerOfTwo(2 * N);
+
+  constexpr StaticHashMap() = default;
+
+  constexpr StaticHashMap(std::initializer_list<std::pair<K, V>> init) {
+    for (const auto &[key, value] : init) {
+      Insert(key, value);
+    }
+  }
+
+  static constexpr size_t capacity() { return N; }
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  // Inserts key, or overwrites its value if it's already there. Returns
+  // false, and doesn't insert, if the map already holds N entries.
+  constexpr bool Insert(const K &key, const V &value) {
+    size_t slot = FindSlot(key);
+    if (used_[slot]) {
+      values_[slot] = value;
+      return true;
+    }
+    if (size_ == N) {
+      return false;
+    }
+    used_[slot] = true;
+    keys_[slot] = key;
+    values_[slot] = value;
+    size_ += 1;
+    return true;
+  }
+
+  // Returns a pointer to key's value, or nullptr if key isn't in the map.
+  constexpr const V *Find(const K &key) const {
+    size_t slot = FindSlot(key);
+    return used_[slot] ? &values_[slot] : nullptr;
+  }
+
+  constexpr bool Contains(const K &key) const { return Find(key) != nullptr; }
+
+  // Removes key, if it's there. Instead of leaving a "deleted" marker
+  // behind, it moves later entries of the same probe sequence back into the
+  // hole ("backward shift deletion"), so lookups never have to skip over
+  // deleted slots.
+  constexpr bool Erase(const K &key) {
+    size_t hole = FindSlot(key);
+    if (!used_[hole]) {
+      return false;
+    }
+    size_t slot = hole;
+    while (true) {
+      slot = (slot + 1) & (SLOTS - 1);
+      if (!used_[slot]) {
+        break;
+      }
+      // The entry in slot can fill the hole unless its home slot lies
+      // (cyclically) after the hole and at or before slot.
+      size_t home = Hash()(keys_[slot]) & (SLOTS - 1);
+      bool home_in_between = hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot);
+      if (!home_in_between) {
+        keys_[hole] = std::move(keys_[slot]);
+        values_[hole] = std::move(values_[slot]);
+        hole = slot;
+      }
+    }
+    used_[hole] = false;
+    keys_[hole] = K();
+    values_[hole] = V();
+    size_ -= 1;
+    return true;
+  }
+
+ private:
+  // The slot that holds key, or the empty slot where it would go. There
+  // always is one, since at most half of the slots are used.
+  constexpr size_t FindSlot(const K &key) const {
+    size_t slot = Hash()(key) & (SLOTS - 1);
+    while (used_[slot] && !(keys_[slot] == key)) {
+      slot = (slot + 1) & (SLOTS - 1);
+    }
+    return slot;
+  }
+
+  std::array<K, SLOTS> keys_{};
+  std::array<V, SLOTS> values_{};
+  std::array<bool, SLOTS> used_{};
+  size_t size_{0};
+};
+
+/* ======================================================================
+   === Tests ============================================================
+   ====================================================================== */
+
+// These tests run inside the compiler: if one fails, the file doesn't
+// compile. The lambdas are evaluated at compile time because their result
+// is used in a static_assert.
+
+static_assert(sizeof(StaticVector<int, 16>) == 16 * sizeof(int) + sizeof(size_t));
+static_assert(StaticHashMap<int, int, 100>::SLOTS == 256);
+
+static_assert([] {
+  StaticVector<int, 4> vec = {0, 1, 2};
+  vec.push_back(3);
+  vec.pop_back();
+  vec.emplace_back(4);
+  int sum = 0;
+  for (int value : vec) {
+    sum += value;
+  }
+  return vec.size() == 4 && vec.full() && sum == 7 && vec.back() == 4;
+}());
+
+static_assert([] {
+  StaticString<16> str = "andy";
+  str += " ";
+  str += "pavlo";
+  return str.size() == 10 && std::string_view(str) == "andy pavlo" && str == StaticString<16>("andy pavlo");
+}());
+
+static_assert([] {
+  StaticHashMap<int, int, 8> map = {{1, 10}, {2, 20}, {3, 30}};
+  map.Insert(2, 200);
+  bool ok = map.size() == 3 && *map.Find(2) == 200 && map.Find(4) == nullptr;
+  for (int key = 4; key <= 8; ++key) {
+    map.Insert(key, key * 10);
+  }
+  ok = ok && map.size() == 8 && !map.Insert(9, 90) && !map.Contains(9);
+  ok = ok && map.Erase(1) && !map.Erase(1) && map.size() == 7;
+  // After erasing, every other key must still be found, wherever it was
+  // shifted to.
+  for (int key = 2; key <= 8; ++key) {
+    ok = ok && map.Contains(key);
+  }
+  return ok;
+}());
+
+// Many keys with the same home slot, erased in a different order than they
+// were inserted, to exercise backward shift deletion.
+struct CollidingHash {
+  constexpr uint64_t operator()(int key) const { return static_cast<uint64_t>(key % 2); }
+};
+static_assert([] {
+  StaticHashMap<int, int, 16, CollidingHash> map;
+  for (int key = 0; key < 16; ++key) {
+    map.Insert(key, key);
+  }
+  bool ok = true;
+  for (int key : {4, 0, 15, 7, 8, 1}) {
+    ok = ok && map.Erase(key);
+  }
+  for (int key = 0; key < 16; ++key) {
+    bool erased = key == 4 || key == 0 || key == 15 || key == 7 || key == 8 || key == 1;
+    ok = ok && map.Contains(key) == !erased && (erased || *map.Find(key) == key);
+  }
+  return ok && map.size() == 10;
+}());
+
+/* ======================================================================
+   === A table built at compile time ====================================
+   ====================================================================== */
+
+// A database parser has to recognize keywords like SELECT. The table of
+// keywords never changes, so it can be built by the compiler and stored in
+// the program itself: there's no code that runs at startup to fill it.
+enum class Keyword { NONE, SELECT, FROM, WHERE, INSERT, INTO, VALUES, DELETE };
+
+using KeywordString = StaticString<8>;
+
+constexpr StaticHashMap<KeywordString, Keyword, 8> KEYWORDS = {
+    {"SELECT", Keyword::SELECT}, {"FROM", Keyword::FROM},     {"WHERE", Keyword::WHERE},
+    {"INSERT", Keyword::INSERT}, {"INTO", Keyword::INTO},     {"VALUES", Keyword::VALUES},
+    {"DELETE", Keyword::DELETE},
+};
+
+constexpr Keyword LookupKeyword(std::string_view word) {
+  if (word.size() > KeywordString::capacity()) {
+    return Keyword::NONE;
+  }
+  const Keyword *keyword = KEYWORDS.Find(KeywordString(word));
+  return keyword == nullptr ? Keyword::NONE : *keyword;
+}
+
+static_assert(LookupKeyword("WHERE") == Keyword::WHERE);
+static_assert(LookupKeyword("BUSTUB") == Keyword::NONE);
+static_assert(LookupKeyword("A_VERY_LONG_NAME") == Keyword::NONE);
+
+/* ======================================================================
+   === Benchmark ========================================================
+   ====================================================================== */
+
+// Keeps the compiler from deleting the loops below as dead code.
+static volatile size_t sink = 0;
+
+template <typename Fn>
+void Measure(const char *name, size_t iterations, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    fn(i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << std::left << std::setw(40) << name << ns / iterations << " ns per iteration\n";
+}
+
+// Builds a vector of 12 ints and sums it, like a small list that a function
+// builds and throws away.
+template <typename Vec>
+size_t BuildAndSum(size_t seed) {
+  Vec vec;
+  for (size_t i = 0; i < 12; ++i) {
+    vec.push_back(static_cast<int>(seed + i));
+  }
+  size_t sum = 0;
+  for (int value : vec) {
+    sum += value;
+  }
+  return sum;
+}
+
+// Builds a 25 char name out of pieces. That's longer than std::string's
+// inline buffer, so std::string has to allocate.
+template <typename Str>
+size_t BuildName(size_t seed) {
+  Str name("andy");
+  name += " pavlo";
+  name += seed % 2 == 0 ? " 15-445" : " 15-645";
+  name += " bustub";
+  return std::string_view(name).size() + std::string_view(name)[seed % 4];
+}
+
+template <typename Map>
+size_t InsertAndLookUp(size_t seed, size_t count) {
+  Map map;
+  for (size_t i = 0; i < count; ++i) {
+    if constexpr (std::is_same_v<Map, std::unordered_map<int, int>>) {
+      map.insert({static_cast<int>(seed + i * 7), static_cast<int>(i)});
+    } else {
+      map.Insert(static_cast<int>(seed + i * 7), static_cast<int>(i));
+    }
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < 2 * count; ++i) {
+    if constexpr (std::is_same_v<Map, std::unordered_map<int, int>>) {
+      found += map.count(static_cast<int>(seed + i * 7));
+    } else {
+      found += map.Contains(static_cast<int>(seed + i * 7));
+    }
+  }
+  return found;
+}
+
+void RunBenchmark() {
+  constexpr size_t iterations = 1000000;
+
+  std::cout << "Build a vector of 12 ints and sum it:\n";
+  Measure("std::vector<int>", iterations, [](size_t i) { sink = sink + BuildAndSum<std::vector<int>>(i); });
+  Measure("StaticVector<int, 16>", iterations,
+          [](size_t i) { sink = sink + BuildAndSum<StaticVector<int, 16>>(i); });
+
+  std::cout << "Build a 25 char string out of 4 pieces:\n";
+  Measure("std::string", iterations, [](size_t i) { sink = sink + BuildName<std::string>(i); });
+  Measure("StaticString<32>", iterations, [](size_t i) { sink = sink + BuildName<StaticString<32>>(i); });
+
+  std::cout << "Insert 32 ints into a map and look up 64:\n";
+  Measure("std::unordered_map<int, int>", iterations / 10,
+          [](size_t i) { sink = sink + InsertAndLookUp<std::unordered_map<int, int>>(i, 32); });
+  Measure("StaticHashMap<int, int, 32>", iterations / 10,
+          [](size_t i) { sink = sink + InsertAndLookUp<StaticHashMap<int, int, 32>>(i, 32); });
+
+  std::cout << "Look up a keyword:\n";
+  std::unordered_map<std::string, Keyword> dynamic_keywords = {
+      {"SELECT", Keyword::SELECT}, {"FROM", Keyword::FROM},     {"WHERE", Keyword::WHERE},
+      {"INSERT", Keyword::INSERT}, {"INTO", Keyword::INTO},     {"VALUES", Keyword::VALUES},
+      {"DELETE", Keyword::DELETE},
+  };
+  const std::string words[] = {"SELECT", "name", "FROM", "person", "WHERE", "age", "INTO", "VALUES"};
+  Measure("std::unordered_map<std::string, ...>", iterations, [&](size_t i) {
+    auto it = dynamic_keywords.find(words[i % 8]);
+    sink = sink + (it == dynamic_keywords.end() ? 0 : static_cast<size_t>(it->second));
+  });
+  Measure("constexpr StaticHashMap", iterations,
+          [&](size_t i) { sink = sink + static_cast<size_t>(LookupKeyword(words[i % 8])); });
+}
+
+int main() {
+  // Like Bar<150>, every capacity makes a different type.
+  StaticVector<int, 4> int_vector = {0, 1, 2};
+  int_vector.push_back(3);
+  std::cout << "int_vector has " << int_vector.size() << " of " << int_vector.capacity() << " elements, and is "
+            << sizeof(int_vector) << " bytes, all of them on the stack\n";
+  try {
+    int_vector.push_back(4);
+  } catch (const std::length_error &e) {
+    std::cout << "Pushing a fifth element: " << e.what() << "\n";
+  }
+
+  StaticString<24> name = "andy";
+  name += " pavlo";
+  std::cout << "name is \"" << name << "\", " << name.size() << " of " << name.capacity() << " chars\n";
+
+  StaticHashMap<int, StaticString<8>, 4> courses = {{445, "intro"}, {645, "grad"}};
+  std::cout << "15-445 is the " << *courses.Find(445) << " course, and 15-721 is "
+            << (courses.Contains(721) ? "there" : "not there") << "\n";
+
+  // KEYWORDS was built by the compiler. Looking a word up at runtime works
+  // the same as it would with a map built at runtime.
+  for (std::string_view word : {"SELECT", "name", "FROM", "person"}) {
+    std::cout << word << (LookupKeyword(word) == Keyword::NONE ? " is not a keyword\n" : " is a keyword\n");
+  }
+  std::cout << "\n";
+
+  RunBenchmark();
+
+  return 0;
+}
@@ -69,6 +69,7 @@ class FooSpecial<float> {
 };
 
 // Template parameters don't have to be types. They can also be values!
+// static_containers.cpp uses this for containers with a fixed capacity.
 template<int T>
 class Bar {
   public: 
@@ -23,6 +23,8 @@
 
 // Includes std::cout (printing) for demo purposes.
 #include <iostream>
+// Includes std::is_nothrow_move_constructible.
+#include <type_traits>
 // Includes the utility header for std::move.
 #include <utility>
 
@@ -68,15 +70,16 @@ class IntPtrManager {
     // constructor is called, effectively moving all of other's data into
     // the specified instance being constructed, the other object is no
     // longer a valid instance of the IntPtrManager class, since it has
-    // no memory to manage. 
-    IntPtrManager(IntPtrManager&& other) {
+    // no memory to manage. Moving only copies a pointer, so it can't throw,
+    // and we mark it noexcept so that containers like std::vector know that.
+    IntPtrManager(IntPtrManager&& other) noexcept {
       ptr_ = other.ptr_;
       other.ptr_ = nullptr;
     }
 
     // Move assignment operator for this wrapper class. Similar techniques as
     // the move constructor.
-    IntPtrManager &operator=(IntPtrManager &&other) {
+    IntPtrManager &operator=(IntPtrManager &&other) noexcept {
       if (ptr_ == other.ptr_) {
         return *this;
       }
@@ -108,6 +111,10 @@ class IntPtrManager {
 
 };
 
+// Checked at compile time: this file won't compile if a move can throw.
+static_assert(std::is_nothrow_move_constructible_v<IntPtrManager>);
+static_assert(std::is_nothrow_move_assignable_v<IntPtrManager>);
+
 int main() {
   // We initialize an instance of IntPtrManager. After it is initialized, this
   // class is managing an int pointer.